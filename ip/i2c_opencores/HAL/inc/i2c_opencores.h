@@ -16,6 +16,8 @@ void I2C_init(alt_u32 base,alt_u32 clk,alt_u32 speed);
 int I2C_start(alt_u32 base, alt_u32 add, alt_u32 read);
 alt_u32 I2C_read(alt_u32 base,alt_u32 last);
 alt_u32 I2C_write(alt_u32 base,alt_u8 data, alt_u32 last);
+alt_u32 I2C_get_bytecnt();
+alt_u32 I2C_write_buf(alt_u32 base, alt_u32 add, const alt_u8 *data, int len, alt_u32 last);
 void SPI_read(alt_u32 base, alt_u8 *rdata, int len);
 void SPI_write(alt_u32 base, alt_u8 *wdata, int len);
 #define I2C_OK (0)
@@ -23,6 +25,77 @@ void SPI_write(alt_u32 base, alt_u8 *wdata, int len);
 #define I2C_NOACK (1)
 #define I2C_ABITRATION_LOST (2)
 
+/* Write filter. A write transaction to a device accepted by match() is
+   buffered from I2C_start() on, and passed to commit() when the write with
+   stop bit is issued (last=1) or when the transaction is followed by a
+   (repeated) start (last=0). The first buffered byte is register address.
+   Writes longer than I2C_WFILTER_BUFLEN are split into auto-increment
+   chunks. commit() performs the transfer with I2C_write_buf() and returns
+   I2C_ACK/I2C_NOACK. Queued and sequencer transfers are not filtered. */
+#define I2C_WFILTER_BUFLEN 32
+typedef struct {
+  int (*match)(alt_u32 base, alt_u8 addr);
+  alt_u32 (*commit)(alt_u32 base, alt_u8 addr, const alt_u8 *buf, int len, alt_u32 last);
+} I2C_write_filter;
+
+void I2C_set_write_filter(const I2C_write_filter *filter);
+
+/* Queued transactions. Write phase (wlen bytes) is followed by a read phase
+   (rlen bytes) with a repeated start. Descriptors must stay valid until the
+   callback has been called. Synchronous transfers and sequencer start wait
+   until the queue of the same core has drained, so callbacks must not start
+   synchronous transfers themselves. */
+struct I2C_xfer;
+typedef void (*I2C_xfer_cb)(struct I2C_xfer *xfer);
+
+typedef struct I2C_xfer {
+  alt_u8 addr;
+  alt_u8 *wdata;
+  alt_u16 wlen;
+  alt_u8 *rdata;
+  alt_u16 rlen;
+  I2C_xfer_cb callback;
+  void *ctx;
+  int status;
+  /* internal */
+  alt_u8 state;
+  alt_u16 pos;
+  struct I2C_xfer *next;
+} I2C_xfer;
+
+typedef void (*I2C_seq_cb)(int status, void *ctx);
+
+typedef struct I2C_queue {
+  alt_u32 base;
+  I2C_xfer *head;
+  I2C_xfer *tail;
+  I2C_seq_cb seq_cb;
+  void *seq_ctx;
+  /* internal */
+  struct I2C_queue *qnext;
+} I2C_queue;
+
+void I2C_queue_init(I2C_queue *q, alt_u32 base);
+void I2C_queue_post(I2C_queue *q, I2C_xfer *xfer);
+int I2C_queue_service(I2C_queue *q);
+void I2C_queue_flush(I2C_queue *q);
+#define I2C_queue_busy(q) (((q)->head != 0) || ((q)->seq_cb != 0))
+
+/* register list sequencer, see i2c_seq.v for list format */
+#define I2C_SEQ_MAX_ENTRIES 64
+#define I2C_SEQ_WRITE(dev, reg, val)  (0x00), (dev), (reg), (val)
+#define I2C_SEQ_DELAY(n256clk)        (0x40), (((n256clk)>>16) & 0xff), (((n256clk)>>8) & 0xff), ((n256clk) & 0xff)
+#define I2C_SEQ_POLL_SET(dev, reg, mask) (0x80), (dev), (reg), (mask)
+#define I2C_SEQ_POLL_CLR(dev, reg, mask) (0x81), (dev), (reg), (mask)
+#define I2C_SEQ_END                   (0xc0), 0, 0, 0
+
+int I2C_seq_load(alt_u32 base, const alt_u8 *list, int len);
+void I2C_seq_start(alt_u32 base, int irq_en);
+int I2C_seq_status(alt_u32 base);
+void I2C_queue_seq_start(I2C_queue *q, I2C_seq_cb cb, void *ctx);
+#define I2C_SEQ_BUSY (1)
+#define I2C_SEQ_ERROR (-1)
+
 #define I2C_OPENCORES_INSTANCE(name, dev) extern int alt_no_storage
 #define I2C_OPENCORES_INIT(name, dev) while (0)
 
@@ -12,13 +12,14 @@ module i2c_opencores
 );
 
 parameter dedicated_spi = 0;
+parameter sequencer = 0;
 
 // Common bus signals
 input        wb_clk_i;		// WISHBONE clock
 input        wb_rst_i;		// WISHBONE reset
 
 // Slave signals
-input  [2:0] wb_adr_i;		// WISHBONE address input
+input  [3:0] wb_adr_i;		// WISHBONE address input (bit 3 selects sequencer)
 input  [7:0] wb_dat_i;		// WISHBONE data input
 output [7:0] wb_dat_o;		// WISHBONE data output
 input        wb_we_i;		// WISHBONE write enable input
@@ -60,14 +61,77 @@ wire arst_i;
 
 assign arst_i = 1'b1;
 
+// Core wishbone port is shared between CPU and sequencer. While sequencer
+// is busy, CPU accesses to core registers are acked but have no effect.
+wire [2:0] core_adr;
+wire [7:0] core_dat_i;
+wire [7:0] core_dat_o;
+wire core_we;
+wire core_stb;
+wire core_ack;
+wire core_inta;
+
+generate
+if (sequencer) begin : gen_seq
+	wire [2:0] seq_m_adr;
+	wire [7:0] seq_m_dat;
+	wire [7:0] seq_reg_dat;
+	wire seq_m_we, seq_m_stb;
+	wire seq_busy, seq_irq;
+	wire cpu_local = wb_adr_i[3] | seq_busy;
+	reg local_ack;
+	reg [7:0] local_dat;
+
+	i2c_seq i2c_seq_inst (
+		.clk(wb_clk_i),
+		.reset(wb_rst_i),
+		.reg_adr(wb_adr_i[1:0]),
+		.reg_dat_i(wb_dat_i),
+		.reg_dat_o(seq_reg_dat),
+		.reg_we(wb_stb_i & wb_we_i & wb_adr_i[3] & ~local_ack),
+		.m_adr(seq_m_adr),
+		.m_dat_o(seq_m_dat),
+		.m_dat_i(core_dat_o),
+		.m_we(seq_m_we),
+		.m_stb(seq_m_stb),
+		.m_ack(core_ack),
+		.busy(seq_busy),
+		.irq(seq_irq)
+	);
+
+	always @(posedge wb_clk_i) begin
+		local_ack <= wb_stb_i & cpu_local & ~local_ack;
+		local_dat <= wb_adr_i[3] ? seq_reg_dat : 8'h00;
+	end
+
+	assign core_adr = seq_busy ? seq_m_adr : wb_adr_i[2:0];
+	assign core_dat_i = seq_busy ? seq_m_dat : wb_dat_i;
+	assign core_we = seq_busy ? seq_m_we : wb_we_i;
+	assign core_stb = seq_busy ? seq_m_stb : (wb_stb_i & ~wb_adr_i[3]);
+
+	assign wb_dat_o = local_ack ? local_dat : core_dat_o;
+	assign wb_ack_o = local_ack | (core_ack & ~seq_busy);
+	assign wb_inta_o = core_inta | seq_irq;
+end else begin : gen_noseq
+	assign core_adr = wb_adr_i[2:0];
+	assign core_dat_i = wb_dat_i;
+	assign core_we = wb_we_i;
+	assign core_stb = wb_stb_i;
+
+	assign wb_dat_o = core_dat_o;
+	assign wb_ack_o = core_ack;
+	assign wb_inta_o = core_inta;
+end
+endgenerate
+
 // Connect the top level I2C core
 i2c_master_top #(.dedicated_spi(dedicated_spi)) i2c_master_top_inst
 (
 	.wb_clk_i(wb_clk_i), .wb_rst_i(wb_rst_i), .arst_i(arst_i),
 	
-	.wb_adr_i(wb_adr_i), .wb_dat_i(wb_dat_i), .wb_dat_o(wb_dat_o),
-	.wb_we_i(wb_we_i), .wb_stb_i(wb_stb_i), .wb_cyc_i(wb_cyc_i),
-	.wb_ack_o(wb_ack_o), .wb_inta_o(wb_inta_o),
+	.wb_adr_i(core_adr), .wb_dat_i(core_dat_i), .wb_dat_o(core_dat_o),
+	.wb_we_i(core_we), .wb_stb_i(core_stb), .wb_cyc_i(core_stb),
+	.wb_ack_o(core_ack), .wb_inta_o(core_inta),
 	
 	.scl_pad_i(scl_pad_i), .scl_pad_o(scl_pad_o), .scl_padoen_o(scl_padoen_o),
 	.sda_pad_i(sda_pad_i), .sda_pad_o(sda_pad_o), .sda_padoen_o(sda_padoen_o),
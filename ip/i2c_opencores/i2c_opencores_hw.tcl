@@ -44,6 +44,7 @@ add_fileset_file i2c_master_top.v VERILOG PATH i2c_master_top.v
 add_fileset_file i2c_master_defines.v VERILOG PATH i2c_master_defines.v
 add_fileset_file i2c_master_byte_ctrl.v VERILOG PATH i2c_master_byte_ctrl.v
 add_fileset_file i2c_master_bit_ctrl.v VERILOG PATH i2c_master_bit_ctrl.v
+add_fileset_file i2c_seq.v VERILOG PATH i2c_seq.v
 
 add_fileset sim_verilog SIM_VERILOG "" "Verilog Simulation"
 set_fileset_property sim_verilog TOP_LEVEL i2c_opencores
@@ -53,6 +54,7 @@ add_fileset_file i2c_master_top.v VERILOG PATH i2c_master_top.v
 add_fileset_file i2c_master_defines.v VERILOG PATH i2c_master_defines.v
 add_fileset_file i2c_master_byte_ctrl.v VERILOG PATH i2c_master_byte_ctrl.v
 add_fileset_file i2c_master_bit_ctrl.v VERILOG PATH i2c_master_bit_ctrl.v
+add_fileset_file i2c_seq.v VERILOG PATH i2c_seq.v
 #add_fileset_file timescale.v VERILOG PATH timescale.v
 
 
@@ -67,6 +69,14 @@ set_parameter_property dedicated_spi TYPE INTEGER
 set_parameter_property dedicated_spi UNITS None
 set_parameter_property dedicated_spi HDL_PARAMETER true
 set_parameter_property dedicated_spi DESCRIPTION "Enables higher speed by always driving clock&data lines (no tristate) and by outputting data on falling clk edge without delay."
+add_parameter sequencer INTEGER 0
+set_parameter_property sequencer DEFAULT_VALUE 0
+set_parameter_property sequencer DISPLAY_NAME "Register list sequencer"
+set_parameter_property sequencer DISPLAY_HINT boolean
+set_parameter_property sequencer TYPE INTEGER
+set_parameter_property sequencer UNITS None
+set_parameter_property sequencer HDL_PARAMETER true
+set_parameter_property sequencer DESCRIPTION "Adds a sequencer which executes register write/delay/poll lists from local RAM without CPU involvement."
 
 # 
 # display items
@@ -145,7 +155,7 @@ set_interface_property avalon_slave_0 PORT_NAME_MAP ""
 set_interface_property avalon_slave_0 CMSIS_SVD_VARIABLES ""
 set_interface_property avalon_slave_0 SVD_ADDRESS_GROUP ""
 
-add_interface_port avalon_slave_0 wb_adr_i address Input 3
+add_interface_port avalon_slave_0 wb_adr_i address Input 4
 add_interface_port avalon_slave_0 wb_dat_i writedata Input 8
 add_interface_port avalon_slave_0 wb_dat_o readdata Output 8
 add_interface_port avalon_slave_0 wb_we_i write Input 1
@@ -0,0 +1,319 @@
+//
+// Register list sequencer for i2c_opencores
+//
+// Executes a list of I2C register writes, delays and register polls from
+// local RAM by driving the command/transmit registers of i2c_master_top
+// through its wishbone port, i.e. exactly like the CPU would do.
+//
+// List entries are 4 bytes each:
+//   byte0[7:6]  op: 0=WRITE, 1=DELAY, 2=POLL, 3=END
+//   byte0[0]    POLL: wait until (reg & mask) == 0 instead of != 0
+//   WRITE:      byte1=dev addr (7-bit), byte2=reg, byte3=value
+//   DELAY:      {byte1,byte2,byte3} = delay in units of 256 clock cycles
+//   POLL:       byte1=dev addr (7-bit), byte2=reg, byte3=mask
+//
+// Registers (offset from sequencer base, word addressed):
+//   0  W: [0]=start, [1]=irq enable, [2]=clear done
+//      R: [0]=busy, [1]=done, [2]=nack error, [3]=poll timeout, [4]=irq enable
+//   1  RW: list RAM byte pointer for loading
+//   2  W: list RAM data, pointer is incremented after each write
+//   3  R: index of current (or failed) list entry
+//
+
+module i2c_seq #(
+    parameter ENTRY_AW = 6
+) (
+    input clk,
+    input reset,
+    // CPU register interface
+    input [1:0] reg_adr,
+    input [7:0] reg_dat_i,
+    output reg [7:0] reg_dat_o,
+    input reg_we,
+    // wishbone master towards i2c_master_top
+    output reg [2:0] m_adr,
+    output reg [7:0] m_dat_o,
+    input [7:0] m_dat_i,
+    output reg m_we,
+    output reg m_stb,
+    input m_ack,
+    output busy,
+    output irq
+);
+
+localparam OP_WRITE = 2'h0;
+localparam OP_DELAY = 2'h1;
+localparam OP_POLL  = 2'h2;
+localparam OP_END   = 2'h3;
+
+localparam CR_STA   = 8'h80;
+localparam CR_STO   = 8'h40;
+localparam CR_RD    = 8'h20;
+localparam CR_WR    = 8'h10;
+localparam CR_NACK  = 8'h08;
+localparam CR_IACK  = 8'h01;
+
+localparam SR_RXNACK_BIT = 7;
+localparam SR_TIP_BIT = 1;
+localparam SR_IF_BIT = 0;
+
+localparam S_IDLE       = 4'h0;
+localparam S_FETCH      = 4'h1;
+localparam S_DECODE     = 4'h2;
+localparam S_TXR        = 4'h3;
+localparam S_CR         = 4'h4;
+localparam S_POLL       = 4'h5;
+localparam S_CHECK      = 4'h6;
+localparam S_RXR        = 4'h7;
+localparam S_STOP       = 4'h8;
+localparam S_STOP_POLL  = 4'h9;
+localparam S_DELAY      = 4'ha;
+localparam S_NEXT       = 4'hb;
+localparam S_FINISH     = 4'hc;
+
+localparam POLL_RETRIES = 8'd255;
+
+// list RAM, one bank per entry byte so that an entry can be fetched at once
+reg [7:0] ram0[0:(1<<ENTRY_AW)-1] /* synthesis ramstyle = "logic" */;
+reg [7:0] ram1[0:(1<<ENTRY_AW)-1] /* synthesis ramstyle = "logic" */;
+reg [7:0] ram2[0:(1<<ENTRY_AW)-1] /* synthesis ramstyle = "logic" */;
+reg [7:0] ram3[0:(1<<ENTRY_AW)-1] /* synthesis ramstyle = "logic" */;
+
+reg [ENTRY_AW+1:0] load_ptr;
+reg [ENTRY_AW-1:0] pos;
+reg [7:0] e_op, e_dev, e_reg, e_val;
+
+reg [3:0] state;
+reg [1:0] step;
+reg [7:0] sr;
+reg [7:0] poll_cnt;
+reg [31:0] delay_cnt;
+reg done, err_nack, err_timeout, ien;
+
+wire [1:0] op = e_op[7:6];
+
+// byte transfer for current step
+reg [7:0] byte_txr, byte_cr;
+reg byte_has_txr, byte_last, byte_rd;
+
+always @(*) begin
+    byte_txr = 8'h00;
+    byte_cr = 8'h00;
+    byte_has_txr = 1'b1;
+    byte_last = 1'b0;
+    byte_rd = 1'b0;
+
+    case (step)
+        2'h0: begin
+            byte_txr = {e_dev[6:0], 1'b0};
+            byte_cr = CR_STA|CR_WR;
+        end
+        2'h1: begin
+            byte_txr = e_reg;
+            byte_cr = CR_WR;
+        end
+        2'h2: begin
+            if (op == OP_WRITE) begin
+                byte_txr = e_val;
+                byte_cr = CR_WR|CR_STO;
+                byte_last = 1'b1;
+            end else begin
+                byte_txr = {e_dev[6:0], 1'b1};
+                byte_cr = CR_STA|CR_WR;
+            end
+        end
+        default: begin
+            byte_has_txr = 1'b0;
+            byte_cr = CR_RD|CR_NACK|CR_STO;
+            byte_last = 1'b1;
+            byte_rd = 1'b1;
+        end
+    endcase
+end
+
+assign busy = (state != S_IDLE);
+assign irq = ien & done;
+
+wire poll_match = e_op[0] ? ((m_dat_i & e_val) == 8'h00) : ((m_dat_i & e_val) != 8'h00);
+
+// CPU register access
+always @(posedge clk or posedge reset) begin
+    if (reset) begin
+        load_ptr <= 0;
+    end else if (reg_we) begin
+        if (reg_adr == 2'h1)
+            load_ptr <= reg_dat_i;
+        else if (reg_adr == 2'h2)
+            load_ptr <= load_ptr + 1'b1;
+    end
+end
+
+always @(posedge clk) begin
+    if (reg_we && (reg_adr == 2'h2)) begin
+        case (load_ptr[1:0])
+            2'h0: ram0[load_ptr[ENTRY_AW+1:2]] <= reg_dat_i;
+            2'h1: ram1[load_ptr[ENTRY_AW+1:2]] <= reg_dat_i;
+            2'h2: ram2[load_ptr[ENTRY_AW+1:2]] <= reg_dat_i;
+            default: ram3[load_ptr[ENTRY_AW+1:2]] <= reg_dat_i;
+        endcase
+    end
+end
+
+always @(*) begin
+    case (reg_adr)
+        2'h0: reg_dat_o = {3'h0, ien, err_timeout, err_nack, done, busy};
+        2'h1: reg_dat_o = load_ptr;
+        2'h3: reg_dat_o = pos;
+        default: reg_dat_o = 8'h00;
+    endcase
+end
+
+// wishbone master signals for current state
+always @(*) begin
+    m_adr = 3'h4;
+    m_dat_o = byte_cr;
+    m_we = 1'b0;
+
+    case (state)
+        S_TXR: begin
+            m_adr = 3'h3;
+            m_dat_o = byte_txr;
+            m_we = 1'b1;
+        end
+        S_CR: begin
+            m_we = 1'b1;
+        end
+        S_RXR: begin
+            m_adr = 3'h3;
+        end
+        S_STOP: begin
+            m_dat_o = CR_STO|CR_IACK;
+            m_we = 1'b1;
+        end
+        default: ;
+    endcase
+end
+
+wire m_done = m_stb & m_ack;
+
+always @(posedge clk or posedge reset) begin
+    if (reset) begin
+        state <= S_IDLE;
+        m_stb <= 1'b0;
+        pos <= 0;
+        step <= 0;
+        done <= 1'b0;
+        err_nack <= 1'b0;
+        err_timeout <= 1'b0;
+        ien <= 1'b0;
+    end else begin
+        if (reg_we && (reg_adr == 2'h0)) begin
+            ien <= reg_dat_i[1];
+            if (reg_dat_i[2])
+                done <= 1'b0;
+        end
+
+        case (state)
+            S_IDLE: begin
+                if (reg_we && (reg_adr == 2'h0) && reg_dat_i[0]) begin
+                    pos <= 0;
+                    done <= 1'b0;
+                    err_nack <= 1'b0;
+                    err_timeout <= 1'b0;
+                    state <= S_FETCH;
+                end
+            end
+            S_FETCH: begin
+                e_op <= ram0[pos];
+                e_dev <= ram1[pos];
+                e_reg <= ram2[pos];
+                e_val <= ram3[pos];
+                state <= S_DECODE;
+            end
+            S_DECODE: begin
+                step <= 0;
+                poll_cnt <= 0;
+                case (op)
+                    OP_WRITE,
+                    OP_POLL:  state <= S_TXR;
+                    OP_DELAY: begin
+                        delay_cnt <= {e_dev, e_reg, e_val, 8'h00};
+                        state <= S_DELAY;
+                    end
+                    default:  state <= S_FINISH;
+                endcase
+            end
+            S_TXR,
+            S_CR,
+            S_POLL,
+            S_RXR,
+            S_STOP,
+            S_STOP_POLL: begin
+                m_stb <= ~m_done;
+                if (m_done) begin
+                    case (state)
+                        S_TXR: state <= S_CR;
+                        S_CR: state <= S_POLL;
+                        S_POLL: begin
+                            sr <= m_dat_i;
+                            if (!m_dat_i[SR_TIP_BIT])
+                                state <= S_CHECK;
+                        end
+                        S_RXR: begin
+                            if (poll_match) begin
+                                state <= S_NEXT;
+                            end else if (poll_cnt == POLL_RETRIES) begin
+                                err_timeout <= 1'b1;
+                                state <= S_FINISH;
+                            end else begin
+                                poll_cnt <= poll_cnt + 1'b1;
+                                step <= 0;
+                                state <= S_TXR;
+                            end
+                        end
+                        S_STOP: state <= S_STOP_POLL;
+                        default: begin
+                            // standalone stop does not set TIP, wait for its completion flag
+                            if (m_dat_i[SR_IF_BIT])
+                                state <= S_FINISH;
+                        end
+                    endcase
+                end
+            end
+            S_CHECK: begin
+                if (!byte_rd && sr[SR_RXNACK_BIT]) begin
+                    err_nack <= 1'b1;
+                    // stop condition was already issued with last byte
+                    state <= byte_last ? S_FINISH : S_STOP;
+                end else if (byte_last) begin
+                    state <= (op == OP_POLL) ? S_RXR : S_NEXT;
+                end else begin
+                    step <= step + 1'b1;
+                    state <= (step == 2'h2) ? S_CR : S_TXR;
+                end
+            end
+            S_DELAY: begin
+                if (delay_cnt == 0)
+                    state <= S_NEXT;
+                else
+                    delay_cnt <= delay_cnt - 1'b1;
+            end
+            S_NEXT: begin
+                if (pos == {ENTRY_AW{1'b1}}) begin
+                    state <= S_FINISH;
+                end else begin
+                    pos <= pos + 1'b1;
+                    state <= S_FETCH;
+                end
+            end
+            S_FINISH: begin
+                m_stb <= 1'b0;
+                done <= 1'b1;
+                state <= S_IDLE;
+            end
+            default: state <= S_IDLE;
+        endcase
+    end
+end
+
+endmodule
@@ -74,4 +74,24 @@
 #define I2C_OPENCORES_SR_IF_MSK              (0x1)
 #define I2C_OPENCORES_SR_IF_OFST             (0)
 
+/* register list sequencer (sequencer=1) */
+#define IOADDR_I2C_OPENCORES_SEQ_CTRL(base)   __IO_CALC_ADDRESS_NATIVE(base, 8)
+#define IORD_I2C_OPENCORES_SEQ_STATUS(base)   IORD(base, 8)
+#define IOWR_I2C_OPENCORES_SEQ_CTRL(base, data) IOWR(base, 8, data)
+#define I2C_OPENCORES_SEQ_CTRL_START_MSK      (0x1)
+#define I2C_OPENCORES_SEQ_CTRL_IEN_MSK        (0x2)
+#define I2C_OPENCORES_SEQ_CTRL_IACK_MSK       (0x4)
+#define I2C_OPENCORES_SEQ_SR_BUSY_MSK         (0x1)
+#define I2C_OPENCORES_SEQ_SR_DONE_MSK         (0x2)
+#define I2C_OPENCORES_SEQ_SR_NACK_MSK         (0x4)
+#define I2C_OPENCORES_SEQ_SR_TIMEOUT_MSK      (0x8)
+#define I2C_OPENCORES_SEQ_SR_IEN_MSK          (0x10)
+#define IOADDR_I2C_OPENCORES_SEQ_PTR(base)    __IO_CALC_ADDRESS_NATIVE(base, 9)
+#define IORD_I2C_OPENCORES_SEQ_PTR(base)      IORD(base, 9)
+#define IOWR_I2C_OPENCORES_SEQ_PTR(base, data) IOWR(base, 9, data)
+#define IOADDR_I2C_OPENCORES_SEQ_DATA(base)   __IO_CALC_ADDRESS_NATIVE(base, 10)
+#define IOWR_I2C_OPENCORES_SEQ_DATA(base, data) IOWR(base, 10, data)
+#define IOADDR_I2C_OPENCORES_SEQ_POS(base)    __IO_CALC_ADDRESS_NATIVE(base, 11)
+#define IORD_I2C_OPENCORES_SEQ_POS(base)      IORD(base, 11)
+
 #endif /* __I2C_OPENCORES_REGS_H__ */
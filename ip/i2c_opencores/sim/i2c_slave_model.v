@@ -0,0 +1,174 @@
+//
+// Behavioural I2C slave for simulation
+//
+// 256-byte register map with auto-incrementing register pointer: first byte
+// of a write transaction sets the pointer, following bytes are written to
+// consecutive registers. Reads return registers from current pointer.
+//
+// Bits STATUS_MASK of register STATUS_REG are set at start and get cleared
+// after STATUS_READS reads of that register, e.g. to model PLL lock status.
+//
+
+`timescale 1ns / 10ps
+
+module i2c_slave_model #(
+    parameter [6:0] ADDR = 7'h60,
+    parameter [7:0] STATUS_REG = 8'h00,
+    parameter [7:0] STATUS_MASK = 8'h00,
+    parameter STATUS_READS = 0
+) (
+    inout scl,
+    inout sda
+);
+
+localparam ST_IDLE  = 3'h0;
+localparam ST_ADDR  = 3'h1;
+localparam ST_AACK  = 3'h2;
+localparam ST_WDATA = 3'h3;
+localparam ST_WACK  = 3'h4;
+localparam ST_RDATA = 3'h5;
+localparam ST_RACK  = 3'h6;
+
+reg [7:0] mem[0:255];
+reg [7:0] ptr;
+reg [7:0] sr;
+reg [3:0] bitcnt;
+reg [2:0] state;
+reg rw, first, master_nack;
+reg sda_o;
+
+// transaction statistics for testbench checks
+integer start_cnt, stop_cnt, wbyte_cnt, status_rd_cnt, status_reads_left;
+
+assign sda = sda_o ? 1'bz : 1'b0;
+
+integer i;
+initial begin
+    for (i=0; i<256; i=i+1)
+        mem[i] = 8'h00;
+    mem[STATUS_REG] = STATUS_MASK;
+    status_reads_left = STATUS_READS;
+    state = ST_IDLE;
+    sda_o = 1'b1;
+    ptr = 8'h00;
+    start_cnt = 0;
+    stop_cnt = 0;
+    wbyte_cnt = 0;
+    status_rd_cnt = 0;
+end
+
+task load_rdata;
+begin
+    sr = mem[ptr];
+    if (ptr == STATUS_REG) begin
+        status_rd_cnt = status_rd_cnt + 1;
+        if (status_reads_left > 0) begin
+            status_reads_left = status_reads_left - 1;
+            if (status_reads_left == 0)
+                mem[STATUS_REG] = mem[STATUS_REG] & ~STATUS_MASK;
+        end
+    end
+    ptr = ptr + 1'b1;
+    bitcnt = 0;
+    sda_o = sr[7];
+end
+endtask
+
+// (repeated) start and stop conditions
+always @(negedge sda) begin
+    if (scl === 1'b1) begin
+        start_cnt = start_cnt + 1;
+        state = ST_ADDR;
+        bitcnt = 0;
+        sda_o = 1'b1;
+    end
+end
+
+always @(posedge sda) begin
+    if (scl === 1'b1) begin
+        stop_cnt = stop_cnt + 1;
+        state = ST_IDLE;
+        sda_o = 1'b1;
+    end
+end
+
+// sample on rising SCL
+always @(posedge scl) begin
+    case (state)
+        ST_ADDR,
+        ST_WDATA: begin
+            sr = {sr[6:0], (sda !== 1'b0)};
+            bitcnt = bitcnt + 1'b1;
+        end
+        ST_RDATA: bitcnt = bitcnt + 1'b1;
+        ST_RACK:  master_nack = (sda !== 1'b0);
+        default: ;
+    endcase
+end
+
+// drive on falling SCL
+always @(negedge scl) begin
+    case (state)
+        ST_ADDR: begin
+            if (bitcnt == 8) begin
+                if (sr[7:1] == ADDR) begin
+                    rw = sr[0];
+                    sda_o = 1'b0;
+                    state = ST_AACK;
+                end else begin
+                    state = ST_IDLE;
+                end
+            end
+        end
+        ST_AACK: begin
+            if (rw) begin
+                state = ST_RDATA;
+                load_rdata;
+            end else begin
+                sda_o = 1'b1;
+                bitcnt = 0;
+                first = 1'b1;
+                state = ST_WDATA;
+            end
+        end
+        ST_WDATA: begin
+            if (bitcnt == 8) begin
+                if (first) begin
+                    ptr = sr;
+                end else begin
+                    mem[ptr] = sr;
+                    ptr = ptr + 1'b1;
+                    wbyte_cnt = wbyte_cnt + 1;
+                end
+                first = 1'b0;
+                sda_o = 1'b0;
+                state = ST_WACK;
+            end
+        end
+        ST_WACK: begin
+            sda_o = 1'b1;
+            bitcnt = 0;
+            state = ST_WDATA;
+        end
+        ST_RDATA: begin
+            if (bitcnt == 8) begin
+                sda_o = 1'b1;
+                state = ST_RACK;
+            end else begin
+                sda_o = sr[7-bitcnt];
+            end
+        end
+        ST_RACK: begin
+            if (master_nack) begin
+                sda_o = 1'b1;
+                state = ST_IDLE;
+            end else begin
+                state = ST_RDATA;
+                load_rdata;
+            end
+        end
+        default: ;
+    endcase
+end
+
+endmodule
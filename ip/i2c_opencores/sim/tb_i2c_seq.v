@@ -0,0 +1,270 @@
+//
+// Testbench for i2c_opencores register list sequencer
+//
+// Runs the Si5351 PLLA/MS0 update list used by firmware against a behavioural
+// slave, and checks NACK, poll timeout and delay handling as well as CPU
+// access to the core once the sequencer has finished.
+//
+
+`timescale 1ns / 10ps
+
+module tb_i2c_seq;
+
+localparam CLK_PERIOD = 10;
+localparam PRESCALE = 19;           // SCL = 100MHz / (5*(PRESCALE+1)) = 1MHz
+
+localparam [6:0] SI_ADDR = 7'h60;
+localparam [7:0] SI_REG_STATUS = 8'd0;
+localparam [7:0] SI_REG_MSNA = 8'd26;
+localparam [7:0] SI_REG_MS0 = 8'd42;
+localparam [7:0] SI_REG_PLL_RESET = 8'd177;
+localparam [7:0] SI_STATUS_LOL_A = 8'h20;
+
+// core registers
+localparam REG_PRERLO   = 4'h0;
+localparam REG_PRERHI   = 4'h1;
+localparam REG_CTR      = 4'h2;
+localparam REG_TXR      = 4'h3;
+localparam REG_CR_SR    = 4'h4;
+localparam REG_SEQ_CTRL = 4'h8;
+localparam REG_SEQ_PTR  = 4'h9;
+localparam REG_SEQ_DATA = 4'ha;
+localparam REG_SEQ_POS  = 4'hb;
+
+localparam SEQ_BUSY     = 8'h01;
+localparam SEQ_DONE     = 8'h02;
+localparam SEQ_NACK     = 8'h04;
+localparam SEQ_TIMEOUT  = 8'h08;
+
+reg clk = 1'b0;
+reg rst = 1'b1;
+reg [3:0] wb_adr = 4'h0;
+reg [7:0] wb_dat_w = 8'h00;
+reg wb_we = 1'b0;
+reg wb_stb = 1'b0;
+wire [7:0] wb_dat_r;
+wire wb_ack, wb_inta;
+
+wire scl, sda;
+pullup(scl);
+pullup(sda);
+
+always #(CLK_PERIOD/2) clk = ~clk;
+
+i2c_opencores #(
+    .sequencer(1)
+) dut (
+    .wb_clk_i(clk),
+    .wb_rst_i(rst),
+    .wb_adr_i(wb_adr),
+    .wb_dat_i(wb_dat_w),
+    .wb_dat_o(wb_dat_r),
+    .wb_we_i(wb_we),
+    .wb_stb_i(wb_stb),
+    .wb_ack_o(wb_ack),
+    .wb_inta_o(wb_inta),
+    .scl_pad_io(scl),
+    .sda_pad_io(sda),
+    .spi_miso_pad_i(1'b0)
+);
+
+i2c_slave_model #(
+    .ADDR(SI_ADDR),
+    .STATUS_REG(SI_REG_STATUS),
+    .STATUS_MASK(SI_STATUS_LOL_A),
+    .STATUS_READS(2)
+) si (
+    .scl(scl),
+    .sda(sda)
+);
+
+integer errors = 0;
+integer i, t_start, t_done, stop_prev;
+reg [7:0] rdata;
+reg [7:0] list[0:255];
+integer list_len;
+reg [7:0] msna[0:7];
+reg [7:0] ms0[0:7];
+
+task check(input cond, input [8*48-1:0] msg);
+begin
+    if (!cond) begin
+        $display("FAIL: %0s", msg);
+        errors = errors + 1;
+    end
+end
+endtask
+
+task wb_write(input [3:0] adr, input [7:0] dat);
+begin
+    @(posedge clk);
+    wb_adr <= adr;
+    wb_dat_w <= dat;
+    wb_we <= 1'b1;
+    wb_stb <= 1'b1;
+    @(posedge clk);
+    while (!wb_ack)
+        @(posedge clk);
+    wb_stb <= 1'b0;
+    wb_we <= 1'b0;
+end
+endtask
+
+task wb_read(input [3:0] adr, output [7:0] dat);
+begin
+    @(posedge clk);
+    wb_adr <= adr;
+    wb_we <= 1'b0;
+    wb_stb <= 1'b1;
+    @(posedge clk);
+    while (!wb_ack)
+        @(posedge clk);
+    dat = wb_dat_r;
+    wb_stb <= 1'b0;
+end
+endtask
+
+// list construction, see i2c_seq.v for entry format
+task put_entry(input [7:0] b0, input [7:0] b1, input [7:0] b2, input [7:0] b3);
+begin
+    list[list_len] = b0;
+    list[list_len+1] = b1;
+    list[list_len+2] = b2;
+    list[list_len+3] = b3;
+    list_len = list_len + 4;
+end
+endtask
+
+task seq_load;
+    integer j;
+begin
+    wb_write(REG_SEQ_PTR, 8'h00);
+    for (j=0; j<list_len; j=j+1)
+        wb_write(REG_SEQ_DATA, list[j]);
+end
+endtask
+
+task seq_wait(output [7:0] status);
+begin
+    status = SEQ_BUSY;
+    while (status & SEQ_BUSY)
+        wb_read(REG_SEQ_CTRL, status);
+end
+endtask
+
+// CPU driven single register write, as I2C_start()/I2C_write() in HAL
+task cpu_tx(input [7:0] data, input [7:0] cmd);
+    reg [7:0] sr;
+begin
+    wb_write(REG_TXR, data);
+    wb_write(REG_CR_SR, cmd);
+    sr = 8'h02;
+    while (sr & 8'h02)
+        wb_read(REG_CR_SR, sr);
+end
+endtask
+
+initial begin
+    repeat (4) @(posedge clk);
+    rst <= 1'b0;
+
+    wb_write(REG_CTR, 8'h00);
+    wb_write(REG_PRERLO, PRESCALE & 8'hff);
+    wb_write(REG_PRERHI, PRESCALE >> 8);
+    wb_write(REG_CTR, 8'h80);
+
+    // Si5351 PLLA/MS0 parameter update followed by PLLA reset and lock wait
+    for (i=0; i<8; i=i+1) begin
+        msna[i] = 8'h10 + i;
+        ms0[i] = 8'h90 + i;
+    end
+    list_len = 0;
+    for (i=0; i<8; i=i+1)
+        put_entry(8'h00, SI_ADDR, SI_REG_MSNA+i, msna[i]);
+    for (i=0; i<8; i=i+1)
+        put_entry(8'h00, SI_ADDR, SI_REG_MS0+i, ms0[i]);
+    put_entry(8'h00, SI_ADDR, SI_REG_PLL_RESET, 8'h20);
+    put_entry(8'h81, SI_ADDR, SI_REG_STATUS, SI_STATUS_LOL_A);
+    put_entry(8'hc0, 8'h00, 8'h00, 8'h00);
+    seq_load;
+
+    wb_write(REG_SEQ_CTRL, 8'h03);
+    // CPU access to core is ignored while sequencer is busy
+    wb_write(REG_TXR, 8'hff);
+    wb_write(REG_CR_SR, 8'h90);
+    wb_read(REG_CR_SR, rdata);
+    check(rdata == 8'h00, "core visible to CPU during sequence");
+    seq_wait(rdata);
+
+    check(rdata == (8'h10|SEQ_DONE), "Si5351 list status");
+    check(wb_inta, "done IRQ not raised");
+    for (i=0; i<8; i=i+1) begin
+        check(si.mem[SI_REG_MSNA+i] == msna[i], "MSNA register mismatch");
+        check(si.mem[SI_REG_MS0+i] == ms0[i], "MS0 register mismatch");
+    end
+    check(si.mem[SI_REG_PLL_RESET] == 8'h20, "PLL reset not written");
+    check(si.wbyte_cnt == 17, "unexpected number of written bytes");
+    check(si.status_rd_cnt == 3, "LOL poll count");
+    wb_read(REG_SEQ_POS, rdata);
+    check(rdata == 18, "list position after END");
+
+    wb_write(REG_SEQ_CTRL, 8'h04);
+    @(posedge clk);
+    check(!wb_inta, "IRQ not cleared");
+
+    // NACK aborts list and releases bus
+    list_len = 0;
+    put_entry(8'h00, SI_ADDR+1, 8'h05, 8'haa);
+    put_entry(8'h00, SI_ADDR, 8'h05, 8'haa);
+    put_entry(8'hc0, 8'h00, 8'h00, 8'h00);
+    seq_load;
+    stop_prev = si.stop_cnt;
+    wb_write(REG_SEQ_CTRL, 8'h01);
+    seq_wait(rdata);
+    check(rdata == (SEQ_DONE|SEQ_NACK), "NACK status");
+    wb_read(REG_SEQ_POS, rdata);
+    check(rdata == 0, "NACK position");
+    check(si.mem[5] == 8'h00, "write after NACK executed");
+    check(si.stop_cnt == stop_prev+1, "no stop after NACK");
+
+    // core is usable by CPU right after sequencer
+    cpu_tx({SI_ADDR, 1'b0}, 8'h90);
+    cpu_tx(8'h05, 8'h10);
+    cpu_tx(8'h55, 8'h50);
+    check(si.mem[5] == 8'h55, "CPU write after sequence");
+
+    // poll timeout
+    list_len = 0;
+    put_entry(8'h80, SI_ADDR, 8'h01, 8'h01);
+    put_entry(8'hc0, 8'h00, 8'h00, 8'h00);
+    seq_load;
+    wb_write(REG_SEQ_CTRL, 8'h01);
+    seq_wait(rdata);
+    check(rdata == (SEQ_DONE|SEQ_TIMEOUT), "poll timeout status");
+
+    // delay
+    list_len = 0;
+    put_entry(8'h40, 8'h00, 8'h00, 8'd100);
+    put_entry(8'hc0, 8'h00, 8'h00, 8'h00);
+    seq_load;
+    wb_write(REG_SEQ_CTRL, 8'h01);
+    t_start = $time;
+    seq_wait(rdata);
+    t_done = $time;
+    check(rdata == SEQ_DONE, "delay status");
+    check(((t_done-t_start)/CLK_PERIOD >= 100*256) && ((t_done-t_start)/CLK_PERIOD < 100*256+32), "delay length");
+
+    if (errors == 0)
+        $display("PASS");
+    else
+        $display("FAILED with %0d errors", errors);
+    $finish;
+end
+
+initial begin
+    #50000000;
+    $display("FAIL: simulation timeout");
+    $finish;
+end
+
+endmodule
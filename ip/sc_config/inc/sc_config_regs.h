@@ -42,14 +42,52 @@ typedef union {
 
 typedef union {
     struct {
-        uint16_t lt_lat_result:16;
-        uint16_t lt_stb_result:12;
+        uint16_t lt_lat_lines:16;
+        uint16_t lt_lat_pixels:12;
         uint8_t lt_rsv:3;
         uint8_t lt_finished:1;
     } __attribute__((packed, __may_alias__));
     uint32_t data;
 } lt_status_reg;
 
+typedef union {
+    struct {
+        uint16_t h_period_x16:16;
+        uint16_t h_synclen_x16:13;
+        uint8_t h_polarity:1;
+        uint8_t v_polarity:1;
+        uint8_t meas_valid:1;
+    } __attribute__((packed, __may_alias__));
+    uint32_t data;
+} sync_meas_reg;
+
+typedef union {
+    struct {
+        uint16_t v_total_f0:11;
+        uint16_t v_total_f1:11;
+        uint8_t v_synclen:5;
+        uint8_t meas_rsv:5;
+    } __attribute__((packed, __may_alias__));
+    uint32_t data;
+} sync_meas2_reg;
+
+typedef union {
+    struct {
+        uint32_t cnt:24;
+        uint8_t pclk_rsv:8;
+    } __attribute__((packed, __may_alias__));
+    uint32_t data;
+} pclk_meas_reg;
+
+typedef union {
+    struct {
+        uint8_t lb_lines;
+        uint8_t lb_packed:1;
+        uint32_t caps_rsv:23;
+    } __attribute__((packed, __may_alias__));
+    uint32_t data;
+} sc_caps_reg;
+
 typedef union {
     struct {
         uint16_t h_total:12;
@@ -96,7 +134,7 @@ typedef union {
         int8_t y_start_lb:6;
         uint8_t x_rpt:3;
         uint8_t y_rpt:3;
-        uint8_t xy_rsv:2;
+        int8_t y_start_lb_hi:2;
     } __attribute__((packed, __may_alias__));
     uint32_t data;
 } xy_config2_reg;
@@ -109,7 +147,8 @@ typedef union {
         uint8_t lm_deint_mode:1;
         uint8_t nir_even_offset:1;
         uint8_t ypbpr_cs:1;
-        uint32_t misc_rsv:17;
+        uint8_t fb_enable:1;
+        uint32_t misc_rsv:16;
     } __attribute__((packed, __may_alias__));
     uint32_t data;
 } misc_config_reg;
@@ -135,6 +174,47 @@ typedef union {
     uint32_t data;
 } sl_config2_reg;
 
+typedef union {
+    struct {
+        uint32_t hscale_step:17;
+        uint16_t hscale_phase0:12;
+        uint8_t hscale_rsv:2;
+        uint8_t hscale_enable:1;
+    } __attribute__((packed, __may_alias__));
+    uint32_t data;
+} hscale_config_reg;
+
+typedef union {
+    struct {
+        int16_t coef:10;
+        uint8_t coef_rsv:6;
+        uint8_t tap:2;
+        uint8_t tap_rsv:2;
+        uint8_t phase:4;
+        uint8_t phase_rsv:8;
+    } __attribute__((packed, __may_alias__));
+    uint32_t data;
+} hscale_coef_reg;
+
+typedef union {
+    struct {
+        uint32_t vscale_step:17;
+        uint16_t vscale_phase0:12;
+        uint8_t vscale_rsv:2;
+        uint8_t vscale_enable:1;
+    } __attribute__((packed, __may_alias__));
+    uint32_t data;
+} vscale_config_reg;
+
+typedef union {
+    struct {
+        uint8_t lt_arm:1;
+        uint8_t lt_mode:2;
+        uint32_t lt_rsv:29;
+    } __attribute__((packed, __may_alias__));
+    uint32_t data;
+} lt_config_reg;
+
 typedef struct {
     fe_status_reg fe_status;
     fe_status2_reg fe_status2;
@@ -150,6 +230,17 @@ typedef struct {
     misc_config_reg misc_config;
     sl_config_reg sl_config;
     sl_config2_reg sl_config2;
+    sync_meas_reg sync_meas;
+    sync_meas2_reg sync_meas2;
+    pclk_meas_reg pclk_isl_meas;
+    pclk_meas_reg pclk_hdmirx_meas;
+    pclk_meas_reg pclk_out_meas;
+    sc_caps_reg sc_caps;
+    hscale_config_reg hscale_config;
+    hscale_coef_reg hscale_coef;
+    vscale_config_reg vscale_config;
+    uint32_t frame_crc;
+    lt_config_reg lt_config;
 } __attribute__((packed, __may_alias__)) sc_regs;
 
 #endif //SC_CONFIG_REGS_H_
@@ -100,7 +100,7 @@ set_interface_property avalon_s PORT_NAME_MAP ""
 set_interface_property avalon_s CMSIS_SVD_VARIABLES ""
 set_interface_property avalon_s SVD_ADDRESS_GROUP ""
 
-add_interface_port avalon_s avalon_s_address address Input 4
+add_interface_port avalon_s avalon_s_address address Input 5
 add_interface_port avalon_s avalon_s_writedata writedata Input 32
 add_interface_port avalon_s avalon_s_readdata readdata Output 32
 add_interface_port avalon_s avalon_s_byteenable byteenable Input 4
@@ -146,6 +146,13 @@ set_interface_property sc_if SVD_ADDRESS_GROUP ""
 add_interface_port sc_if fe_status_i fe_status_i Input 32
 add_interface_port sc_if fe_status2_i fe_status2_i Input 32
 add_interface_port sc_if lt_status_i lt_status_i Input 32
+add_interface_port sc_if sync_meas_i sync_meas_i Input 32
+add_interface_port sc_if sync_meas2_i sync_meas2_i Input 32
+add_interface_port sc_if pclk_isl_meas_i pclk_isl_meas_i Input 32
+add_interface_port sc_if pclk_hdmirx_meas_i pclk_hdmirx_meas_i Input 32
+add_interface_port sc_if pclk_out_meas_i pclk_out_meas_i Input 32
+add_interface_port sc_if sc_caps_i sc_caps_i Input 32
+add_interface_port sc_if frame_crc_i frame_crc_i Input 32
 add_interface_port sc_if hv_in_config_o hv_in_config_o Output 32
 add_interface_port sc_if hv_in_config2_o hv_in_config2_o Output 32
 add_interface_port sc_if hv_in_config3_o hv_in_config3_o Output 32
@@ -157,3 +164,8 @@ add_interface_port sc_if xy_out_config2_o xy_out_config2_o Output 32
 add_interface_port sc_if misc_config_o misc_config_o Output 32
 add_interface_port sc_if sl_config_o sl_config_o Output 32
 add_interface_port sc_if sl_config2_o sl_config2_o Output 32
+add_interface_port sc_if hscale_config_o hscale_config_o Output 32
+add_interface_port sc_if hscale_coef_o hscale_coef_o Output 32
+add_interface_port sc_if hscale_coef_we_o hscale_coef_we_o Output 1
+add_interface_port sc_if vscale_config_o vscale_config_o Output 32
+add_interface_port sc_if lt_config_o lt_config_o Output 32
@@ -24,7 +24,7 @@ module sc_config_top(
     // avalon slave
     input [31:0] avalon_s_writedata,
     output reg [31:0] avalon_s_readdata,
-    input [3:0] avalon_s_address,
+    input [4:0] avalon_s_address,
     input [3:0] avalon_s_byteenable,
     input avalon_s_write,
     input avalon_s_read,
@@ -34,6 +34,13 @@ module sc_config_top(
     input [31:0] fe_status_i,
     input [31:0] fe_status2_i,
     input [31:0] lt_status_i,
+    input [31:0] sync_meas_i,
+    input [31:0] sync_meas2_i,
+    input [31:0] pclk_isl_meas_i,
+    input [31:0] pclk_hdmirx_meas_i,
+    input [31:0] pclk_out_meas_i,
+    input [31:0] sc_caps_i,
+    input [31:0] frame_crc_i,
     output [31:0] hv_in_config_o,
     output [31:0] hv_in_config2_o,
     output [31:0] hv_in_config3_o,
@@ -44,50 +51,85 @@ module sc_config_top(
     output [31:0] xy_out_config2_o,
     output [31:0] misc_config_o,
     output [31:0] sl_config_o,
-    output [31:0] sl_config2_o
+    output [31:0] sl_config2_o,
+    output [31:0] hscale_config_o,
+    output reg [31:0] hscale_coef_o,
+    output reg hscale_coef_we_o,
+    output [31:0] vscale_config_o,
+    output [31:0] lt_config_o
 );
 
-localparam FE_STATUS_REGNUM =       4'h0;
-localparam FE_STATUS2_REGNUM =      4'h1;
-localparam LT_STATUS_REGNUM =       4'h2;
-localparam HV_IN_CONFIG_REGNUM =    4'h3;
-localparam HV_IN_CONFIG2_REGNUM =   4'h4;
-localparam HV_IN_CONFIG3_REGNUM =   4'h5;
-localparam HV_OUT_CONFIG_REGNUM =   4'h6;
-localparam HV_OUT_CONFIG2_REGNUM =  4'h7;
-localparam HV_OUT_CONFIG3_REGNUM =  4'h8;
-localparam XY_OUT_CONFIG_REGNUM =   4'h9;
-localparam XY_OUT_CONFIG2_REGNUM =  4'ha;
-localparam MISC_CONFIG_REGNUM =     4'hb;
-localparam SL_CONFIG_REGNUM =       4'hc;
-localparam SL_CONFIG2_REGNUM =      4'hd;
+localparam FE_STATUS_REGNUM =       5'h0;
+localparam FE_STATUS2_REGNUM =      5'h1;
+localparam LT_STATUS_REGNUM =       5'h2;
+localparam HV_IN_CONFIG_REGNUM =    5'h3;
+localparam HV_IN_CONFIG2_REGNUM =   5'h4;
+localparam HV_IN_CONFIG3_REGNUM =   5'h5;
+localparam HV_OUT_CONFIG_REGNUM =   5'h6;
+localparam HV_OUT_CONFIG2_REGNUM =  5'h7;
+localparam HV_OUT_CONFIG3_REGNUM =  5'h8;
+localparam XY_OUT_CONFIG_REGNUM =   5'h9;
+localparam XY_OUT_CONFIG2_REGNUM =  5'ha;
+localparam MISC_CONFIG_REGNUM =     5'hb;
+localparam SL_CONFIG_REGNUM =       5'hc;
+localparam SL_CONFIG2_REGNUM =      5'hd;
+localparam SYNC_MEAS_REGNUM =       5'he;
+localparam SYNC_MEAS2_REGNUM =      5'hf;
+localparam PCLK_ISL_MEAS_REGNUM =   5'h10;
+localparam PCLK_HDMIRX_MEAS_REGNUM = 5'h11;
+localparam PCLK_OUT_MEAS_REGNUM =   5'h12;
+localparam SC_CAPS_REGNUM =         5'h13;
+localparam HSCALE_CONFIG_REGNUM =   5'h14;
+localparam HSCALE_COEF_REGNUM =     5'h15;
+localparam VSCALE_CONFIG_REGNUM =   5'h16;
+localparam FRAME_CRC_REGNUM =       5'h17;
+localparam LT_CONFIG_REGNUM =       5'h18;
 
-reg [31:0] config_reg[HV_IN_CONFIG_REGNUM:SL_CONFIG2_REGNUM] /* synthesis ramstyle = "logic" */;
+// writable config registers, status registers in between are read-only
+localparam [LT_CONFIG_REGNUM:0] CONFIG_REG_MASK = ({(SL_CONFIG2_REGNUM-HV_IN_CONFIG_REGNUM+1){1'b1}} << HV_IN_CONFIG_REGNUM) |
+                                                  (1 << HSCALE_CONFIG_REGNUM) |
+                                                  (1 << VSCALE_CONFIG_REGNUM) |
+                                                  (1 << LT_CONFIG_REGNUM);
+
+reg [31:0] config_reg[HV_IN_CONFIG_REGNUM:LT_CONFIG_REGNUM] /* synthesis ramstyle = "logic" */;
 
 assign avalon_s_waitrequest_n = 1'b1;
 
 genvar i;
 generate
-    for (i=HV_IN_CONFIG_REGNUM; i <= SL_CONFIG2_REGNUM; i++) begin : gen_reg
-        always @(posedge clk_i or posedge rst_i) begin
-            if (rst_i) begin
-                config_reg[i] <= 0;
-            end else begin
-                if (avalon_s_chipselect && avalon_s_write && (avalon_s_address==i)) begin
-                    if (avalon_s_byteenable[3])
-                        config_reg[i][31:24] <= avalon_s_writedata[31:24];
-                    if (avalon_s_byteenable[2])
-                        config_reg[i][23:16] <= avalon_s_writedata[23:16];
-                    if (avalon_s_byteenable[1])
-                        config_reg[i][15:8] <= avalon_s_writedata[15:8];
-                    if (avalon_s_byteenable[0])
-                        config_reg[i][7:0] <= avalon_s_writedata[7:0];
+    for (i=HV_IN_CONFIG_REGNUM; i <= LT_CONFIG_REGNUM; i++) begin : gen_reg
+        if (CONFIG_REG_MASK[i]) begin
+            always @(posedge clk_i or posedge rst_i) begin
+                if (rst_i) begin
+                    config_reg[i] <= 0;
+                end else begin
+                    if (avalon_s_chipselect && avalon_s_write && (avalon_s_address==i)) begin
+                        if (avalon_s_byteenable[3])
+                            config_reg[i][31:24] <= avalon_s_writedata[31:24];
+                        if (avalon_s_byteenable[2])
+                            config_reg[i][23:16] <= avalon_s_writedata[23:16];
+                        if (avalon_s_byteenable[1])
+                            config_reg[i][15:8] <= avalon_s_writedata[15:8];
+                        if (avalon_s_byteenable[0])
+                            config_reg[i][7:0] <= avalon_s_writedata[7:0];
+                    end
                 end
             end
         end
     end
 endgenerate
 
+// coefficient writes are forwarded as a single-cycle strobe
+always @(posedge clk_i or posedge rst_i) begin
+    if (rst_i) begin
+        hscale_coef_o <= 0;
+        hscale_coef_we_o <= 1'b0;
+    end else begin
+        hscale_coef_we_o <= avalon_s_chipselect && avalon_s_write && (avalon_s_address==HSCALE_COEF_REGNUM);
+        if (avalon_s_chipselect && avalon_s_write && (avalon_s_address==HSCALE_COEF_REGNUM))
+            hscale_coef_o <= avalon_s_writedata;
+    end
+end
 
 // no readback for config regs -> unused bits optimized out
 always @(*) begin
@@ -96,6 +138,13 @@ always @(*) begin
             FE_STATUS_REGNUM: avalon_s_readdata = fe_status_i;
             FE_STATUS2_REGNUM: avalon_s_readdata = fe_status2_i;
             LT_STATUS_REGNUM: avalon_s_readdata = lt_status_i;
+            SYNC_MEAS_REGNUM: avalon_s_readdata = sync_meas_i;
+            SYNC_MEAS2_REGNUM: avalon_s_readdata = sync_meas2_i;
+            PCLK_ISL_MEAS_REGNUM: avalon_s_readdata = pclk_isl_meas_i;
+            PCLK_HDMIRX_MEAS_REGNUM: avalon_s_readdata = pclk_hdmirx_meas_i;
+            PCLK_OUT_MEAS_REGNUM: avalon_s_readdata = pclk_out_meas_i;
+            SC_CAPS_REGNUM: avalon_s_readdata = sc_caps_i;
+            FRAME_CRC_REGNUM: avalon_s_readdata = frame_crc_i;
             default: avalon_s_readdata = 32'h00000000;
         endcase
     end else begin
@@ -114,5 +163,8 @@ assign xy_out_config2_o = config_reg[XY_OUT_CONFIG2_REGNUM];
 assign misc_config_o = config_reg[MISC_CONFIG_REGNUM];
 assign sl_config_o = config_reg[SL_CONFIG_REGNUM];
 assign sl_config2_o = config_reg[SL_CONFIG2_REGNUM];
+assign hscale_config_o = config_reg[HSCALE_CONFIG_REGNUM];
+assign vscale_config_o = config_reg[VSCALE_CONFIG_REGNUM];
+assign lt_config_o = config_reg[LT_CONFIG_REGNUM];
 
 endmodule
@@ -0,0 +1,83 @@
+//
+// Copyright (C) 2020  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+// Frequency counter for an asynchronous clock. Cycles of meas_clk are
+// counted over a gate of GATE_CYCLES reference clocks. The running count
+// crosses to reference domain in gray code so that a sample taken at any
+// point is off by at most one count.
+
+module clk_meas #(
+    parameter GATE_CYCLES = 270000,
+    parameter CNT_W = 24
+) (
+    input ref_clk,
+    input reset_n,
+    input meas_clk,
+    output reg [CNT_W-1:0] count
+);
+
+function [CNT_W-1:0] gray2bin;
+    input [CNT_W-1:0] g;
+    integer i;
+    begin
+        gray2bin[CNT_W-1] = g[CNT_W-1];
+        for (i=CNT_W-2; i>=0; i=i-1)
+            gray2bin[i] = gray2bin[i+1] ^ g[i];
+    end
+endfunction
+
+// measured clock domain
+reg [CNT_W-1:0] meas_cnt = 0;
+reg [CNT_W-1:0] meas_cnt_gray = 0;
+
+always @(posedge meas_clk) begin
+    meas_cnt <= meas_cnt + 1'b1;
+    meas_cnt_gray <= meas_cnt ^ (meas_cnt >> 1);
+end
+
+// reference clock domain
+reg [CNT_W-1:0] gray_sync1_reg, gray_sync2_reg;
+reg [CNT_W-1:0] cnt_bin, cnt_prev;
+reg [$clog2(GATE_CYCLES)-1:0] gate_ctr;
+
+always @(posedge ref_clk or negedge reset_n) begin
+    if (!reset_n) begin
+        gray_sync1_reg <= 0;
+        gray_sync2_reg <= 0;
+        cnt_bin <= 0;
+        cnt_prev <= 0;
+        gate_ctr <= 0;
+        count <= 0;
+    end else begin
+        gray_sync1_reg <= meas_cnt_gray;
+        gray_sync2_reg <= gray_sync1_reg;
+        cnt_bin <= gray2bin(gray_sync2_reg);
+
+        if (gate_ctr == GATE_CYCLES-1) begin
+            gate_ctr <= 0;
+            count <= cnt_bin - cnt_prev;
+            cnt_prev <= cnt_bin;
+        end else begin
+            gate_ctr <= gate_ctr + 1'b1;
+        end
+    end
+end
+
+endmodule
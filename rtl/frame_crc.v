@@ -0,0 +1,120 @@
+//
+// Copyright (C) 2020  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+// CRC32 signature of active output pixels, computed over R,G,B bytes in
+// that order with the same polynomial logic and bit ordering as hw_crc32,
+// i.e. the result matches a standard CRC32 of the RGB888 byte stream.
+// The value of the completed frame is latched at the start of vsync and
+// handed over to the reference domain with a toggle handshake.
+
+module frame_crc (
+    input PCLK_i,
+    input [7:0] R_i,
+    input [7:0] G_i,
+    input [7:0] B_i,
+    input DE_i,
+    input VSYNC_i,
+    input ref_clk,
+    input reset_n,
+    output reg [31:0] crc_o
+);
+
+localparam CRC_POLY = 32'h04C11DB7;
+localparam CRC_INIT = 32'hFFFFFFFF;
+
+function [7:0] reflect8;
+    input [7:0] d;
+    integer i;
+    begin
+        for (i=0; i<8; i=i+1)
+            reflect8[i] = d[7-i];
+    end
+endfunction
+
+function [31:0] reflect32;
+    input [31:0] d;
+    integer i;
+    begin
+        for (i=0; i<32; i=i+1)
+            reflect32[i] = d[31-i];
+    end
+endfunction
+
+// pixel clock domain
+reg [31:0] crc = CRC_INIT;
+reg [31:0] crc_frame = ~CRC_INIT;
+reg VSYNC_prev = 1'b1;
+reg frame_toggle = 1'b0;
+wire [31:0] crc_r, crc_rg, crc_rgb;
+
+XOR_Shift_Block #(.crc_width(32)) crc_r_block (
+    .block_input(crc),
+    .poly(CRC_POLY),
+    .data_input(reflect8(R_i)),
+    .block_output(crc_r)
+);
+
+XOR_Shift_Block #(.crc_width(32)) crc_g_block (
+    .block_input(crc_r),
+    .poly(CRC_POLY),
+    .data_input(reflect8(G_i)),
+    .block_output(crc_rg)
+);
+
+XOR_Shift_Block #(.crc_width(32)) crc_b_block (
+    .block_input(crc_rg),
+    .poly(CRC_POLY),
+    .data_input(reflect8(B_i)),
+    .block_output(crc_rgb)
+);
+
+always @(posedge PCLK_i) begin
+    VSYNC_prev <= VSYNC_i;
+
+    if (VSYNC_prev & ~VSYNC_i) begin
+        crc_frame <= reflect32(crc) ^ 32'hFFFFFFFF;
+        frame_toggle <= ~frame_toggle;
+        crc <= CRC_INIT;
+    end else if (DE_i) begin
+        crc <= crc_rgb;
+    end
+end
+
+// reference clock domain. crc_frame is stable for a full frame after the
+// toggle so it can be sampled directly once the toggle has been synced.
+reg frame_toggle_sync1_reg, frame_toggle_sync2_reg, frame_toggle_prev;
+
+always @(posedge ref_clk or negedge reset_n) begin
+    if (!reset_n) begin
+        frame_toggle_sync1_reg <= 1'b0;
+        frame_toggle_sync2_reg <= 1'b0;
+        frame_toggle_prev <= 1'b0;
+        crc_o <= 0;
+    end else begin
+        frame_toggle_sync1_reg <= frame_toggle;
+        frame_toggle_sync2_reg <= frame_toggle_sync1_reg;
+        frame_toggle_prev <= frame_toggle_sync2_reg;
+
+        if (frame_toggle_sync2_reg != frame_toggle_prev)
+            crc_o <= crc_frame;
+    end
+end
+
+endmodule
@@ -0,0 +1,495 @@
+//
+// Copyright (C) 2020  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+// Triple-buffered frame store in LPDDR2, used by scanconverter in place of
+// linebuf when misc_config.fb_enable is set.
+//
+// Capture side packs two pixels per 64-bit word (32bpp) and pushes
+// {address, data} words through an async FIFO to the write DMA. Lines are
+// padded to a full burst so that the FIFO only ever holds complete bursts.
+// Output side keeps a 2-line cache: the line currently displayed and the
+// next source line, which the read DMA fetches during the current line.
+// Frame buffer indices are owned by capture domain. At output frame start
+// the reader requests a swap and waits for the grant carrying its new read
+// buffer, which is the latest completed one. Capture side picks its next
+// write buffer from the granted read buffer, so a buffer can be reused only
+// after the reader has moved away from it. Line width travels with the
+// buffer index, so that each buffer is read back with the width it was
+// written with.
+//
+// Memory layout (64-bit word address): {buf[1:0], line[10:0], word[9:0]},
+// i.e. 2048px line stride and 16MB per buffer in the lowest 48MB of LPDDR2.
+//
+// Bandwidth budget:
+//   LPDDR2 x32 @ 300MHz DDR: 2400MB/s peak, ~1700MB/s after refresh and
+//   bus turnaround. DMA ports are 64-bit @ 108MHz (DMA_CLK_i), 864MB/s each.
+//   1080p60 input stored: 1920*1080*60*4B = 498MB/s on the write port.
+//   1080p60 output, no line repeat: 498MB/s on the read port.
+//   Total ~1GB/s, leaving headroom for the CPU port. Each source line must
+//   be fetched within one output line (or Y_RPT+1 lines): a 1920px line is
+//   240 bursts = 960 beats = 8.9us vs 14.8us line time at 1080p60. Firmware
+//   checks both limits per mode before enabling the frame buffer.
+
+module framebuf #(
+    parameter WRFIFO_AW = 8,
+    parameter BURST_LEN = 4
+) (
+    input reset_n,
+    input enable,
+    // capture side
+    input PCLK_CAP_i,
+    input DE_i,
+    input [10:0] xpos_i,
+    input [10:0] ypos_i,
+    input [23:0] data_i,
+    // output side
+    input PCLK_OUT_i,
+    input frame_start_o,
+    input [11:0] line_cur_o,
+    input [11:0] line_next_o,
+    input [10:0] xpos_o,
+    output [23:0] data_o,
+    // DMA side
+    input DMA_CLK_i,
+    output reg [24:0] avl_wr_address,
+    output [63:0] avl_wr_writedata,
+    output [7:0] avl_wr_byteenable,
+    output reg avl_wr_write,
+    output reg avl_wr_beginbursttransfer,
+    output [2:0] avl_wr_burstcount,
+    input avl_wr_waitrequest_n,
+    output reg [24:0] avl_rd_address,
+    output reg avl_rd_read,
+    output reg avl_rd_beginbursttransfer,
+    output [2:0] avl_rd_burstcount,
+    input [63:0] avl_rd_readdata,
+    input avl_rd_readdatavalid,
+    input avl_rd_waitrequest_n
+);
+
+localparam WRFIFO_DW = 23+64;
+
+function [1:0] next_wr_buf;
+    input [1:0] cur;
+    input [1:0] rd;
+    begin
+        if ((cur != 2'd0) & (rd != 2'd0))
+            next_wr_buf = 2'd0;
+        else if ((cur != 2'd1) & (rd != 2'd1))
+            next_wr_buf = 2'd1;
+        else
+            next_wr_buf = 2'd2;
+    end
+endfunction
+
+// cross-domain handshake state
+reg [1:0] wr_buf, done_buf, rd_buf_cap, rd_buf;
+reg swap_tgl, grant_tgl, req_tgl, ack_tgl;
+reg req_slot;
+reg [1:0] req_buf;
+reg [10:0] req_line;
+reg [8:0] line_bursts, done_bursts, rd_bursts_cap, rd_bursts_out, req_bursts;
+
+assign avl_wr_byteenable = 8'hff;
+assign avl_wr_burstcount = BURST_LEN;
+assign avl_rd_burstcount = BURST_LEN;
+
+
+// Capture domain
+
+reg [1:0] en_cap_sync;
+reg DE_prev;
+reg [10:0] ypos_prev, xpos_prev;
+reg [23:0] pix_lo;
+reg pix_half;
+reg [10:0] wr_line;
+reg [9:0] wr_word;
+reg pad_active;
+reg grp_drop;
+reg [2:0] swap_tgl_cap_sync;
+
+reg wrfifo_wrreq;
+reg [WRFIFO_DW-1:0] wrfifo_data;
+wire [WRFIFO_AW:0] wrfifo_wrused;
+
+wire cap_en = en_cap_sync[1];
+wire cap_frame_start = (ypos_i == 0) & (ypos_prev != 0);
+
+// whole bursts are dropped on FIFO overflow so that the read side never
+// sees a partial one
+wire wrfifo_push_ok = (wr_word[1:0] == 2'h0) ? (wrfifo_wrused < (1<<WRFIFO_AW)-BURST_LEN) : ~grp_drop;
+
+always @(posedge PCLK_CAP_i or negedge reset_n) begin
+    if (!reset_n) begin
+        en_cap_sync <= 2'b00;
+        DE_prev <= 1'b0;
+        ypos_prev <= 0;
+        xpos_prev <= 0;
+        pix_half <= 1'b0;
+        pad_active <= 1'b0;
+        grp_drop <= 1'b0;
+        wr_buf <= 2'd0;
+        done_buf <= 2'd0;
+        rd_buf_cap <= 2'd0;
+        grant_tgl <= 1'b0;
+        swap_tgl_cap_sync <= 3'b000;
+        line_bursts <= 0;
+        done_bursts <= 0;
+        rd_bursts_cap <= 0;
+        wrfifo_wrreq <= 1'b0;
+    end else begin
+        en_cap_sync <= {en_cap_sync[0], enable};
+        swap_tgl_cap_sync <= {swap_tgl_cap_sync[1:0], swap_tgl};
+
+        DE_prev <= DE_i;
+        ypos_prev <= ypos_i;
+        xpos_prev <= xpos_i;
+        wrfifo_wrreq <= 1'b0;
+
+        // Buffer selection for both sides happens here. rd_buf_cap and
+        // rd_bursts_cap stay stable until the next swap request, which the
+        // reader only sends after it has taken the previous grant.
+        if (swap_tgl_cap_sync[2] ^ swap_tgl_cap_sync[1]) begin
+            rd_buf_cap <= cap_frame_start ? wr_buf : done_buf;
+            rd_bursts_cap <= cap_frame_start ? line_bursts : done_bursts;
+            grant_tgl <= grant_tgl ^ 1'b1;
+        end
+
+        if (cap_frame_start) begin
+            done_buf <= wr_buf;
+            done_bursts <= line_bursts;
+            wr_buf <= next_wr_buf(wr_buf, (swap_tgl_cap_sync[2] ^ swap_tgl_cap_sync[1]) ? wr_buf : rd_buf_cap);
+        end
+
+        if (cap_en & DE_i) begin
+            wr_line <= ypos_i;
+            if (~xpos_i[0]) begin
+                pix_lo <= data_i;
+                pix_half <= 1'b1;
+                wr_word <= xpos_i[10:1];
+            end else begin
+                wrfifo_wrreq <= wrfifo_push_ok;
+                wrfifo_data <= {wr_buf, ypos_i, xpos_i[10:1], 8'h00, data_i, 8'h00, pix_lo};
+                grp_drop <= ~wrfifo_push_ok;
+                pix_half <= 1'b0;
+                wr_word <= xpos_i[10:1] + 1'b1;
+            end
+        end else if (cap_en & DE_prev) begin
+            // end of line: flush pending pixel and pad to burst boundary
+            if (pix_half) begin
+                wrfifo_wrreq <= wrfifo_push_ok;
+                wrfifo_data <= {wr_buf, wr_line, wr_word, 32'h00000000, 8'h00, pix_lo};
+                grp_drop <= ~wrfifo_push_ok;
+                pix_half <= 1'b0;
+                wr_word <= wr_word + 1'b1;
+            end
+            pad_active <= 1'b1;
+            line_bursts <= (xpos_prev >> 3) + 1'b1;
+        end else if (pad_active) begin
+            if (wr_word[1:0] == 2'h0) begin
+                pad_active <= 1'b0;
+            end else begin
+                wrfifo_wrreq <= ~grp_drop;
+                wrfifo_data <= {wr_buf, wr_line, wr_word, 64'h0};
+                wr_word <= wr_word + 1'b1;
+            end
+        end
+    end
+end
+
+wire [WRFIFO_DW-1:0] wrfifo_q;
+wire [WRFIFO_AW:0] wrfifo_rdused;
+wire wrfifo_rdreq = avl_wr_write & avl_wr_waitrequest_n;
+
+framebuf_fifo #(
+    .DW(WRFIFO_DW),
+    .AW(WRFIFO_AW)
+) wrfifo (
+    .reset_n(reset_n),
+    .wrclk(PCLK_CAP_i),
+    .wrreq(wrfifo_wrreq),
+    .data(wrfifo_data),
+    .wrused(wrfifo_wrused),
+    .rdclk(DMA_CLK_i),
+    .rdreq(wrfifo_rdreq),
+    .q(wrfifo_q),
+    .rdused(wrfifo_rdused)
+);
+
+
+// Output domain
+
+reg [1:0] en_out_sync;
+reg [2:0] grant_tgl_out_sync, ack_tgl_out_sync;
+reg [10:0] tag[0:1];
+reg [1:0] tag_valid;
+reg req_busy, req_stale, swap_pending;
+
+wire out_en = en_out_sync[1];
+
+wire hit0_cur = tag_valid[0] & (tag[0] == line_cur_o[10:0]) & ~line_cur_o[11];
+wire hit1_cur = tag_valid[1] & (tag[1] == line_cur_o[10:0]) & ~line_cur_o[11];
+wire hit_next = (tag_valid[0] & (tag[0] == line_next_o[10:0])) |
+                (tag_valid[1] & (tag[1] == line_next_o[10:0]));
+
+always @(posedge PCLK_OUT_i or negedge reset_n) begin
+    if (!reset_n) begin
+        en_out_sync <= 2'b00;
+        grant_tgl_out_sync <= 3'b000;
+        ack_tgl_out_sync <= 3'b000;
+        rd_buf <= 2'd0;
+        rd_bursts_out <= 0;
+        swap_tgl <= 1'b0;
+        swap_pending <= 1'b0;
+        tag_valid <= 2'b00;
+        req_busy <= 1'b0;
+        req_stale <= 1'b0;
+        req_tgl <= 1'b0;
+        req_slot <= 1'b0;
+    end else begin
+        en_out_sync <= {en_out_sync[0], enable};
+        grant_tgl_out_sync <= {grant_tgl_out_sync[1:0], grant_tgl};
+        ack_tgl_out_sync <= {ack_tgl_out_sync[1:0], ack_tgl};
+
+        if (grant_tgl_out_sync[2] ^ grant_tgl_out_sync[1]) begin
+            rd_buf <= rd_buf_cap;
+            rd_bursts_out <= rd_bursts_cap;
+            swap_pending <= 1'b0;
+        end
+
+        if (ack_tgl_out_sync[2] ^ ack_tgl_out_sync[1]) begin
+            req_busy <= 1'b0;
+            if (~req_stale) begin
+                tag[req_slot] <= req_line;
+                tag_valid[req_slot] <= 1'b1;
+            end
+        end
+
+        if (frame_start_o) begin
+            // no fetches until the new read buffer has been granted
+            swap_tgl <= swap_tgl ^ 1'b1;
+            swap_pending <= 1'b1;
+            tag_valid <= 2'b00;
+            req_stale <= req_busy;
+        end else if (out_en & ~swap_pending & ~req_busy & ~line_next_o[11] & ~hit_next) begin
+            // never evict the line being displayed
+            req_slot <= hit0_cur;
+            req_line <= line_next_o[10:0];
+            req_buf <= rd_buf;
+            req_bursts <= rd_bursts_out;
+            tag_valid[hit0_cur] <= 1'b0;
+            req_busy <= 1'b1;
+            req_stale <= 1'b0;
+            req_tgl <= req_tgl ^ 1'b1;
+        end
+    end
+end
+
+// line cache, 2 slots of 1024 pixel pairs
+reg [47:0] lcache[0:2047];
+reg [10:0] lcache_rdaddr;
+reg [47:0] lcache_q;
+reg [1:0] xpos_lsb_pp, hit_pp;
+
+always @(posedge PCLK_OUT_i) begin
+    lcache_rdaddr <= {hit1_cur, xpos_o[10:1]};
+    lcache_q <= lcache[lcache_rdaddr];
+    xpos_lsb_pp <= {xpos_lsb_pp[0], xpos_o[0]};
+    hit_pp <= {hit_pp[0], (hit0_cur | hit1_cur)};
+end
+
+assign data_o = ~hit_pp[1] ? 24'h000000 : (xpos_lsb_pp[1] ? lcache_q[47:24] : lcache_q[23:0]);
+
+
+// DMA domain
+
+reg [2:0] req_tgl_dma_sync;
+
+// write DMA
+reg wr_busy;
+reg [1:0] wr_beat;
+
+assign avl_wr_writedata = wrfifo_q[63:0];
+
+always @(posedge DMA_CLK_i or negedge reset_n) begin
+    if (!reset_n) begin
+        wr_busy <= 1'b0;
+        wr_beat <= 0;
+        avl_wr_write <= 1'b0;
+        avl_wr_beginbursttransfer <= 1'b0;
+    end else begin
+        avl_wr_beginbursttransfer <= 1'b0;
+
+        if (~wr_busy) begin
+            if (wrfifo_rdused >= BURST_LEN) begin
+                wr_busy <= 1'b1;
+                wr_beat <= 0;
+                avl_wr_write <= 1'b1;
+                avl_wr_beginbursttransfer <= 1'b1;
+                avl_wr_address <= {2'b00, wrfifo_q[WRFIFO_DW-1:64]};
+            end
+        end else if (avl_wr_waitrequest_n) begin
+            if (wr_beat == BURST_LEN-1) begin
+                wr_busy <= 1'b0;
+                avl_wr_write <= 1'b0;
+            end
+            wr_beat <= wr_beat + 1'b1;
+        end
+    end
+end
+
+// read DMA
+reg rd_busy, rd_slot;
+reg [8:0] rd_bursts, rd_cmd_cnt;
+reg [9:0] rd_rcv_cnt;
+
+always @(posedge DMA_CLK_i or negedge reset_n) begin
+    if (!reset_n) begin
+        req_tgl_dma_sync <= 3'b000;
+        ack_tgl <= 1'b0;
+        rd_busy <= 1'b0;
+        avl_rd_read <= 1'b0;
+        avl_rd_beginbursttransfer <= 1'b0;
+    end else begin
+        req_tgl_dma_sync <= {req_tgl_dma_sync[1:0], req_tgl};
+        avl_rd_beginbursttransfer <= 1'b0;
+
+        if (~rd_busy) begin
+            if (req_tgl_dma_sync[2] ^ req_tgl_dma_sync[1]) begin
+                if (req_bursts == 0) begin
+                    ack_tgl <= ack_tgl ^ 1'b1;
+                end else begin
+                    rd_busy <= 1'b1;
+                    rd_slot <= req_slot;
+                    rd_bursts <= req_bursts;
+                    rd_cmd_cnt <= 0;
+                    rd_rcv_cnt <= 0;
+                    avl_rd_address <= {req_buf, req_line, 10'h000};
+                    avl_rd_read <= 1'b1;
+                    avl_rd_beginbursttransfer <= 1'b1;
+                end
+            end
+        end else begin
+            if (avl_rd_read & avl_rd_waitrequest_n) begin
+                if (rd_cmd_cnt == rd_bursts-1) begin
+                    avl_rd_read <= 1'b0;
+                end else begin
+                    avl_rd_address <= avl_rd_address + BURST_LEN;
+                    avl_rd_beginbursttransfer <= 1'b1;
+                end
+                rd_cmd_cnt <= rd_cmd_cnt + 1'b1;
+            end
+
+            if (avl_rd_readdatavalid) begin
+                if (rd_rcv_cnt == {rd_bursts, 2'b00}-1) begin
+                    rd_busy <= 1'b0;
+                    ack_tgl <= ack_tgl ^ 1'b1;
+                end
+                rd_rcv_cnt <= rd_rcv_cnt + 1'b1;
+            end
+        end
+    end
+end
+
+always @(posedge DMA_CLK_i) begin
+    if (avl_rd_readdatavalid)
+        lcache[{rd_slot, rd_rcv_cnt}] <= {avl_rd_readdata[55:32], avl_rd_readdata[23:0]};
+end
+
+endmodule
+
+
+// Async FIFO with show-ahead output. Pointers cross in gray code; q holds
+// the entry at read pointer so it is valid whenever rdused is nonzero.
+
+module framebuf_fifo #(
+    parameter DW = 87,
+    parameter AW = 8
+) (
+    input reset_n,
+    input wrclk,
+    input wrreq,
+    input [DW-1:0] data,
+    output [AW:0] wrused,
+    input rdclk,
+    input rdreq,
+    output reg [DW-1:0] q,
+    output [AW:0] rdused
+);
+
+function [AW:0] gray2bin;
+    input [AW:0] g;
+    integer i;
+    begin
+        gray2bin[AW] = g[AW];
+        for (i=AW-1; i>=0; i=i-1)
+            gray2bin[i] = gray2bin[i+1] ^ g[i];
+    end
+endfunction
+
+reg [DW-1:0] mem[0:(1<<AW)-1];
+
+reg [AW:0] wr_ptr, wr_ptr_gray, rd_gray_sync1_reg, rd_gray_sync2_reg;
+reg [AW:0] rd_ptr, rd_ptr_gray, wr_gray_sync1_reg, wr_gray_sync2_reg;
+
+wire [AW:0] wr_ptr_next = wr_ptr + wrreq;
+wire [AW:0] rd_ptr_next = rd_ptr + rdreq;
+
+assign wrused = wr_ptr - gray2bin(rd_gray_sync2_reg);
+assign rdused = gray2bin(wr_gray_sync2_reg) - rd_ptr;
+
+always @(posedge wrclk) begin
+    if (wrreq)
+        mem[wr_ptr[AW-1:0]] <= data;
+end
+
+always @(posedge wrclk or negedge reset_n) begin
+    if (!reset_n) begin
+        wr_ptr <= 0;
+        wr_ptr_gray <= 0;
+        rd_gray_sync1_reg <= 0;
+        rd_gray_sync2_reg <= 0;
+    end else begin
+        wr_ptr <= wr_ptr_next;
+        wr_ptr_gray <= wr_ptr_next ^ (wr_ptr_next >> 1);
+        rd_gray_sync1_reg <= rd_ptr_gray;
+        rd_gray_sync2_reg <= rd_gray_sync1_reg;
+    end
+end
+
+always @(posedge rdclk) begin
+    q <= mem[rd_ptr_next[AW-1:0]];
+end
+
+always @(posedge rdclk or negedge reset_n) begin
+    if (!reset_n) begin
+        rd_ptr <= 0;
+        rd_ptr_gray <= 0;
+        wr_gray_sync1_reg <= 0;
+        wr_gray_sync2_reg <= 0;
+    end else begin
+        rd_ptr <= rd_ptr_next;
+        rd_ptr_gray <= rd_ptr_next ^ (rd_ptr_next >> 1);
+        wr_gray_sync1_reg <= wr_ptr_gray;
+        wr_gray_sync2_reg <= wr_gray_sync1_reg;
+    end
+end
+
+endmodule
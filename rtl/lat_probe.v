@@ -0,0 +1,251 @@
+//
+// Copyright (C) 2020  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+// Input-to-output latency probe. A fixed-size region (top-left, center or
+// bottom-right of active video) is monitored both in capture stream and
+// at scanconverter output. Once armed, a dark-to-bright transition of the
+// region on input starts a counter in output pixel clock domain, and the
+// counter stops when the same region turns bright on output. The result
+// is reported as whole output lines plus remaining pixel clocks, with a
+// few clocks of uncertainty from the domain crossing.
+
+module lat_probe_region #(
+    parameter X_W = 11,
+    parameter Y_W = 11,
+    parameter REGION_W = 16,
+    parameter REGION_H = 16
+) (
+    input clk,
+    input [7:0] R_i,
+    input [7:0] G_i,
+    input [7:0] B_i,
+    input DE_i,
+    input VSYNC_i,
+    input [X_W-1:0] xpos_i,
+    input [Y_W-1:0] ypos_i,
+    input [1:0] mode,
+    output reg bright,
+    output reg done
+);
+
+localparam LT_MODE_CENTER =         2'h1;
+localparam LT_MODE_BOTTOMRIGHT =    2'h2;
+
+reg [X_W-1:0] x_max, x_size, x_start;
+reg [Y_W-1:0] y_max, y_size, y_start;
+reg VSYNC_prev;
+reg in_region, region_last;
+reg [9:0] luma;
+reg [$clog2(REGION_W*REGION_H+1)-1:0] bright_cnt;
+
+always @(posedge clk) begin
+    VSYNC_prev <= VSYNC_i;
+
+    // region placement is based on active size of previous frame
+    if (VSYNC_prev & ~VSYNC_i) begin
+        x_size <= x_max + 1'b1;
+        y_size <= y_max + 1'b1;
+        x_max <= 0;
+        y_max <= 0;
+    end else if (DE_i) begin
+        if (xpos_i > x_max)
+            x_max <= xpos_i;
+        if (ypos_i > y_max)
+            y_max <= ypos_i;
+    end
+
+    if (mode == LT_MODE_CENTER) begin
+        x_start <= (x_size-REGION_W) >> 1;
+        y_start <= (y_size-REGION_H) >> 1;
+    end else if (mode == LT_MODE_BOTTOMRIGHT) begin
+        x_start <= x_size-REGION_W;
+        y_start <= y_size-REGION_H;
+    end else begin
+        x_start <= 0;
+        y_start <= 0;
+    end
+
+    in_region <= DE_i & (xpos_i >= x_start) & (xpos_i < x_start+REGION_W) & (ypos_i >= y_start) & (ypos_i < y_start+REGION_H);
+    region_last <= DE_i & (xpos_i == x_start+REGION_W-1) & (ypos_i == y_start+REGION_H-1);
+    luma <= R_i + {G_i, 1'b0} + B_i;
+
+    // region is bright if majority of its pixels are above mid-level
+    done <= region_last;
+    if (VSYNC_prev & ~VSYNC_i) begin
+        bright_cnt <= 0;
+    end else if (region_last) begin
+        bright <= (bright_cnt + (in_region & luma[9])) > (REGION_W*REGION_H/2);
+        bright_cnt <= 0;
+    end else if (in_region & luma[9]) begin
+        bright_cnt <= bright_cnt + 1'b1;
+    end
+end
+
+endmodule
+
+
+module lat_probe (
+    input PCLK_CAP_i,
+    input [7:0] R_cap_i,
+    input [7:0] G_cap_i,
+    input [7:0] B_cap_i,
+    input DE_cap_i,
+    input VSYNC_cap_i,
+    input [10:0] xpos_cap_i,
+    input [10:0] ypos_cap_i,
+    input PCLK_OUT_i,
+    input [7:0] R_out_i,
+    input [7:0] G_out_i,
+    input [7:0] B_out_i,
+    input HSYNC_out_i,
+    input DE_out_i,
+    input VSYNC_out_i,
+    input [11:0] xpos_out_i,
+    input [10:0] ypos_out_i,
+    input ref_clk,
+    input reset_n,
+    input [31:0] lt_config,
+    output [31:0] lt_status
+);
+
+wire LT_ARM = lt_config[0];
+wire [1:0] LT_MODE = lt_config[2:1];
+
+// capture clock domain
+reg arm_cap_sync1_reg, arm_cap_sync2_reg;
+reg cap_seen_dark, cap_done;
+reg cap_evt_toggle = 1'b0;
+wire cap_bright, cap_region_done;
+
+lat_probe_region #(
+    .X_W(11),
+    .Y_W(11)
+) cap_region (
+    .clk(PCLK_CAP_i),
+    .R_i(R_cap_i),
+    .G_i(G_cap_i),
+    .B_i(B_cap_i),
+    .DE_i(DE_cap_i),
+    .VSYNC_i(VSYNC_cap_i),
+    .xpos_i(xpos_cap_i),
+    .ypos_i(ypos_cap_i),
+    .mode(LT_MODE),
+    .bright(cap_bright),
+    .done(cap_region_done)
+);
+
+always @(posedge PCLK_CAP_i) begin
+    arm_cap_sync1_reg <= LT_ARM;
+    arm_cap_sync2_reg <= arm_cap_sync1_reg;
+
+    if (!arm_cap_sync2_reg) begin
+        cap_seen_dark <= 1'b0;
+        cap_done <= 1'b0;
+    end else if (cap_region_done & ~cap_done) begin
+        if (!cap_bright) begin
+            cap_seen_dark <= 1'b1;
+        end else if (cap_seen_dark) begin
+            cap_done <= 1'b1;
+            cap_evt_toggle <= ~cap_evt_toggle;
+        end
+    end
+end
+
+// output clock domain
+reg arm_out_sync1_reg, arm_out_sync2_reg;
+reg evt_sync1_reg, evt_sync2_reg, evt_prev;
+reg HSYNC_prev;
+reg [11:0] h_cnt, h_total;
+reg [11:0] lat_pixels;
+reg [15:0] lat_lines;
+reg running, finished;
+wire out_bright, out_region_done;
+
+lat_probe_region #(
+    .X_W(12),
+    .Y_W(11)
+) out_region (
+    .clk(PCLK_OUT_i),
+    .R_i(R_out_i),
+    .G_i(G_out_i),
+    .B_i(B_out_i),
+    .DE_i(DE_out_i),
+    .VSYNC_i(VSYNC_out_i),
+    .xpos_i(xpos_out_i),
+    .ypos_i(ypos_out_i),
+    .mode(LT_MODE),
+    .bright(out_bright),
+    .done(out_region_done)
+);
+
+always @(posedge PCLK_OUT_i) begin
+    arm_out_sync1_reg <= LT_ARM;
+    arm_out_sync2_reg <= arm_out_sync1_reg;
+    evt_sync1_reg <= cap_evt_toggle;
+    evt_sync2_reg <= evt_sync1_reg;
+    evt_prev <= evt_sync2_reg;
+
+    // line length is measured so that lines+pixels gives exact clock count
+    HSYNC_prev <= HSYNC_out_i;
+    if (HSYNC_prev & ~HSYNC_out_i) begin
+        h_cnt <= 0;
+        h_total <= h_cnt + 1'b1;
+    end else begin
+        h_cnt <= h_cnt + 1'b1;
+    end
+
+    if (!arm_out_sync2_reg) begin
+        running <= 1'b0;
+        finished <= 1'b0;
+        lat_lines <= 0;
+        lat_pixels <= 0;
+    end else if (~running & ~finished) begin
+        if (evt_sync2_reg != evt_prev)
+            running <= 1'b1;
+    end else if (running) begin
+        if (out_region_done & out_bright) begin
+            running <= 1'b0;
+            finished <= 1'b1;
+        end else if (lat_pixels >= h_total-1'b1) begin
+            lat_pixels <= 0;
+            if (lat_lines != 16'hffff)
+                lat_lines <= lat_lines + 1'b1;
+        end else begin
+            lat_pixels <= lat_pixels + 1'b1;
+        end
+    end
+end
+
+// reference clock domain. Result is stable once finished is set.
+reg finished_sync1_reg, finished_sync2_reg;
+
+always @(posedge ref_clk or negedge reset_n) begin
+    if (!reset_n) begin
+        finished_sync1_reg <= 1'b0;
+        finished_sync2_reg <= 1'b0;
+    end else begin
+        finished_sync1_reg <= finished;
+        finished_sync2_reg <= finished_sync1_reg;
+    end
+end
+
+assign lt_status = {finished_sync2_reg, 3'h0, lat_pixels, lat_lines};
+
+endmodule
@@ -12,7 +12,8 @@
 // 			altera_mf
 // ============================================================
 // ************************************************************
-// THIS IS A WIZARD-GENERATED FILE. DO NOT EDIT THIS FILE!
+// Wizard-generated, then parameterized by hand for line buffer depth and
+// word width. Defaults match the wizard settings recorded below.
 //
 // 19.1.0 Build 670 09/22/2019 SJ Lite Edition
 // ************************************************************
@@ -37,7 +38,11 @@
 // synopsys translate_off
 `timescale 1 ps / 1 ps
 // synopsys translate_on
-module linebuf (
+module linebuf #(
+	parameter ADDR_W = 17,
+	parameter DATA_W = 24,
+	parameter NUM_WORDS = 81920
+) (
 	data,
 	rdaddress,
 	rdclock,
@@ -46,13 +51,13 @@ module linebuf (
 	wren,
 	q);
 
-	input	[23:0]  data;
-	input	[16:0]  rdaddress;
+	input	[DATA_W-1:0]  data;
+	input	[ADDR_W-1:0]  rdaddress;
 	input	  rdclock;
-	input	[16:0]  wraddress;
+	input	[ADDR_W-1:0]  wraddress;
 	input	  wrclock;
 	input	  wren;
-	output	[23:0]  q;
+	output	[DATA_W-1:0]  q;
 `ifndef ALTERA_RESERVED_QIS
 // synopsys translate_off
 `endif
@@ -62,8 +67,8 @@ module linebuf (
 // synopsys translate_on
 `endif
 
-	wire [23:0] sub_wire0;
-	wire [23:0] q = sub_wire0[23:0];
+	wire [DATA_W-1:0] sub_wire0;
+	wire [DATA_W-1:0] q = sub_wire0[DATA_W-1:0];
 
 	altsyncram	altsyncram_component (
 				.address_a (wraddress),
@@ -83,7 +88,7 @@ module linebuf (
 				.clocken1 (1'b1),
 				.clocken2 (1'b1),
 				.clocken3 (1'b1),
-				.data_b ({24{1'b1}}),
+				.data_b ({DATA_W{1'b1}}),
 				.eccstatus (),
 				.q_a (),
 				.rden_a (1'b1),
@@ -97,16 +102,16 @@ module linebuf (
 		altsyncram_component.clock_enable_output_b = "BYPASS",
 		altsyncram_component.intended_device_family = "Cyclone V",
 		altsyncram_component.lpm_type = "altsyncram",
-		altsyncram_component.numwords_a = 81920,
-		altsyncram_component.numwords_b = 81920,
+		altsyncram_component.numwords_a = NUM_WORDS,
+		altsyncram_component.numwords_b = NUM_WORDS,
 		altsyncram_component.operation_mode = "DUAL_PORT",
 		altsyncram_component.outdata_aclr_b = "NONE",
 		altsyncram_component.outdata_reg_b = "CLOCK1",
 		altsyncram_component.power_up_uninitialized = "FALSE",
-		altsyncram_component.widthad_a = 17,
-		altsyncram_component.widthad_b = 17,
-		altsyncram_component.width_a = 24,
-		altsyncram_component.width_b = 24,
+		altsyncram_component.widthad_a = ADDR_W,
+		altsyncram_component.widthad_b = ADDR_W,
+		altsyncram_component.width_a = DATA_W,
+		altsyncram_component.width_b = DATA_W,
 		altsyncram_component.width_byteena_a = 1;
 
 
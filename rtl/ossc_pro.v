@@ -18,6 +18,9 @@
 //
 
 `define PO_RESET_WIDTH 27000
+`define MAINLOOP_TICK_CYCLES 270000
+`define LINEBUF_LINES 40
+`define LINEBUF_PACKED 0
 `define PCB1P3_SI_FIX
 
 module ossc_pro (
@@ -125,6 +128,10 @@ wire hdmirx_spdif = sys_ctrl[15];
 
 reg ir_rx_sync1_reg, ir_rx_sync2_reg;
 reg [5:0] btn_sync1_reg, btn_sync2_reg;
+reg [2:0] int_n_sync1_reg, int_n_sync2_reg;
+
+reg [18:0] mainloop_tick_ctr;
+reg mainloop_tick;
 
 wire [15:0] ir_code;
 wire [7:0] ir_code_cnt;
@@ -149,11 +156,19 @@ wire emif_status_powerdn_ack;
 
 wire sd_detect = ~SD_DETECT_i;
 
+wire isl_int = ~int_n_sync2_reg[0];
+wire hdmirx_int = ~int_n_sync2_reg[1];
+wire hdmitx_int = ~int_n_sync2_reg[2];
+wire sync_meas_changed;
+
 wire [31:0] controls = {2'h0, btn_sync2_reg, ir_code_cnt, ir_code};
-wire [31:0] sys_status = {27'h0, sd_detect, emif_status_powerdn_ack, emif_status_cal_fail, emif_status_cal_success, emif_status_init_done};
+wire [31:0] sys_status = {22'h0, sync_meas_changed, mainloop_tick, hdmitx_int, hdmirx_int, isl_int, sd_detect, emif_status_powerdn_ack, emif_status_cal_fail, emif_status_cal_success, emif_status_init_done};
 
 wire [31:0] hv_in_config, hv_in_config2, hv_in_config3, hv_out_config, hv_out_config2, hv_out_config3, xy_out_config, xy_out_config2;
 wire [31:0] misc_config, sl_config, sl_config2;
+wire [31:0] hscale_config, hscale_coef, vscale_config;
+wire [31:0] lt_config, lt_status;
+wire hscale_coef_we;
 
 reg [23:0] resync_led_ctr;
 reg resync_strobe_sync1_reg, resync_strobe_sync2_reg, resync_strobe_prev;
@@ -213,6 +228,20 @@ wire ISL_HSYNC_post, ISL_VSYNC_post, ISL_DE_post, ISL_FID_post;
 wire ISL_fe_interlace, ISL_fe_frame_change;
 wire [19:0] ISL_fe_pcnt_frame;
 wire [10:0] ISL_fe_vtotal, ISL_fe_xpos, ISL_fe_ypos;
+wire [15:0] ISL_sm_h_period_x16;
+wire [12:0] ISL_sm_h_synclen_x16;
+wire [10:0] ISL_sm_v_total_f0, ISL_sm_v_total_f1;
+wire [4:0] ISL_sm_v_synclen;
+wire ISL_sm_h_polarity, ISL_sm_v_polarity, ISL_sm_valid;
+wire [23:0] pclk_isl_cnt, pclk_hdmirx_cnt, pclk_out_cnt;
+
+wire clk108;
+wire [24:0] fb_avl_wr_address, fb_avl_rd_address;
+wire [63:0] fb_avl_wr_writedata, fb_avl_rd_readdata;
+wire [7:0] fb_avl_wr_byteenable;
+wire [2:0] fb_avl_wr_burstcount, fb_avl_rd_burstcount;
+wire fb_avl_wr_write, fb_avl_wr_beginbursttransfer, fb_avl_wr_waitrequest_n;
+wire fb_avl_rd_read, fb_avl_rd_beginbursttransfer, fb_avl_rd_readdatavalid, fb_avl_rd_waitrequest_n;
 isl51002_frontend u_isl_frontend ( 
     .PCLK_i(ISL_PCLK_i),
     .CLK_MEAS_i(CLK27_i),
@@ -332,6 +361,7 @@ reg [7:0] R_out, G_out, B_out;
 reg HSYNC_out, VSYNC_out, DE_out;
 wire [7:0] R_sc, G_sc, B_sc;
 wire HSYNC_sc, VSYNC_sc, DE_sc;
+wire [31:0] frame_crc;
 
 always @(posedge pclk_out) begin
     if (osd_enable) begin
@@ -405,11 +435,28 @@ always @(posedge CLK27_i or negedge po_reset_n) begin
         btn_sync2_reg <= 2'b11;
         ir_rx_sync1_reg <= 1'b1;
         ir_rx_sync2_reg <= 1'b1;
+        int_n_sync1_reg <= 3'b111;
+        int_n_sync2_reg <= 3'b111;
     end else begin
         btn_sync1_reg <= BTN_i;
         btn_sync2_reg <= btn_sync1_reg;
         ir_rx_sync1_reg <= IR_RX_i;
         ir_rx_sync2_reg <= ir_rx_sync1_reg;
+        int_n_sync1_reg <= {HDMITX_INT_N_i, HDMIRX_INT_N_i, ISL_INT_N_i};
+        int_n_sync2_reg <= int_n_sync1_reg;
+    end
+end
+
+// Periodic wakeup for CPU mainloop (toggles every tick, captured on any edge by PIO)
+always @(posedge CLK27_i or negedge po_reset_n) begin
+    if (!po_reset_n) begin
+        mainloop_tick_ctr <= 0;
+        mainloop_tick <= 1'b0;
+    end else if (mainloop_tick_ctr == `MAINLOOP_TICK_CYCLES-1) begin
+        mainloop_tick_ctr <= 0;
+        mainloop_tick <= ~mainloop_tick;
+    end else begin
+        mainloop_tick_ctr <= mainloop_tick_ctr + 1'b1;
     end
 end
 
@@ -433,6 +480,7 @@ sys sys_inst (
     .reset_reset_n                          (sys_reset_n),
     .pll_0_reset_reset                      (~po_reset_n),
     .pll_0_locked_export                    (pll_locked),
+    .pll_0_outclk0_clk                      (clk108),
     .pulpino_0_config_testmode_i            (1'b0),
     .pulpino_0_config_fetch_enable_i        (1'b1),
     .pulpino_0_config_clock_gating_i        (1'b0),
@@ -453,7 +501,14 @@ sys sys_inst (
     .pio_2_sys_status_in_export             (sys_status),
     .sc_config_0_sc_if_fe_status_i          ({20'h0, ISL_fe_interlace, ISL_fe_vtotal}),
     .sc_config_0_sc_if_fe_status2_i         ({12'h0, ISL_fe_pcnt_frame}),
-    .sc_config_0_sc_if_lt_status_i          (32'h00000000),
+    .sc_config_0_sc_if_lt_status_i          (lt_status),
+    .sc_config_0_sc_if_sync_meas_i          ({ISL_sm_valid, ISL_sm_v_polarity, ISL_sm_h_polarity, ISL_sm_h_synclen_x16, ISL_sm_h_period_x16}),
+    .sc_config_0_sc_if_sync_meas2_i         ({5'h0, ISL_sm_v_synclen, ISL_sm_v_total_f1, ISL_sm_v_total_f0}),
+    .sc_config_0_sc_if_pclk_isl_meas_i      ({8'h0, pclk_isl_cnt}),
+    .sc_config_0_sc_if_pclk_hdmirx_meas_i   ({8'h0, pclk_hdmirx_cnt}),
+    .sc_config_0_sc_if_pclk_out_meas_i      ({8'h0, pclk_out_cnt}),
+    .sc_config_0_sc_if_sc_caps_i            ({23'h0, 1'(`LINEBUF_PACKED), 8'(`LINEBUF_LINES)}),
+    .sc_config_0_sc_if_frame_crc_i          (frame_crc),
     .sc_config_0_sc_if_hv_in_config_o       (hv_in_config),
     .sc_config_0_sc_if_hv_in_config2_o      (hv_in_config2),
     .sc_config_0_sc_if_hv_in_config3_o      (hv_in_config3),
@@ -465,6 +520,11 @@ sys sys_inst (
     .sc_config_0_sc_if_misc_config_o        (misc_config),
     .sc_config_0_sc_if_sl_config_o          (sl_config),
     .sc_config_0_sc_if_sl_config2_o         (sl_config2),
+    .sc_config_0_sc_if_hscale_config_o      (hscale_config),
+    .sc_config_0_sc_if_hscale_coef_o        (hscale_coef),
+    .sc_config_0_sc_if_hscale_coef_we_o     (hscale_coef_we),
+    .sc_config_0_sc_if_vscale_config_o      (vscale_config),
+    .sc_config_0_sc_if_lt_config_o          (lt_config),
     .osd_generator_0_osd_if_vclk            (PCLK_sc),
     .osd_generator_0_osd_if_xpos            (xpos),
     .osd_generator_0_osd_if_ypos            (ypos),
@@ -478,6 +538,20 @@ sys sys_inst (
     .mem_if_lpddr2_emif_0_deep_powerdn_local_deep_powerdn_req  (emif_powerdn_req),
     .mem_if_lpddr2_emif_0_deep_powerdn_local_deep_powerdn_chip (emif_powerdn_mask),
     .mem_if_lpddr2_emif_0_deep_powerdn_local_deep_powerdn_ack  (emif_status_powerdn_ack),
+    .mem_if_lpddr2_emif_0_avl_1_waitrequest_n      (fb_avl_wr_waitrequest_n),
+    .mem_if_lpddr2_emif_0_avl_1_beginbursttransfer (fb_avl_wr_beginbursttransfer),
+    .mem_if_lpddr2_emif_0_avl_1_address            (fb_avl_wr_address),
+    .mem_if_lpddr2_emif_0_avl_1_write              (fb_avl_wr_write),
+    .mem_if_lpddr2_emif_0_avl_1_writedata          (fb_avl_wr_writedata),
+    .mem_if_lpddr2_emif_0_avl_1_byteenable         (fb_avl_wr_byteenable),
+    .mem_if_lpddr2_emif_0_avl_1_burstcount         (fb_avl_wr_burstcount),
+    .mem_if_lpddr2_emif_0_avl_2_waitrequest_n      (fb_avl_rd_waitrequest_n),
+    .mem_if_lpddr2_emif_0_avl_2_beginbursttransfer (fb_avl_rd_beginbursttransfer),
+    .mem_if_lpddr2_emif_0_avl_2_address            (fb_avl_rd_address),
+    .mem_if_lpddr2_emif_0_avl_2_read               (fb_avl_rd_read),
+    .mem_if_lpddr2_emif_0_avl_2_readdata           (fb_avl_rd_readdata),
+    .mem_if_lpddr2_emif_0_avl_2_readdatavalid      (fb_avl_rd_readdatavalid),
+    .mem_if_lpddr2_emif_0_avl_2_burstcount         (fb_avl_rd_burstcount),
     .memory_mem_ca                                 (DDR_CA_o),
     .memory_mem_ck                                 (DDR_CK_o_p),
     .memory_mem_ck_n                               (DDR_CK_o_n),
@@ -490,7 +564,10 @@ sys sys_inst (
     .oct_rzqin                                     (DDR_RZQ_i)
 );
 
-scanconverter scanconverter_inst (
+scanconverter #(
+    .NUM_LINE_BUFFERS(`LINEBUF_LINES),
+    .LB_PACKED(`LINEBUF_PACKED)
+) scanconverter_inst (
     .PCLK_CAP_i(pclk_capture),
     .PCLK_OUT_i(SI_PCLK_i),
     .reset_n(sys_reset_n),  //TODO: sync to pclk_capture
@@ -513,6 +590,11 @@ scanconverter scanconverter_inst (
     .misc_config(misc_config),
     .sl_config(sl_config),
     .sl_config2(sl_config2),
+    .hscale_config(hscale_config),
+    .vscale_config(vscale_config),
+    .CLK_CFG_i(CLK27_i),
+    .hscale_coef(hscale_coef),
+    .hscale_coef_we(hscale_coef_we),
     .testpattern_enable(testpattern_enable),
     .PCLK_o(PCLK_sc),
     .R_o(R_sc),
@@ -523,7 +605,97 @@ scanconverter scanconverter_inst (
     .DE_o(DE_sc),
     .xpos_o(xpos),
     .ypos_o(ypos),
-    .resync_strobe(resync_strobe_i)
+    .resync_strobe(resync_strobe_i),
+    .DMA_CLK_i(clk108),
+    .fb_avl_wr_address(fb_avl_wr_address),
+    .fb_avl_wr_writedata(fb_avl_wr_writedata),
+    .fb_avl_wr_byteenable(fb_avl_wr_byteenable),
+    .fb_avl_wr_write(fb_avl_wr_write),
+    .fb_avl_wr_beginbursttransfer(fb_avl_wr_beginbursttransfer),
+    .fb_avl_wr_burstcount(fb_avl_wr_burstcount),
+    .fb_avl_wr_waitrequest_n(fb_avl_wr_waitrequest_n),
+    .fb_avl_rd_address(fb_avl_rd_address),
+    .fb_avl_rd_read(fb_avl_rd_read),
+    .fb_avl_rd_beginbursttransfer(fb_avl_rd_beginbursttransfer),
+    .fb_avl_rd_burstcount(fb_avl_rd_burstcount),
+    .fb_avl_rd_readdata(fb_avl_rd_readdata),
+    .fb_avl_rd_readdatavalid(fb_avl_rd_readdatavalid),
+    .fb_avl_rd_waitrequest_n(fb_avl_rd_waitrequest_n)
+);
+
+// ISL51002 sync timing measurement (replaces I2C readout of sync stats)
+sync_meas u_isl_sync_meas (
+    .clk            (CLK27_i),
+    .reset_n        (sys_reset_n),
+    .hsync_i        (ISL_HSYNC_sync2_reg),
+    .vsync_i        (ISL_VSYNC_sync2_reg),
+    .h_period_x16   (ISL_sm_h_period_x16),
+    .h_synclen_x16  (ISL_sm_h_synclen_x16),
+    .h_polarity     (ISL_sm_h_polarity),
+    .v_total_f0     (ISL_sm_v_total_f0),
+    .v_total_f1     (ISL_sm_v_total_f1),
+    .v_synclen      (ISL_sm_v_synclen),
+    .v_polarity     (ISL_sm_v_polarity),
+    .meas_valid     (ISL_sm_valid),
+    .changed_toggle (sync_meas_changed)
+);
+
+// Pixel clock frequency counters (cycles per 10ms)
+clk_meas u_pclk_isl_meas (
+    .ref_clk        (CLK27_i),
+    .reset_n        (sys_reset_n),
+    .meas_clk       (ISL_PCLK_i),
+    .count          (pclk_isl_cnt)
+);
+
+clk_meas u_pclk_hdmirx_meas (
+    .ref_clk        (CLK27_i),
+    .reset_n        (sys_reset_n),
+    .meas_clk       (HDMIRX_PCLK_i),
+    .count          (pclk_hdmirx_cnt)
+);
+
+clk_meas u_pclk_out_meas (
+    .ref_clk        (CLK27_i),
+    .reset_n        (sys_reset_n),
+    .meas_clk       (SI_PCLK_i),
+    .count          (pclk_out_cnt)
+);
+
+frame_crc u_frame_crc (
+    .PCLK_i         (pclk_out),
+    .R_i            (R_sc),
+    .G_i            (G_sc),
+    .B_i            (B_sc),
+    .DE_i           (DE_sc),
+    .VSYNC_i        (VSYNC_sc),
+    .ref_clk        (CLK27_i),
+    .reset_n        (sys_reset_n),
+    .crc_o          (frame_crc)
+);
+
+lat_probe u_lat_probe (
+    .PCLK_CAP_i     (pclk_capture),
+    .R_cap_i        (R_capt),
+    .G_cap_i        (G_capt),
+    .B_cap_i        (B_capt),
+    .DE_cap_i       (DE_capt),
+    .VSYNC_cap_i    (VSYNC_capt),
+    .xpos_cap_i     (xpos_capt),
+    .ypos_cap_i     (ypos_capt),
+    .PCLK_OUT_i     (pclk_out),
+    .R_out_i        (R_sc),
+    .G_out_i        (G_sc),
+    .B_out_i        (B_sc),
+    .HSYNC_out_i    (HSYNC_sc),
+    .DE_out_i       (DE_sc),
+    .VSYNC_out_i    (VSYNC_sc),
+    .xpos_out_i     (xpos),
+    .ypos_out_i     (ypos),
+    .ref_clk        (CLK27_i),
+    .reset_n        (sys_reset_n),
+    .lt_config      (lt_config),
+    .lt_status      (lt_status)
 );
 
 ir_rcv ir0 (
@@ -17,7 +17,10 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
-module scanconverter (
+module scanconverter #(
+    parameter NUM_LINE_BUFFERS = 40,
+    parameter LB_PACKED = 0
+) (
     input PCLK_CAP_i,
     input PCLK_OUT_i,
     input reset_n,
@@ -40,6 +43,11 @@ module scanconverter (
     input [31:0] misc_config,
     input [31:0] sl_config,
     input [31:0] sl_config2,
+    input [31:0] hscale_config,
+    input [31:0] vscale_config,
+    input CLK_CFG_i,
+    input [31:0] hscale_coef,
+    input hscale_coef_we,
     input testpattern_enable,
     output PCLK_o,
     output [7:0] R_o,
@@ -50,10 +58,29 @@ module scanconverter (
     output DE_o,
     output [11:0] xpos_o,
     output [10:0] ypos_o,
-    output reg resync_strobe
+    output reg resync_strobe,
+    input DMA_CLK_i,
+    output [24:0] fb_avl_wr_address,
+    output [63:0] fb_avl_wr_writedata,
+    output [7:0] fb_avl_wr_byteenable,
+    output fb_avl_wr_write,
+    output fb_avl_wr_beginbursttransfer,
+    output [2:0] fb_avl_wr_burstcount,
+    input fb_avl_wr_waitrequest_n,
+    output [24:0] fb_avl_rd_address,
+    output fb_avl_rd_read,
+    output fb_avl_rd_beginbursttransfer,
+    output [2:0] fb_avl_rd_burstcount,
+    input [63:0] fb_avl_rd_readdata,
+    input fb_avl_rd_readdatavalid,
+    input fb_avl_rd_waitrequest_n
 );
 
-localparam NUM_LINE_BUFFERS = 40;
+// Linebuf stores RGB565 in packed mode, which fits 1.5x lines in the same memory.
+// Lines are interleaved into even/odd banks so that two adjacent lines can be
+// read simultaneously for vertical scaling, thus NUM_LINE_BUFFERS must be even.
+localparam LB_IDX_W = $clog2(NUM_LINE_BUFFERS);
+localparam LB_DATA_W = LB_PACKED ? 16 : 24;
 
 localparam FID_EVEN = 1'b0;
 localparam FID_ODD = 1'b1;
@@ -62,10 +89,18 @@ localparam PP_PL_START          = 1;
 localparam PP_LINEBUF_START     = PP_PL_START + 1;
 localparam PP_LINEBUF_LENGTH    = 1;
 localparam PP_LINEBUF_END       = PP_LINEBUF_START + PP_LINEBUF_LENGTH;
-localparam PP_SLGEN_START       = PP_LINEBUF_END;
+localparam PP_VSCALE_START      = PP_LINEBUF_END;
+localparam PP_VSCALE_LENGTH     = 2;
+localparam PP_VSCALE_END        = PP_VSCALE_START + PP_VSCALE_LENGTH;
+localparam PP_HSCALE_START      = PP_VSCALE_END;
+localparam PP_HSCALE_LENGTH     = 3;
+localparam PP_HSCALE_END        = PP_HSCALE_START + PP_HSCALE_LENGTH;
+localparam PP_SLGEN_START       = PP_HSCALE_END;
 localparam PP_SLGEN_LENGTH      = 1;
 localparam PP_SLGEN_END         = PP_SLGEN_START + PP_SLGEN_LENGTH;
 localparam PP_PL_END            = PP_SLGEN_END;
+localparam PP_SCALER_LENGTH     = PP_VSCALE_LENGTH + PP_HSCALE_LENGTH;
+localparam PP_PL_END_BYPASS     = PP_PL_END - PP_SCALER_LENGTH;
 
 wire [11:0] H_TOTAL = hv_out_config[11:0];
 wire [11:0] H_ACTIVE = hv_out_config[23:12];
@@ -88,7 +123,7 @@ wire signed [9:0] X_OFFSET = xy_out_config2[9:0];
 wire signed [8:0] Y_OFFSET = xy_out_config[31:23];
 
 wire [7:0] X_START_LB = xy_out_config2[17:10];
-wire signed [6:0] Y_START_LB = {xy_out_config2[23], xy_out_config2[23:18]};
+wire signed [7:0] Y_START_LB = {xy_out_config2[31:30], xy_out_config2[23:18]};
 
 wire [2:0] X_RPT = xy_out_config2[26:24];
 wire [2:0] Y_RPT = xy_out_config2[29:27];
@@ -102,6 +137,19 @@ wire [5:0] MISC_REV_LPF_STR = (misc_config[11:7] + 6'd16);
 wire MISC_REV_LPF_ENABLE = (misc_config[11:7] != 5'h0);
 wire MISC_LM_DEINT_MODE = misc_config[12];
 wire MISC_NIR_EVEN_OFFSET = misc_config[13];
+wire MISC_FB_ENABLE = misc_config[15];
+
+// Step and initial phase are 1.16 / 0.16 fixed point source pixels per output pixel, step <= 1.0
+wire [16:0] HSCALE_STEP = hscale_config[16:0];
+wire [15:0] HSCALE_PHASE0 = {hscale_config[28:17], 4'h0};
+wire HSCALE_ENABLE = hscale_config[31];
+
+// Same format for vertical, in source lines per output line. Not available in frame buffer mode.
+wire [16:0] VSCALE_STEP = vscale_config[16:0];
+wire [15:0] VSCALE_PHASE0 = {vscale_config[28:17], 4'h0};
+wire VSCALE_EN = vscale_config[31] & ~MISC_FB_ENABLE;
+
+wire SCALER_BYPASS = ~VSCALE_EN & ~HSCALE_ENABLE;
 
 
 reg frame_change_sync1_reg, frame_change_sync2_reg, frame_change_prev;
@@ -112,11 +160,14 @@ reg [10:0] v_cnt;
 reg src_fid, dst_fid;
 
 reg [10:0] xpos_lb;
-reg [6:0] ypos_lb;
+reg [LB_IDX_W:0] ypos_lb;
 reg [2:0] x_ctr;
 reg [2:0] y_ctr;
+reg [11:0] ypos_fb;
+reg [11:0] ypos_fb_start;
+reg fb_frame_start;
 
-reg [5:0] ypos_i_wraddr;
+reg [LB_IDX_W-1:0] ypos_i_wraddr;
 reg [10:0] ypos_i_prev;
 reg [10:0] xpos_i_wraddr;
 reg [23:0] DATA_i_wrdata;
@@ -135,23 +186,133 @@ reg mask_enable_pp[PP_LINEBUF_START:PP_SLGEN_START] /* synthesis ramstyle = "log
 
 reg [10:0] xpos_lb_start;
 
-assign PCLK_o = PCLK_OUT_i;
+// Vertical scaler state
+reg [15:0] vs_frac;
+reg [7:0] vs_top[0:2], vs_bot[0:2];
+reg [15:0] vs_prod_top[0:2], vs_prod_bot[0:2];
+
+// Horizontal scaler state
+reg [10:0] xpos_hs;
+reg [15:0] hs_frac;
+reg hs_fill;
+reg hs_adv_pp[PP_PL_START:PP_HSCALE_START] /* synthesis ramstyle = "logic" */;
+reg [3:0] hs_phase_pp[PP_PL_START:PP_HSCALE_START] /* synthesis ramstyle = "logic" */;
+reg [7:0] hs_tap[0:11];
+reg signed [9:0] hs_c[0:3];
+reg signed [18:0] hs_prod[0:11];
+reg signed [20:0] hs_sum[0:2];
+
+// Coefficient banks, one per tap, 16 phases of signed 2.8 fixed point
+reg signed [9:0] hs_coef0[0:15];
+reg signed [9:0] hs_coef1[0:15];
+reg signed [9:0] hs_coef2[0:15];
+reg signed [9:0] hs_coef3[0:15];
 
-wire [16:0] linebuf_wraddr = {ypos_i_wraddr, xpos_i_wraddr};
-wire [16:0] linebuf_rdaddr = {ypos_lb[5:0], xpos_lb};
+assign PCLK_o = PCLK_OUT_i;
 
+wire [LB_IDX_W+9:0] linebuf_wraddr = {ypos_i_wraddr[LB_IDX_W-1:1], xpos_i_wraddr};
+wire [16:0] hs_frac_next = {1'b0, hs_frac} + HSCALE_STEP;
+wire [16:0] vs_frac_next = {1'b0, vs_frac} + VSCALE_STEP;
+wire [10:0] xpos_rd = HSCALE_ENABLE ? xpos_hs : xpos_lb;
+
+// Top line is ypos_lb and bottom line the one following it. Both change
+// only during horizontal blanking so bank select needs no pipelining.
+wire [LB_IDX_W:0] ypos_lb_next = (ypos_lb == NUM_LINE_BUFFERS-1) ? 0 : ypos_lb + 1'b1;
+wire lb_top_odd = ypos_lb[0];
+wire [LB_IDX_W+9:0] linebuf_rdaddr_even = {(lb_top_odd ? ypos_lb_next[LB_IDX_W-1:1] : ypos_lb[LB_IDX_W-1:1]), xpos_rd};
+wire [LB_IDX_W+9:0] linebuf_rdaddr_odd = {(lb_top_odd ? ypos_lb[LB_IDX_W-1:1] : ypos_lb_next[LB_IDX_W-1:1]), xpos_rd};
+
+wire [LB_DATA_W-1:0] linebuf_wrdata, linebuf_q_even, linebuf_q_odd;
+wire [LB_DATA_W-1:0] linebuf_q_top = lb_top_odd ? linebuf_q_odd : linebuf_q_even;
+wire [LB_DATA_W-1:0] linebuf_q_bot = lb_top_odd ? linebuf_q_even : linebuf_q_odd;
 wire [7:0] R_linebuf, G_linebuf, B_linebuf;
+wire [7:0] R_linebuf_bot, G_linebuf_bot, B_linebuf_bot;
+
+generate
+    if (LB_PACKED) begin
+        assign linebuf_wrdata = {DATA_i_wrdata[23:19], DATA_i_wrdata[15:10], DATA_i_wrdata[7:3]};
+        assign R_linebuf = {linebuf_q_top[15:11], linebuf_q_top[15:13]};
+        assign G_linebuf = {linebuf_q_top[10:5], linebuf_q_top[10:9]};
+        assign B_linebuf = {linebuf_q_top[4:0], linebuf_q_top[4:2]};
+        assign R_linebuf_bot = {linebuf_q_bot[15:11], linebuf_q_bot[15:13]};
+        assign G_linebuf_bot = {linebuf_q_bot[10:5], linebuf_q_bot[10:9]};
+        assign B_linebuf_bot = {linebuf_q_bot[4:0], linebuf_q_bot[4:2]};
+    end else begin
+        assign linebuf_wrdata = DATA_i_wrdata;
+        assign {R_linebuf, G_linebuf, B_linebuf} = linebuf_q_top;
+        assign {R_linebuf_bot, G_linebuf_bot, B_linebuf_bot} = linebuf_q_bot;
+    end
+endgenerate
+
+linebuf #(
+    .ADDR_W(LB_IDX_W+10),
+    .DATA_W(LB_DATA_W),
+    .NUM_WORDS((NUM_LINE_BUFFERS/2)*2048)
+) linebuf_even (
+    .data(linebuf_wrdata),
+    .rdaddress(linebuf_rdaddr_even),
+    .rdclock(PCLK_OUT_i),
+    .wraddress(linebuf_wraddr),
+    .wrclock(PCLK_CAP_i),
+    .wren(DE_i_wren & ~ypos_i_wraddr[0]),
+    .q(linebuf_q_even)
+);
 
-linebuf linebuf_rgb (
-    .data(DATA_i_wrdata),
-    .rdaddress(linebuf_rdaddr),
+linebuf #(
+    .ADDR_W(LB_IDX_W+10),
+    .DATA_W(LB_DATA_W),
+    .NUM_WORDS((NUM_LINE_BUFFERS/2)*2048)
+) linebuf_odd (
+    .data(linebuf_wrdata),
+    .rdaddress(linebuf_rdaddr_odd),
     .rdclock(PCLK_OUT_i),
     .wraddress(linebuf_wraddr),
     .wrclock(PCLK_CAP_i),
-    .wren(DE_i_wren),
-    .q({R_linebuf, G_linebuf, B_linebuf})
+    .wren(DE_i_wren & ypos_i_wraddr[0]),
+    .q(linebuf_q_odd)
 );
 
+// Frame buffer mode reads absolute source lines instead of linebuf slots
+wire [11:0] Y_START_FB = {{4{Y_START_LB[7]}}, Y_START_LB};
+wire [11:0] fb_line_next = (v_cnt < V_SYNCLEN+V_BACKPORCH) ? ypos_fb_start : ((((y_ctr == Y_RPT) | Y_SKIP)) ? (ypos_fb + Y_STEP) : ypos_fb);
+
+wire [7:0] R_fb, G_fb, B_fb;
+
+framebuf framebuf_rgb (
+    .reset_n(reset_n),
+    .enable(MISC_FB_ENABLE),
+    .PCLK_CAP_i(PCLK_CAP_i),
+    .DE_i(DE_i_wren),
+    .xpos_i(xpos_i_wraddr),
+    .ypos_i(ypos_i_prev),
+    .data_i(DATA_i_wrdata),
+    .PCLK_OUT_i(PCLK_OUT_i),
+    .frame_start_o(fb_frame_start),
+    .line_cur_o(ypos_fb),
+    .line_next_o(fb_line_next),
+    .xpos_o(xpos_rd),
+    .data_o({R_fb, G_fb, B_fb}),
+    .DMA_CLK_i(DMA_CLK_i),
+    .avl_wr_address(fb_avl_wr_address),
+    .avl_wr_writedata(fb_avl_wr_writedata),
+    .avl_wr_byteenable(fb_avl_wr_byteenable),
+    .avl_wr_write(fb_avl_wr_write),
+    .avl_wr_beginbursttransfer(fb_avl_wr_beginbursttransfer),
+    .avl_wr_burstcount(fb_avl_wr_burstcount),
+    .avl_wr_waitrequest_n(fb_avl_wr_waitrequest_n),
+    .avl_rd_address(fb_avl_rd_address),
+    .avl_rd_read(fb_avl_rd_read),
+    .avl_rd_beginbursttransfer(fb_avl_rd_beginbursttransfer),
+    .avl_rd_burstcount(fb_avl_rd_burstcount),
+    .avl_rd_readdata(fb_avl_rd_readdata),
+    .avl_rd_readdatavalid(fb_avl_rd_readdatavalid),
+    .avl_rd_waitrequest_n(fb_avl_rd_waitrequest_n)
+);
+
+wire [7:0] R_lb = MISC_FB_ENABLE ? R_fb : R_linebuf;
+wire [7:0] G_lb = MISC_FB_ENABLE ? G_fb : G_linebuf;
+wire [7:0] B_lb = MISC_FB_ENABLE ? B_fb : B_linebuf;
+
 // Linebuffer write address calculation
 always @(posedge PCLK_CAP_i) begin
     if (ypos_i == 0) begin
@@ -179,7 +340,8 @@ end
 
 // H/V counters
 always @(posedge PCLK_OUT_i) begin
-    if (~frame_change_prev & frame_change & ((v_cnt != V_STARTLINE_PREV) & (v_cnt != V_STARTLINE))) begin
+    // Output timing free-runs in frame buffer mode
+    if (~MISC_FB_ENABLE & ~frame_change_prev & frame_change & ((v_cnt != V_STARTLINE_PREV) & (v_cnt != V_STARTLINE))) begin
         h_cnt <= 0;
         v_cnt <= V_STARTLINE;
         src_fid <= (~interlaced_in_i | (V_STARTLINE < (V_TOTAL/2))) ? FID_ODD : FID_EVEN;
@@ -205,14 +367,37 @@ always @(posedge PCLK_OUT_i) begin
     end
 end
 
+always @(posedge PCLK_OUT_i) begin
+    fb_frame_start <= (h_cnt == 0) & (v_cnt == 0);
+end
+
+// First frame buffer line, follows linebuf start position adjustments below
+always @(*) begin
+    if (~MISC_LM_DEINT_MODE & (Y_RPT > 0) & ~V_INTERLACED & (src_fid == FID_EVEN))
+        ypos_fb_start = Y_START_FB - 1'b1;
+    else if (Y_SKIP & (dst_fid == FID_EVEN))
+        ypos_fb_start = Y_START_FB + 1'b1;
+    else if ((((Y_RPT == 0) & ~V_INTERLACED) | ((Y_RPT > 0) & MISC_LM_DEINT_MODE)) & (src_fid == FID_EVEN))
+        ypos_fb_start = Y_START_FB - MISC_NIR_EVEN_OFFSET;
+    else
+        ypos_fb_start = Y_START_FB;
+end
+
 // Postprocess pipeline structure
-//            1          2         3         4
-// |----------|----------|---------|---------|
-// | SYNC/DE  |          |         |         |
-// | X/Y POS  |          |         |         |
-// |          |   MASK   |         |         |
-// |          | LB_SETUP | LINEBUF |         |
-// |          |          |         |  SLGEN  |
+//            1          2         3         4         5         6         7         8         9
+// |----------|----------|---------|---------|---------|---------|---------|---------|---------|
+// | SYNC/DE  |          |         |         |         |         |         |         |         |
+// | X/Y POS  |          |         |         |         |         |         |         |         |
+// |          |   MASK   |         |         |         |         |         |         |         |
+// |          | LB_SETUP | LINEBUF |         |         |         |         |         |         |
+// |          |          |         | VS_MULT | VS_SUM  |         |         |         |         |
+// |          |          |         |         |         | HS_TAPS | HS_MULT | HS_SUM  |         |
+// |          |          |         |         |         |         |         |         |  SLGEN  |
+//
+// With either scaler enabled the other one is passed through and latency is
+// PP_PL_END cycles. With both disabled SLGEN takes linebuf output directly
+// and outputs are tapped PP_SCALER_LENGTH stages earlier, i.e. latency is
+// PP_PL_END_BYPASS cycles.
 
 
 // Pipeline stage 1
@@ -224,13 +409,18 @@ always @(posedge PCLK_OUT_i) begin
         VSYNC_pp[1] <= ((v_cnt < V_SYNCLEN-1) | ((v_cnt == V_SYNCLEN-1) & (h_cnt < (H_TOTAL/2)))) ? 1'b0 : 1'b1;
     DE_pp[1] <= (h_cnt >= H_SYNCLEN+H_BACKPORCH) & (h_cnt < H_SYNCLEN+H_BACKPORCH+H_ACTIVE) & (v_cnt >= V_SYNCLEN+V_BACKPORCH) & (v_cnt < V_SYNCLEN+V_BACKPORCH+V_ACTIVE);
 
-    if (h_cnt == H_SYNCLEN+H_BACKPORCH) begin
+    // Line positions are updated ahead of active area so that scaler read-ahead
+    // at the end of backporch fetches from the new line
+    if (h_cnt == H_SYNCLEN+H_BACKPORCH-4) begin
         if (v_cnt == V_SYNCLEN+V_BACKPORCH) begin
-            ypos_pp[1] <= 0;
+            ypos_fb <= ypos_fb_start;
+            vs_frac <= VSCALE_PHASE0;
             // Bob deinterlace adjusts linebuf start position and y_ctr for even source fields if
             // output is progressive mode. Noninterlace restore as raw output mode is an exception
             // which ignores LM deinterlace mode setting.
-            if (~MISC_LM_DEINT_MODE & (Y_RPT > 0) & ~V_INTERLACED & (src_fid == FID_EVEN)) begin
+            if (VSCALE_EN) begin
+                ypos_lb <= Y_START_LB;
+            end else if (~MISC_LM_DEINT_MODE & (Y_RPT > 0) & ~V_INTERLACED & (src_fid == FID_EVEN)) begin
                 ypos_lb <= Y_START_LB - 1'b1;
                 y_ctr <= ((Y_RPT+1'b1) >> 1);
             end else begin
@@ -246,12 +436,13 @@ always @(posedge PCLK_OUT_i) begin
                 y_ctr <= 0;
             end
             xpos_lb_start <= (X_OFFSET < 10'sd0) ? 11'd0 : {1'b0, X_OFFSET};
+        end else if (VSCALE_EN) begin
+            vs_frac <= vs_frac_next[15:0];
+            if (vs_frac_next[16])
+                ypos_lb <= ypos_lb_next;
         end else begin
-            if (ypos_pp[1] < V_ACTIVE) begin
-                ypos_pp[1] <= ypos_pp[1] + 1'b1;
-            end
-
             if ((y_ctr == Y_RPT) | Y_SKIP) begin
+                ypos_fb <= ypos_fb + Y_STEP;
                 if ((ypos_lb >= NUM_LINE_BUFFERS-Y_STEP) & (ypos_lb < NUM_LINE_BUFFERS))
                     ypos_lb <= ypos_lb + Y_STEP - NUM_LINE_BUFFERS;
                 else
@@ -261,6 +452,13 @@ always @(posedge PCLK_OUT_i) begin
                 y_ctr <= y_ctr + 1'b1;
             end
         end
+    end
+
+    if (h_cnt == H_SYNCLEN+H_BACKPORCH) begin
+        if (v_cnt == V_SYNCLEN+V_BACKPORCH)
+            ypos_pp[1] <= 0;
+        else if (ypos_pp[1] < V_ACTIVE)
+            ypos_pp[1] <= ypos_pp[1] + 1'b1;
         xpos_pp[1] <= 0;
         xpos_lb <= X_START_LB;
         x_ctr <= 0;
@@ -280,8 +478,120 @@ always @(posedge PCLK_OUT_i) begin
     end
 end
 
-// Pipeline stages 2-
+// Horizontal scaler source position (stage 1). Read address runs 2 pixels
+// ahead of the left interpolation tap, and taps are filled during the last
+// 3 cycles of backporch. Source advances at most 1 pixel per output pixel.
+always @(posedge PCLK_OUT_i) begin
+    if (h_cnt == H_SYNCLEN+H_BACKPORCH-3) begin
+        xpos_hs <= X_START_LB - 1'b1;
+        hs_fill <= 1'b1;
+        hs_adv_pp[1] <= 1'b1;
+    end else if (hs_fill) begin
+        xpos_hs <= xpos_hs + 1'b1;
+        hs_adv_pp[1] <= 1'b1;
+        if (h_cnt == H_SYNCLEN+H_BACKPORCH) begin
+            hs_fill <= 1'b0;
+            hs_frac <= HSCALE_PHASE0;
+            hs_phase_pp[1] <= HSCALE_PHASE0[15:12];
+        end
+    end else if (xpos_pp[1] >= xpos_lb_start) begin
+        {hs_adv_pp[1], hs_frac} <= hs_frac_next;
+        hs_phase_pp[1] <= hs_frac_next[15:12];
+        if (hs_frac_next[16])
+            xpos_hs <= xpos_hs + 1'b1;
+    end else begin
+        hs_adv_pp[1] <= 1'b0;
+    end
+end
+
+always @(posedge CLK_CFG_i) begin
+    if (hscale_coef_we) begin
+        case (hscale_coef[17:16])
+            2'h0: hs_coef0[hscale_coef[23:20]] <= hscale_coef[9:0];
+            2'h1: hs_coef1[hscale_coef[23:20]] <= hscale_coef[9:0];
+            2'h2: hs_coef2[hscale_coef[23:20]] <= hscale_coef[9:0];
+            default: hs_coef3[hscale_coef[23:20]] <= hscale_coef[9:0];
+        endcase
+    end
+end
+
+// Vertical scaler stages, linear blend of top and bottom line
 integer pp_idx;
+integer vs_ch;
+always @(posedge PCLK_OUT_i) begin
+    // VS_MULT
+    vs_top[0] = R_lb;
+    vs_top[1] = G_lb;
+    vs_top[2] = B_lb;
+    vs_bot[0] = R_linebuf_bot;
+    vs_bot[1] = G_linebuf_bot;
+    vs_bot[2] = B_linebuf_bot;
+    for (vs_ch=0; vs_ch<3; vs_ch=vs_ch+1) begin
+        vs_prod_top[vs_ch] <= vs_top[vs_ch] * (9'h100 - vs_frac[15:8]);
+        vs_prod_bot[vs_ch] <= vs_bot[vs_ch] * vs_frac[15:8];
+    end
+    R_pp[PP_VSCALE_START+1] <= R_lb;
+    G_pp[PP_VSCALE_START+1] <= G_lb;
+    B_pp[PP_VSCALE_START+1] <= B_lb;
+
+    // VS_SUM: round
+    R_pp[PP_VSCALE_END] <= VSCALE_EN ? ((vs_prod_top[0] + vs_prod_bot[0] + 16'd128) >> 8) : R_pp[PP_VSCALE_START+1];
+    G_pp[PP_VSCALE_END] <= VSCALE_EN ? ((vs_prod_top[1] + vs_prod_bot[1] + 16'd128) >> 8) : G_pp[PP_VSCALE_START+1];
+    B_pp[PP_VSCALE_END] <= VSCALE_EN ? ((vs_prod_top[2] + vs_prod_bot[2] + 16'd128) >> 8) : B_pp[PP_VSCALE_START+1];
+end
+
+// Horizontal scaler stages, 4-tap polyphase filter
+integer hs_ch, hs_k;
+always @(posedge PCLK_OUT_i) begin
+    for(pp_idx = PP_PL_START+1; pp_idx <= PP_HSCALE_START; pp_idx = pp_idx+1) begin
+        hs_adv_pp[pp_idx] <= hs_adv_pp[pp_idx-1];
+        hs_phase_pp[pp_idx] <= hs_phase_pp[pp_idx-1];
+    end
+
+    // HS_TAPS: shift in new source pixel and fetch coefficients for phase
+    if (hs_adv_pp[PP_HSCALE_START]) begin
+        for (hs_ch=0; hs_ch<3; hs_ch=hs_ch+1) begin
+            for (hs_k=0; hs_k<3; hs_k=hs_k+1)
+                hs_tap[hs_ch*4+hs_k] <= hs_tap[hs_ch*4+hs_k+1];
+        end
+        hs_tap[3] <= R_pp[PP_HSCALE_START];
+        hs_tap[7] <= G_pp[PP_HSCALE_START];
+        hs_tap[11] <= B_pp[PP_HSCALE_START];
+    end
+    hs_c[0] <= hs_coef0[hs_phase_pp[PP_HSCALE_START]];
+    hs_c[1] <= hs_coef1[hs_phase_pp[PP_HSCALE_START]];
+    hs_c[2] <= hs_coef2[hs_phase_pp[PP_HSCALE_START]];
+    hs_c[3] <= hs_coef3[hs_phase_pp[PP_HSCALE_START]];
+    R_pp[PP_HSCALE_START+1] <= R_pp[PP_HSCALE_START];
+    G_pp[PP_HSCALE_START+1] <= G_pp[PP_HSCALE_START];
+    B_pp[PP_HSCALE_START+1] <= B_pp[PP_HSCALE_START];
+
+    // HS_MULT
+    for (hs_ch=0; hs_ch<3; hs_ch=hs_ch+1) begin
+        for (hs_k=0; hs_k<4; hs_k=hs_k+1)
+            hs_prod[hs_ch*4+hs_k] <= $signed({1'b0, hs_tap[hs_ch*4+hs_k]}) * hs_c[hs_k];
+    end
+    R_pp[PP_HSCALE_START+2] <= R_pp[PP_HSCALE_START+1];
+    G_pp[PP_HSCALE_START+2] <= G_pp[PP_HSCALE_START+1];
+    B_pp[PP_HSCALE_START+2] <= B_pp[PP_HSCALE_START+1];
+
+    // HS_SUM: round, clamp to 0-255
+    for (hs_ch=0; hs_ch<3; hs_ch=hs_ch+1)
+        hs_sum[hs_ch] = (hs_prod[hs_ch*4] + hs_prod[hs_ch*4+1] + hs_prod[hs_ch*4+2] + hs_prod[hs_ch*4+3] + 21'sd128) >>> 8;
+    R_pp[PP_HSCALE_END] <= ~HSCALE_ENABLE ? R_pp[PP_HSCALE_START+2] : (hs_sum[0][20] ? 8'h00 : ((hs_sum[0] > 21'sd255) ? 8'hff : hs_sum[0][7:0]));
+    G_pp[PP_HSCALE_END] <= ~HSCALE_ENABLE ? G_pp[PP_HSCALE_START+2] : (hs_sum[1][20] ? 8'h00 : ((hs_sum[1] > 21'sd255) ? 8'hff : hs_sum[1][7:0]));
+    B_pp[PP_HSCALE_END] <= ~HSCALE_ENABLE ? B_pp[PP_HSCALE_START+2] : (hs_sum[2][20] ? 8'h00 : ((hs_sum[2] > 21'sd255) ? 8'hff : hs_sum[2][7:0]));
+end
+
+// SLGEN input, from scaler output or directly from linebuf when bypassed
+wire [7:0] sl_R = SCALER_BYPASS ? R_lb : R_pp[PP_SLGEN_START];
+wire [7:0] sl_G = SCALER_BYPASS ? G_lb : G_pp[PP_SLGEN_START];
+wire [7:0] sl_B = SCALER_BYPASS ? B_lb : B_pp[PP_SLGEN_START];
+wire [11:0] sl_xpos = SCALER_BYPASS ? xpos_pp[PP_SLGEN_START-PP_SCALER_LENGTH] : xpos_pp[PP_SLGEN_START];
+wire [10:0] sl_ypos = SCALER_BYPASS ? ypos_pp[PP_SLGEN_START-PP_SCALER_LENGTH] : ypos_pp[PP_SLGEN_START];
+wire sl_mask = SCALER_BYPASS ? mask_enable_pp[PP_SLGEN_START-PP_SCALER_LENGTH] : mask_enable_pp[PP_SLGEN_START];
+
+// Pipeline stages 2-
 always @(posedge PCLK_OUT_i) begin
 
     for(pp_idx = PP_LINEBUF_START; pp_idx <= PP_PL_END; pp_idx = pp_idx+1) begin
@@ -305,19 +615,19 @@ always @(posedge PCLK_OUT_i) begin
         mask_enable_pp[pp_idx] <= mask_enable_pp[pp_idx-1];
     end
 
-    R_pp[PP_SLGEN_END] <= testpattern_enable ? (xpos_pp[PP_SLGEN_START] ^ ypos_pp[PP_SLGEN_START]) : (mask_enable_pp[PP_SLGEN_START] ? 8'h00 : R_linebuf);
-    G_pp[PP_SLGEN_END] <= testpattern_enable ? (xpos_pp[PP_SLGEN_START] ^ ypos_pp[PP_SLGEN_START]) : (mask_enable_pp[PP_SLGEN_START] ? 8'h00 : G_linebuf);
-    B_pp[PP_SLGEN_END] <= testpattern_enable ? (xpos_pp[PP_SLGEN_START] ^ ypos_pp[PP_SLGEN_START]) : (mask_enable_pp[PP_SLGEN_START] ? 8'h00 : B_linebuf);
+    R_pp[PP_SLGEN_END] <= testpattern_enable ? (sl_xpos ^ sl_ypos) : (sl_mask ? 8'h00 : sl_R);
+    G_pp[PP_SLGEN_END] <= testpattern_enable ? (sl_xpos ^ sl_ypos) : (sl_mask ? 8'h00 : sl_G);
+    B_pp[PP_SLGEN_END] <= testpattern_enable ? (sl_xpos ^ sl_ypos) : (sl_mask ? 8'h00 : sl_B);
 end
 
 // Output
 assign R_o = R_pp[PP_PL_END];
 assign G_o = G_pp[PP_PL_END];
 assign B_o = B_pp[PP_PL_END];
-assign HSYNC_o = HSYNC_pp[PP_PL_END];
-assign VSYNC_o = VSYNC_pp[PP_PL_END];
-assign DE_o = DE_pp[PP_PL_END];
-assign xpos_o = xpos_pp[PP_PL_END];
-assign ypos_o = ypos_pp[PP_PL_END];
+assign HSYNC_o = SCALER_BYPASS ? HSYNC_pp[PP_PL_END_BYPASS] : HSYNC_pp[PP_PL_END];
+assign VSYNC_o = SCALER_BYPASS ? VSYNC_pp[PP_PL_END_BYPASS] : VSYNC_pp[PP_PL_END];
+assign DE_o = SCALER_BYPASS ? DE_pp[PP_PL_END_BYPASS] : DE_pp[PP_PL_END];
+assign xpos_o = SCALER_BYPASS ? xpos_pp[PP_PL_END_BYPASS] : xpos_pp[PP_PL_END];
+assign ypos_o = SCALER_BYPASS ? ypos_pp[PP_PL_END_BYPASS] : ypos_pp[PP_PL_END];
 
 endmodule
@@ -0,0 +1,86 @@
+//
+// Copyright (C) 2020  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+// Simulation model of altsyncram for Verilator, covering the simple dual port
+// configuration used by linebuf.v: write on clock0, read address and output
+// registered on clock1 (2 cycle read latency). Other ports are ignored.
+
+module altsyncram #(
+    parameter address_aclr_b = "NONE",
+    parameter address_reg_b = "CLOCK1",
+    parameter clock_enable_input_a = "BYPASS",
+    parameter clock_enable_input_b = "BYPASS",
+    parameter clock_enable_output_b = "BYPASS",
+    parameter intended_device_family = "Cyclone V",
+    parameter lpm_type = "altsyncram",
+    parameter numwords_a = 1,
+    parameter numwords_b = 1,
+    parameter operation_mode = "DUAL_PORT",
+    parameter outdata_aclr_b = "NONE",
+    parameter outdata_reg_b = "CLOCK1",
+    parameter power_up_uninitialized = "FALSE",
+    parameter widthad_a = 1,
+    parameter widthad_b = 1,
+    parameter width_a = 1,
+    parameter width_b = 1,
+    parameter width_byteena_a = 1
+) (
+    input [widthad_a-1:0] address_a,
+    input [widthad_b-1:0] address_b,
+    input clock0,
+    input clock1,
+    input [width_a-1:0] data_a,
+    input wren_a,
+    output reg [width_b-1:0] q_b,
+    input aclr0,
+    input aclr1,
+    input addressstall_a,
+    input addressstall_b,
+    input [width_byteena_a-1:0] byteena_a,
+    input byteena_b,
+    input clocken0,
+    input clocken1,
+    input clocken2,
+    input clocken3,
+    input [width_b-1:0] data_b,
+    output [7:0] eccstatus,
+    output [width_a-1:0] q_a,
+    input rden_a,
+    input rden_b,
+    input wren_b
+);
+
+reg [width_a-1:0] mem[0:numwords_a-1];
+reg [widthad_b-1:0] address_b_reg;
+
+assign eccstatus = 8'h00;
+assign q_a = {width_a{1'b0}};
+
+always @(posedge clock0) begin
+    if (wren_a)
+        mem[address_a] <= data_a;
+end
+
+always @(posedge clock1) begin
+    address_b_reg <= address_b;
+    q_b <= mem[address_b_reg];
+end
+
+endmodule
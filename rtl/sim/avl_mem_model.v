@@ -0,0 +1,171 @@
+//
+// Copyright (C) 2020  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+// Avalon-MM burst memory model for frame buffer simulation. Separate write
+// and read ports share one memory, as LPDDR2 controller ports do. Both ports
+// insert pseudo-random wait states, and reads return after RD_LATENCY cycles
+// with occasional gaps between beats.
+//
+// Only a window of the 25-bit word address space is backed: frame buffer
+// layout {2'b00, buf[1:0], line[10:0], word[9:0]} with LINE_AW line and
+// WORD_AW word bits. Accesses outside it and protocol violations (burst
+// started before previous one completed, bad burstcount or unaligned burst)
+// are counted in errors.
+// Read commands stall while RD_QUEUE bursts are outstanding.
+
+module avl_mem_model #(
+    parameter LINE_AW = 4,
+    parameter WORD_AW = 5,
+    parameter BURST_LEN = 4,
+    parameter RD_LATENCY = 6,
+    parameter RD_QUEUE = 8
+) (
+    input clk,
+    input reset_n,
+    input [24:0] wr_address,
+    input [63:0] wr_writedata,
+    input [7:0] wr_byteenable,
+    input wr_write,
+    input wr_beginbursttransfer,
+    input [2:0] wr_burstcount,
+    output wr_waitrequest_n,
+    input [24:0] rd_address,
+    input rd_read,
+    input rd_beginbursttransfer,
+    input [2:0] rd_burstcount,
+    output reg [63:0] rd_readdata,
+    output reg rd_readdatavalid,
+    output rd_waitrequest_n
+);
+
+localparam AW = 2+LINE_AW+WORD_AW;
+
+reg [63:0] mem[0:(1<<AW)-1];
+
+integer errors, wr_beats, rd_beats;
+
+reg [15:0] lfsr;
+
+function [AW-1:0] mem_idx;
+    input [24:0] addr;
+    begin
+        mem_idx = {addr[22:21], addr[10+LINE_AW-1:10], addr[WORD_AW-1:0]};
+    end
+endfunction
+
+function in_window;
+    input [24:0] addr;
+    begin
+        in_window = (addr[24:23] == 2'b00) && ((addr[20:10] >> LINE_AW) == 0) && ((addr[9:0] >> WORD_AW) == 0);
+    end
+endfunction
+
+// write port
+reg [2:0] wr_beat;
+reg [24:0] wr_base;
+wire [24:0] wr_addr_cur = (wr_beat == 0) ? wr_address : wr_base + wr_beat;
+
+// read port: burst command queue and data return
+reg [24:0] rq_addr[0:RD_QUEUE-1];
+reg [31:0] rq_time[0:RD_QUEUE-1];
+reg [3:0] rq_wr, rq_rd;
+reg [2:0] rd_beat;
+reg [31:0] cycle;
+
+assign wr_waitrequest_n = ~(lfsr[3:0] == 4'h0);
+assign rd_waitrequest_n = ~(lfsr[7:4] == 4'h0) & (((rq_wr - rq_rd) & 4'hf) != RD_QUEUE);
+
+integer i;
+initial begin
+    for (i=0; i<(1<<AW); i=i+1)
+        mem[i] = 64'h0;
+    errors = 0;
+    wr_beats = 0;
+    rd_beats = 0;
+end
+
+always @(posedge clk or negedge reset_n) begin
+    if (!reset_n) begin
+        lfsr <= 16'hace1;
+        wr_beat <= 0;
+        rq_wr <= 0;
+        rq_rd <= 0;
+        rd_beat <= 0;
+        rd_readdatavalid <= 1'b0;
+        cycle <= 0;
+    end else begin
+        lfsr <= {lfsr[14:0], lfsr[15] ^ lfsr[13] ^ lfsr[12] ^ lfsr[10]};
+        cycle <= cycle + 1'b1;
+
+        // beginbursttransfer is asserted on first cycle of burst only, even if stalled
+        if (wr_write & wr_beginbursttransfer & (wr_beat != 0)) begin
+            $display("avl_mem_model: write burst started on beat %0d", wr_beat);
+            errors = errors + 1;
+        end
+
+        if (wr_write & wr_waitrequest_n) begin
+            if ((wr_beat == 0) && ((wr_burstcount != BURST_LEN) || (wr_address % BURST_LEN != 0))) begin
+                $display("avl_mem_model: bad write burst %0d @ 0x%h", wr_burstcount, wr_address);
+                errors = errors + 1;
+            end
+            if (!in_window(wr_addr_cur)) begin
+                $display("avl_mem_model: write outside model window 0x%h", wr_addr_cur);
+                errors = errors + 1;
+            end else if (wr_byteenable == 8'hff) begin
+                mem[mem_idx(wr_addr_cur)] <= wr_writedata;
+            end
+            if (wr_beat == 0)
+                wr_base <= wr_address;
+            wr_beat <= (wr_beat == BURST_LEN-1) ? 0 : wr_beat + 1'b1;
+            wr_beats = wr_beats + 1;
+        end
+
+        if (rd_read & rd_waitrequest_n) begin
+            if ((rd_burstcount != BURST_LEN) || (rd_address % BURST_LEN != 0)) begin
+                $display("avl_mem_model: bad read burst %0d @ 0x%h", rd_burstcount, rd_address);
+                errors = errors + 1;
+            end
+            rq_addr[rq_wr % RD_QUEUE] <= rd_address;
+            rq_time[rq_wr % RD_QUEUE] <= cycle;
+            rq_wr <= rq_wr + 1'b1;
+        end
+
+        rd_readdatavalid <= 1'b0;
+        if ((rq_wr != rq_rd) && (cycle - rq_time[rq_rd % RD_QUEUE] >= RD_LATENCY) && (lfsr[9:8] != 2'b00)) begin
+            if (in_window(rq_addr[rq_rd % RD_QUEUE] + rd_beat)) begin
+                rd_readdata <= mem[mem_idx(rq_addr[rq_rd % RD_QUEUE] + rd_beat)];
+            end else begin
+                $display("avl_mem_model: read outside model window 0x%h", rq_addr[rq_rd % RD_QUEUE] + rd_beat);
+                errors = errors + 1;
+                rd_readdata <= 64'hxxxxxxxxxxxxxxxx;
+            end
+            rd_readdatavalid <= 1'b1;
+            rd_beats = rd_beats + 1;
+            if (rd_beat == BURST_LEN-1) begin
+                rd_beat <= 0;
+                rq_rd <= rq_rd + 1'b1;
+            end else begin
+                rd_beat <= rd_beat + 1'b1;
+            end
+        end
+    end
+end
+
+endmodule
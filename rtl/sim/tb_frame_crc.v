@@ -0,0 +1,136 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+// Testbench for frame_crc.v (Icarus Verilog/ModelSim)
+//
+// Drives a 64x8 test pattern (six lines of 8 colour bars followed by two
+// lines of grey ramp) and compares the latched signature against a golden
+// value. Golden is the standard CRC32 of the RGB888 byte stream, computed
+// off-line with zlib.crc32(). The first frame is skipped as the engine
+// starts accumulating before the first vsync.
+
+`timescale 1ns / 10ps
+
+module tb_frame_crc;
+
+localparam H_TOTAL = 80;
+localparam H_START = 8;
+localparam H_ACTIVE = 64;
+localparam V_TOTAL = 12;
+localparam V_SYNCLEN = 2;
+localparam V_START = 3;
+localparam V_ACTIVE = 8;
+localparam FRAMES = 4;
+localparam [31:0] CRC_GOLDEN = 32'hbfb445e7;
+
+reg reset_n = 1'b0;
+reg pclk = 1'b0, ref_clk = 1'b0;
+
+always #5 pclk = ~pclk;
+always #18.5 ref_clk = ~ref_clk;
+
+integer errors = 0;
+
+reg [10:0] h = 0, v = 0;
+integer frame = 0;
+
+wire h_act = (h >= H_START) && (h < H_START+H_ACTIVE);
+wire v_act = (v >= V_START) && (v < V_START+V_ACTIVE);
+wire [10:0] x = h - H_START;
+wire [10:0] y = v - V_START;
+wire [2:0] bar = x[5:3];
+
+reg [7:0] R, G, B;
+reg DE, VSYNC;
+wire [31:0] crc;
+
+always @(posedge pclk) begin
+    DE <= h_act & v_act;
+    VSYNC <= (v >= V_SYNCLEN);
+    if (y < 6) begin
+        // white, yellow, cyan, green, magenta, red, blue, black
+        R <= {8{~bar[1]}};
+        G <= {8{~bar[2]}};
+        B <= {8{~bar[0]}};
+    end else begin
+        R <= {x[5:0], 2'b00};
+        G <= {x[5:0], 2'b00};
+        B <= {x[5:0], 2'b00};
+    end
+
+    if (h == H_TOTAL-1) begin
+        h <= 0;
+        if (v == V_TOTAL-1) begin
+            v <= 0;
+            frame = frame + 1;
+        end else begin
+            v <= v + 1'b1;
+        end
+    end else begin
+        h <= h + 1'b1;
+    end
+end
+
+frame_crc dut (
+    .PCLK_i(pclk),
+    .R_i(R),
+    .G_i(G),
+    .B_i(B),
+    .DE_i(DE),
+    .VSYNC_i(VSYNC),
+    .ref_clk(ref_clk),
+    .reset_n(reset_n),
+    .crc_o(crc)
+);
+
+integer checked = 0;
+
+// crc_o updates a few ref_clk cycles after vsync start and then holds for
+// the whole frame, so sample it in the middle of the active area
+always @(posedge pclk) begin
+    if ((frame >= 2) && (v == V_START+V_ACTIVE/2) && (h == 0)) begin
+        if (crc !== CRC_GOLDEN) begin
+            $display("FAIL @%0t: frame %0d crc %08x, expected %08x", $time, frame, crc, CRC_GOLDEN);
+            errors = errors + 1;
+        end
+        checked = checked + 1;
+    end
+end
+
+initial begin
+    #100;
+    reset_n = 1'b1;
+
+    wait (frame == FRAMES);
+
+    if (checked == 0) begin
+        $display("FAIL: no frames checked");
+        errors = errors + 1;
+    end
+    $display("%0d frames checked", checked);
+
+    if (errors == 0)
+        $display("PASS");
+    else
+        $display("FAILED with %0d errors", errors);
+    $finish;
+end
+
+endmodule
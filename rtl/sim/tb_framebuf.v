@@ -0,0 +1,290 @@
+//
+// Copyright (C) 2020  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+// Testbench for framebuf.v with Avalon memory model (Icarus Verilog/ModelSim)
+//
+// Captures small frames whose pixels carry {frame, line, x} and displays them
+// on an independent output clock. First phase runs output faster than input
+// (frames repeated), second phase switches to a narrower line and faster
+// input (frames dropped). Third phase runs both sides at the same rate and
+// stretches input vertical blanking so that each input frame ends within a
+// few cycles of an output frame start, sweeping the offset from -3 to +3
+// output cycles to hit the buffer swap handshake in every ordering. Checks
+// that every displayed line is the requested source line with correct
+// pixels, that each output frame comes from a single completed input frame
+// (no tearing) no older than the previous one, that the line cache never
+// misses, and that the DMA masters follow the Avalon burst protocol.
+
+`timescale 1ns / 10ps
+
+module tb_framebuf;
+
+localparam H_TOTAL = 80;
+localparam H_START = 12;
+localparam V_TOTAL = 16;
+localparam V_START = 2;
+localparam V_ACTIVE = 12;
+localparam H_ACTIVE_A = 60;         // not a multiple of burst, exercises padding
+localparam H_ACTIVE_B = 36;
+localparam FRAMES_A = 10;
+localparam FRAMES_B = 12;
+localparam FRAMES_C = 14;
+localparam WARMUP_FRAMES = 3;
+
+reg reset_n = 1'b0;
+reg cap_clk = 1'b0, out_clk = 1'b0, dma_clk = 1'b0;
+real cap_half = 20.0;
+
+always #(cap_half) cap_clk = ~cap_clk;
+always #18.5 out_clk = ~out_clk;
+always #4.63 dma_clk = ~dma_clk;
+
+integer errors = 0;
+
+// output timing counters, also used for aligning capture in third phase
+reg [10:0] out_h = 0, out_v = 0;
+
+task check(input cond, input [8*48-1:0] msg);
+begin
+    if (!cond) begin
+        if (errors < 16)
+            $display("FAIL @%0t: %0s", $time, msg);
+        errors = errors + 1;
+    end
+end
+endtask
+
+
+// Capture side source
+
+reg [10:0] cap_h = 0, cap_v = 0;
+reg cap_hold = 1'b0;
+integer align_s;
+reg [10:0] h_active = H_ACTIVE_A;
+integer cap_frame = 0, last_done = -1;
+integer frame_w[0:255];
+
+reg DE_i = 1'b0;
+reg [10:0] xpos_i = 0, ypos_i = 0;
+reg [23:0] data_i = 0;
+
+wire cap_h_act = (cap_h >= H_START) && (cap_h < H_START+h_active);
+wire cap_v_act = (cap_v >= V_START) && (cap_v < V_START+V_ACTIVE);
+wire [10:0] cap_x = cap_h - H_START;
+wire [10:0] cap_y = (cap_v < V_START) ? 0 : (cap_v_act ? cap_v-V_START : V_ACTIVE-1);
+
+initial frame_w[0] = H_ACTIVE_A;
+
+// release point for held frame end, output frame start shifted by align_s cycles
+wire cap_release = (align_s >= 0) ? ((out_v == 0) && (out_h == align_s)) :
+                                    ((out_v == V_TOTAL-1) && (out_h == H_TOTAL+align_s));
+
+always @(posedge cap_clk) begin
+    DE_i <= cap_h_act & cap_v_act;
+    xpos_i <= cap_h_act ? cap_x : 11'd0;
+    ypos_i <= cap_y;
+    data_i <= {cap_frame[7:0], cap_y[7:0], cap_x[7:0]};
+
+    if (cap_h == H_TOTAL-1) begin
+        if (cap_v == V_TOTAL-1) begin
+            if (cap_frame >= FRAMES_A+FRAMES_B) begin
+                if (!cap_hold) begin
+                    cap_hold <= 1'b1;
+                    align_s = (cap_frame % 7) - 3;
+                end
+            end
+            if ((cap_frame < FRAMES_A+FRAMES_B) || (cap_hold && cap_release)) begin
+                cap_hold <= 1'b0;
+                cap_h <= 0;
+                cap_v <= 0;
+                last_done = cap_frame;
+                cap_frame = cap_frame + 1;
+                if (cap_frame == FRAMES_A) begin
+                    h_active <= H_ACTIVE_B;
+                    cap_half = 16.5;
+                end else if (cap_frame == FRAMES_A+FRAMES_B) begin
+                    cap_half = 18.5;
+                end
+                frame_w[cap_frame % 256] = (cap_frame >= FRAMES_A) ? H_ACTIVE_B : H_ACTIVE_A;
+            end
+        end else begin
+            cap_h <= 0;
+            cap_v <= cap_v + 1'b1;
+        end
+    end else begin
+        cap_h <= cap_h + 1'b1;
+    end
+end
+
+
+// Output side, plays the role of scanconverter timing
+
+reg frame_start_o = 1'b0;
+integer out_frame = 0, done_at_start = -1, fr_cur, fr_prev;
+wire [23:0] data_o;
+
+wire out_v_act = (out_v >= V_START) && (out_v < V_START+V_ACTIVE);
+wire out_h_act = (out_h >= H_START) && (out_h < H_START+H_ACTIVE_A);
+wire [10:0] out_line = out_v - V_START;
+wire [11:0] line_cur_o = out_v_act ? {1'b0, out_line} : 12'h800;
+wire [11:0] line_next_o = (out_v < V_START) ? 12'h000 : ((out_v_act && (out_line < V_ACTIVE-1)) ? {1'b0, out_line+1'b1} : 12'h800);
+wire [10:0] xpos_o = out_h_act ? out_h-H_START : 11'd0;
+
+// expected pixel, aligned to 2 cycle read latency
+reg exp_valid[0:1];
+reg [10:0] exp_x[0:1], exp_y[0:1];
+
+initial begin
+    exp_valid[0] = 1'b0;
+    exp_valid[1] = 1'b0;
+end
+
+always @(posedge out_clk) begin
+    frame_start_o <= (out_h == 0) && (out_v == 0);
+
+    exp_valid[0] <= out_v_act & out_h_act;
+    exp_x[0] <= xpos_o;
+    exp_y[0] <= out_line;
+    exp_valid[1] <= exp_valid[0];
+    exp_x[1] <= exp_x[0];
+    exp_y[1] <= exp_y[0];
+
+    if (out_h == H_TOTAL-1) begin
+        out_h <= 0;
+        out_v <= (out_v == V_TOTAL-1) ? 0 : out_v + 1'b1;
+    end else begin
+        out_h <= out_h + 1'b1;
+    end
+
+    if (frame_start_o) begin
+        out_frame = out_frame + 1;
+        done_at_start = last_done;
+        fr_prev = fr_cur;
+        fr_cur = -1;
+    end
+end
+
+always @(negedge out_clk) begin
+    if ((out_frame > WARMUP_FRAMES) && exp_valid[1]) begin
+        if (fr_cur < 0) begin
+            // first pixel of frame selects source frame
+            fr_cur = data_o[23:16];
+            // frame completing during swap handshake may be granted as well
+            check((fr_cur == (done_at_start % 256)) || (fr_cur == ((done_at_start-1) % 256)) || (fr_cur == ((done_at_start+1) % 256)), "output frame is not latest completed input frame");
+            check((out_frame == WARMUP_FRAMES+1) || (fr_cur == fr_prev) || (fr_cur == ((fr_prev+1) % 256)) || (fr_cur == ((fr_prev+2) % 256)), "output went back to older frame");
+        end
+
+        if (exp_x[1] < frame_w[fr_cur]) begin
+            check(data_o[23:16] == fr_cur, "source frame changed within output frame");
+            check(data_o[15:8] == exp_y[1][7:0], "wrong source line");
+            check(data_o[7:0] == exp_x[1][7:0], "wrong pixel");
+        end
+    end
+end
+
+
+// DUT and memory
+
+wire [24:0] avl_wr_address, avl_rd_address;
+wire [63:0] avl_wr_writedata, avl_rd_readdata;
+wire [7:0] avl_wr_byteenable;
+wire [2:0] avl_wr_burstcount, avl_rd_burstcount;
+wire avl_wr_write, avl_wr_beginbursttransfer, avl_wr_waitrequest_n;
+wire avl_rd_read, avl_rd_beginbursttransfer, avl_rd_readdatavalid, avl_rd_waitrequest_n;
+
+framebuf dut (
+    .reset_n(reset_n),
+    .enable(1'b1),
+    .PCLK_CAP_i(cap_clk),
+    .DE_i(DE_i),
+    .xpos_i(xpos_i),
+    .ypos_i(ypos_i),
+    .data_i(data_i),
+    .PCLK_OUT_i(out_clk),
+    .frame_start_o(frame_start_o),
+    .line_cur_o(line_cur_o),
+    .line_next_o(line_next_o),
+    .xpos_o(xpos_o),
+    .data_o(data_o),
+    .DMA_CLK_i(dma_clk),
+    .avl_wr_address(avl_wr_address),
+    .avl_wr_writedata(avl_wr_writedata),
+    .avl_wr_byteenable(avl_wr_byteenable),
+    .avl_wr_write(avl_wr_write),
+    .avl_wr_beginbursttransfer(avl_wr_beginbursttransfer),
+    .avl_wr_burstcount(avl_wr_burstcount),
+    .avl_wr_waitrequest_n(avl_wr_waitrequest_n),
+    .avl_rd_address(avl_rd_address),
+    .avl_rd_read(avl_rd_read),
+    .avl_rd_beginbursttransfer(avl_rd_beginbursttransfer),
+    .avl_rd_burstcount(avl_rd_burstcount),
+    .avl_rd_readdata(avl_rd_readdata),
+    .avl_rd_readdatavalid(avl_rd_readdatavalid),
+    .avl_rd_waitrequest_n(avl_rd_waitrequest_n)
+);
+
+avl_mem_model #(
+    .LINE_AW(4),
+    .WORD_AW(5)
+) mem (
+    .clk(dma_clk),
+    .reset_n(reset_n),
+    .wr_address(avl_wr_address),
+    .wr_writedata(avl_wr_writedata),
+    .wr_byteenable(avl_wr_byteenable),
+    .wr_write(avl_wr_write),
+    .wr_beginbursttransfer(avl_wr_beginbursttransfer),
+    .wr_burstcount(avl_wr_burstcount),
+    .wr_waitrequest_n(avl_wr_waitrequest_n),
+    .rd_address(avl_rd_address),
+    .rd_read(avl_rd_read),
+    .rd_beginbursttransfer(avl_rd_beginbursttransfer),
+    .rd_burstcount(avl_rd_burstcount),
+    .rd_readdata(avl_rd_readdata),
+    .rd_readdatavalid(avl_rd_readdatavalid),
+    .rd_waitrequest_n(avl_rd_waitrequest_n)
+);
+
+initial begin
+    #100;
+    reset_n = 1'b1;
+
+    wait (cap_frame == FRAMES_A+FRAMES_B+FRAMES_C);
+
+    check(out_frame > FRAMES_A+FRAMES_B+FRAMES_C, "output stalled");
+    check(mem.wr_beats > 0, "no write DMA traffic");
+    check(mem.rd_beats > 0, "no read DMA traffic");
+    errors = errors + mem.errors;
+    $display("%0d input frames, %0d output frames, %0d write / %0d read beats", cap_frame, out_frame, mem.wr_beats, mem.rd_beats);
+
+    if (errors == 0)
+        $display("PASS");
+    else
+        $display("FAILED with %0d errors", errors);
+    $finish;
+end
+
+initial begin
+    #20000000;
+    $display("FAIL: simulation timeout");
+    $finish;
+end
+
+endmodule
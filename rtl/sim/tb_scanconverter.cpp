@@ -0,0 +1,442 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Cycle based bench for scanconverter.v in linebuffer mode.
+//
+// For each mode in sc_modes.txt (see software/sys_controller/host/sc_modes.c)
+// a synthetic capture stream is driven into the capture port while output
+// runs from the same config words firmware writes. Capture and output clocks
+// keep the exact ratio firmware programs into Si5351. Each captured pixel
+// carries its source position and field counter, so every output pixel can
+// be traced back to the capture cycle that produced it. Checks:
+//  - output H/V timing against config, and no resync once locked
+//  - sync to output latency equals PP_PL_END (postprocess pipeline), or
+//    PP_PL_END_BYPASS when both scalers are disabled
+//  - output pixel source column matches X_START_LB/X_RPT, i.e. data path is
+//    aligned with sync/DE pipeline
+//  - linebuffer collisions: pixels read before their line was written (stale
+//    data older than NUM_LINE_BUFFERS lines), lines overwritten before or
+//    while being read (source line jumps or mixed lines/fields) and read line
+//    index ypos_lb out of range during active output
+// Input pixel to output pixel latency is reported per mode.
+//
+// Capture stream follows frontend conventions: xpos/ypos count active pixels
+// and lines, ypos stays 0 until the first active line and frame_change is
+// high during the first line of a frame.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include "verilated.h"
+#include "Vscanconverter.h"
+#include "Vscanconverter___024root.h"
+#include "pp_params.h"
+
+#ifndef NUM_LINE_BUFFERS
+#define NUM_LINE_BUFFERS 40
+#endif
+
+// Input fields to run before checking output, lets output lock to input
+#define WARMUP_FRAMES 2
+
+#define MAX_ERR_PRINT 8
+
+struct sc_mode {
+    char name[16];
+    unsigned amode, pll_h_total, h_active, h_synclen, h_backporch;
+    unsigned v_total, v_active, v_synclen, v_backporch, interlaced, h_skip;
+    int y_rpt;
+    uint32_t pclk_i_hz;
+    unsigned long long clk_num, clk_den;
+    uint32_t hv_out_config, hv_out_config2, hv_out_config3;
+    uint32_t xy_out_config, xy_out_config2, misc_config, hscale_config, vscale_config;
+};
+
+static int sext(uint32_t v, int bits) {
+    return (int)(v << (32-bits)) >> (32-bits);
+}
+
+// Fields of config words as decoded in scanconverter.v
+struct out_cfg {
+    unsigned h_total, h_active, h_synclen, h_backporch;
+    unsigned v_total_cfg, v_total, v_active, v_synclen, v_backporch, v_interlaced;
+    unsigned x_size, y_size, x_start_lb, x_rpt;
+    int x_offset, y_offset, y_start_lb;
+    bool fb_enable, hscale_enable, vscale_enable;
+
+    explicit out_cfg(const sc_mode &m) {
+        h_total = m.hv_out_config & 0xfff;
+        h_active = (m.hv_out_config >> 12) & 0xfff;
+        h_synclen = m.hv_out_config >> 24;
+        h_backporch = m.hv_out_config2 & 0x1ff;
+        v_interlaced = m.hv_out_config2 >> 31;
+        v_total_cfg = (m.hv_out_config2 >> 9) & 0x7ff;
+        v_total = v_total_cfg >> v_interlaced;
+        v_active = (m.hv_out_config2 >> 20) & 0x7ff;
+        v_synclen = m.hv_out_config3 & 0xf;
+        v_backporch = (m.hv_out_config3 >> 4) & 0x1ff;
+        x_size = m.xy_out_config & 0xfff;
+        y_size = (m.xy_out_config >> 12) & 0x7ff;
+        y_offset = sext(m.xy_out_config >> 23, 9);
+        x_offset = sext(m.xy_out_config2 & 0x3ff, 10);
+        x_start_lb = (m.xy_out_config2 >> 10) & 0xff;
+        y_start_lb = sext((((m.xy_out_config2 >> 30) & 0x3) << 6) | ((m.xy_out_config2 >> 18) & 0x3f), 8);
+        x_rpt = (m.xy_out_config2 >> 24) & 0x7;
+        fb_enable = (m.misc_config >> 15) & 1;
+        hscale_enable = m.hscale_config >> 31;
+        vscale_enable = m.vscale_config >> 31;
+    }
+};
+
+// Synthetic source, drive() and advance() once per capture clock
+struct capture {
+    const sc_mode &m;
+    unsigned smp_per_px, h, line, field;
+    uint64_t fields;
+    int64_t (*line_t)[2048];
+
+    capture(const sc_mode &mode, int64_t (*lt)[2048]) : m(mode), h(0), line(0), field(0), fields(0), line_t(lt) {
+        smp_per_px = m.h_skip+1;
+    }
+
+    unsigned field_lines() const {
+        if (!m.interlaced)
+            return m.v_total;
+        return (field == 0) ? (m.v_total+1)/2 : m.v_total/2;
+    }
+
+    void drive(Vscanconverter *top, int64_t t) {
+        unsigned h_start = (m.h_synclen+m.h_backporch)*smp_per_px;
+        unsigned v_start = m.v_synclen+m.v_backporch;
+        bool h_act = (h >= h_start) && (h < h_start+m.h_active*smp_per_px);
+        bool v_act = (line >= v_start) && (line < v_start+m.v_active);
+        unsigned x = h_act ? (h-h_start)/smp_per_px : 0;
+        unsigned y = (line < v_start) ? 0 : ((line < v_start+m.v_active) ? line-v_start : m.v_active-1);
+        unsigned tag = fields & 0x3;
+        bool de = h_act && v_act && ((h-h_start) % smp_per_px == 0);
+
+        top->HSYNC_i = (h >= m.h_synclen*smp_per_px);
+        top->VSYNC_i = (line >= m.v_synclen);
+        top->DE_i = de;
+        top->FID_i = (field == 0);
+        top->interlaced_in_i = m.interlaced;
+        top->frame_change_i = (field == 0) && (line == 0);
+        top->xpos_i = x;
+        top->ypos_i = y;
+        top->R_i = x & 0xff;
+        top->G_i = y & 0xff;
+        top->B_i = ((x >> 8) << 5) | ((y >> 8) << 2) | tag;
+
+        if (de && (x == 0))
+            line_t[tag][y] = t;
+    }
+
+    void advance() {
+        if (++h == m.pll_h_total) {
+            h = 0;
+            if (++line == field_lines()) {
+                line = 0;
+                fields++;
+                field = m.interlaced ? (field ^ 1) : 0;
+            }
+        }
+    }
+};
+
+struct result {
+    unsigned long errors;
+    unsigned long pixels;
+    int pp_latency;
+    int64_t lat_min, lat_max;
+};
+
+#define ERR(...) do { if (res.errors++ < MAX_ERR_PRINT) { printf("  ERROR @%llu: ", (unsigned long long)oc); printf(__VA_ARGS__); printf("\n"); } } while (0)
+
+static result run_mode(const sc_mode &m, unsigned frames) {
+    out_cfg c(m);
+    std::vector<int64_t> lt_buf(4*2048, -1);
+    int64_t (*line_t)[2048] = reinterpret_cast<int64_t (*)[2048]>(lt_buf.data());
+    capture cap(m, line_t);
+    Vscanconverter *top = new Vscanconverter;
+    result res = {0, 0, -1, INT64_MAX, 0};
+
+    // PCLK_OUT/PCLK_IN = clk_num/clk_den, periods in common time units
+    const int64_t t_cap = m.clk_num, t_out = m.clk_den;
+    const int64_t t_line_in = (int64_t)m.pll_h_total*t_cap;
+    const uint64_t fields_per_frame = m.interlaced ? 2 : 1;
+    const uint64_t warm_fields = WARMUP_FRAMES*fields_per_frame;
+    const bool check_pixels = !c.hscale_enable && !c.vscale_enable;
+    const unsigned pp_end = (c.hscale_enable || (c.vscale_enable && !c.fb_enable)) ? PP_PL_END : PP_PL_END_BYPASS;
+    const unsigned xpos_lb_start = (c.x_offset < 0) ? 0 : c.x_offset;
+    int64_t t_cap_next = t_cap, t_out_next = t_out;
+    uint64_t oc = 0;
+
+    // output monitor state
+    bool hs_prev = 1, vs_prev = 1, de_prev = 0, resync_prev = 0, de_line = 0;
+    uint64_t hs_fall = 0, vs_fall = 0, hcnt0 = 0;
+    int64_t vs_period_prev = -1;
+    unsigned de_cnt = 0, de_lines = 0, hcnt_prev = 1, n_hs = 0, n_vs = 0;
+    int line_y = -1, line_tag = -1, prev_y = -1, prev_tag = -1, line_in_frame = 0;
+
+    top->reset_n = 0;
+    top->hv_out_config = m.hv_out_config;
+    top->hv_out_config2 = m.hv_out_config2;
+    top->hv_out_config3 = m.hv_out_config3;
+    top->xy_out_config = m.xy_out_config;
+    top->xy_out_config2 = m.xy_out_config2;
+    top->misc_config = m.misc_config;
+    top->sl_config = 0;
+    top->sl_config2 = 0;
+    top->hscale_config = m.hscale_config;
+    top->vscale_config = m.vscale_config;
+    top->testpattern_enable = 0;
+    top->hscale_coef_we = 0;
+    top->fb_avl_wr_waitrequest_n = 1;
+    top->fb_avl_rd_waitrequest_n = 1;
+    top->fb_avl_rd_readdatavalid = 0;
+    top->eval();
+    top->reset_n = 1;
+
+    while (cap.fields < (frames+WARMUP_FRAMES)*fields_per_frame) {
+        if (t_cap_next <= t_out_next) {
+            cap.drive(top, t_cap_next);
+            top->PCLK_CAP_i = 1;
+            top->eval();
+            top->PCLK_CAP_i = 0;
+            top->eval();
+            cap.advance();
+            t_cap_next += t_cap;
+            continue;
+        }
+
+        top->PCLK_OUT_i = 1;
+        top->eval();
+        oc++;
+
+        const bool warm = (cap.fields >= warm_fields);
+        const bool hs = top->HSYNC_o, vs = top->VSYNC_o, de = top->DE_o;
+        const unsigned hcnt = top->rootp->scanconverter__DOT__h_cnt;
+
+        if (warm && top->resync_strobe && !resync_prev)
+            ERR("output resynced after lock");
+        resync_prev = top->resync_strobe;
+
+        if ((hcnt == 0) && (hcnt_prev != 0))
+            hcnt0 = oc;
+        hcnt_prev = hcnt;
+
+        // horizontal timing, checked on HSYNC falling edge for previous line
+        if (hs_prev && !hs) {
+            if (warm && n_hs) {
+                if (oc-hs_fall != c.h_total)
+                    ERR("hsync period %llu, expected %u", (unsigned long long)(oc-hs_fall), c.h_total);
+                if (de_line && (de_cnt != c.h_active))
+                    ERR("DE length %u, expected %u", de_cnt, c.h_active);
+                if (oc-hcnt0 != pp_end)
+                    ERR("sync latency %llu, expected %u", (unsigned long long)(oc-hcnt0), pp_end);
+            }
+            res.pp_latency = oc-hcnt0;
+            if (de_line)
+                de_lines++;
+            hs_fall = oc;
+            de_cnt = 0;
+            de_line = 0;
+            n_hs++;
+        }
+        if (!hs_prev && hs && warm && (oc-hs_fall != c.h_synclen))
+            ERR("hsync length %llu, expected %u", (unsigned long long)(oc-hs_fall), c.h_synclen);
+
+        // vertical timing, interlaced output fields differ by one line
+        if (vs_prev && !vs) {
+            int64_t period = oc-vs_fall;
+            if (warm && (n_vs > 1)) {
+                if (!c.v_interlaced && (period != (int64_t)c.h_total*c.v_total))
+                    ERR("vsync period %lld, expected %u lines", (long long)period, c.v_total);
+                if (c.v_interlaced && (vs_period_prev >= 0) && (period+vs_period_prev != (int64_t)c.h_total*c.v_total_cfg))
+                    ERR("vsync field pair %lld, expected %u lines", (long long)(period+vs_period_prev), c.v_total_cfg);
+                if (de_lines != c.v_active)
+                    ERR("active lines %u, expected %u", de_lines, c.v_active);
+            }
+            vs_period_prev = (n_vs > 0) ? period : -1;
+            vs_fall = oc;
+            de_lines = 0;
+            line_in_frame = 0;
+            prev_y = prev_tag = -1;
+            n_vs++;
+        }
+
+        if (de) {
+            if (!de_prev) {
+                if (warm && (oc-hs_fall != c.h_synclen+c.h_backporch))
+                    ERR("DE start %llu, expected %u", (unsigned long long)(oc-hs_fall), c.h_synclen+c.h_backporch);
+                line_y = line_tag = -1;
+            }
+            de_cnt++;
+            de_line = 1;
+        }
+
+        // end of active line, check continuity against previous output line
+        if (de_prev && !de && (line_y >= 0)) {
+            if (warm && (line_in_frame > 1) && (prev_y >= 0)) {
+                if ((line_y < prev_y) || (line_y > prev_y+2))
+                    ERR("source line jump %d -> %d", prev_y, line_y);
+                if (line_tag != prev_tag)
+                    ERR("source field changed mid-frame");
+            }
+            prev_y = line_y;
+            prev_tag = line_tag;
+        }
+        if (de_prev && !de)
+            line_in_frame++;
+
+        const int xo = top->xpos_o, yo = top->ypos_o;
+        const bool masked = (xo < c.x_offset) || (xo >= c.x_offset+(int)c.x_size) ||
+                            (yo < c.y_offset) || (yo >= c.y_offset+(int)c.y_size);
+
+        if (warm && de && !masked) {
+            const unsigned ypos_lb = top->rootp->scanconverter__DOT__ypos_lb;
+            if (!c.fb_enable && (ypos_lb >= NUM_LINE_BUFFERS))
+                ERR("ypos_lb %u out of range", ypos_lb);
+        }
+
+        if (warm && de && !masked && check_pixels && !c.fb_enable) {
+            const unsigned x = top->R_o | ((top->B_o >> 5) << 8);
+            const unsigned y = top->G_o | (((top->B_o >> 2) & 0x7) << 8);
+            const unsigned tag = top->B_o & 0x3;
+            const unsigned x_exp = c.x_start_lb + ((xo >= (int)xpos_lb_start) ? (xo-xpos_lb_start)/(c.x_rpt+1) : 0);
+
+            if (x_exp < m.h_active) {
+                if (x != x_exp)
+                    ERR("line %d pixel %d: source x %u, expected %u", yo, xo, x, x_exp);
+
+                if (line_y < 0) {
+                    line_y = y;
+                    line_tag = tag;
+                } else if ((y != (unsigned)line_y) || (tag != (unsigned)line_tag)) {
+                    ERR("line %d pixel %d: source line %u/%u, line started with %d/%d", yo, xo, y, tag, line_y, line_tag);
+                }
+
+                if ((y >= m.v_active) || (line_t[tag][y] < 0)) {
+                    ERR("line %d pixel %d: source line %u/%u never captured", yo, xo, y, tag);
+                } else {
+                    const int64_t age = t_out_next - (line_t[tag][y] + (int64_t)x*cap.smp_per_px*t_cap);
+                    if ((age <= 0) || (age > NUM_LINE_BUFFERS*t_line_in)) {
+                        ERR("line %d pixel %d: source line %u read %.2f input lines after capture", yo, xo, y, (double)age/t_line_in);
+                    } else {
+                        if (age < res.lat_min)
+                            res.lat_min = age;
+                        if (age > res.lat_max)
+                            res.lat_max = age;
+                    }
+                }
+                res.pixels++;
+            }
+        }
+
+        hs_prev = hs;
+        vs_prev = vs;
+        de_prev = de;
+
+        top->PCLK_OUT_i = 0;
+        top->eval();
+        t_out_next += t_out;
+    }
+
+    if (n_vs < 2)
+        ERR("no output frames");
+
+    top->final();
+    delete top;
+    return res;
+}
+
+int main(int argc, char **argv) {
+    FILE *mf, *rf;
+    char buf[512];
+    sc_mode m;
+    unsigned frames = 4, n_modes = 0, n_fail = 0;
+    const char *filter = NULL;
+
+    Verilated::commandArgs(argc, argv);
+
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <sc_modes.txt> <report.txt> [frames] [mode]\n", argv[0]);
+        return 2;
+    }
+    if (argc > 3)
+        frames = atoi(argv[3]);
+    if (argc > 4)
+        filter = argv[4];
+
+    if (!(mf = fopen(argv[1], "r")) || !(rf = fopen(argv[2], "w"))) {
+        fprintf(stderr, "cannot open %s / %s\n", argv[1], argv[2]);
+        return 2;
+    }
+
+    fprintf(rf, "# Scanconverter latency, linebuffer mode, %u linebuffers, %u frames per mode\n", NUM_LINE_BUFFERS, frames);
+    fprintf(rf, "# latency is from capture port to output port, in input lines and microseconds\n");
+    fprintf(rf, "%-14s %-5s %-5s %-12s %-12s %3s %9s %9s %9s %9s %8s %s\n",
+            "# mode", "lm", "y_rpt", "input", "output", "pp", "min_ln", "max_ln", "min_us", "max_us", "errors", "result");
+
+    while (fgets(buf, sizeof(buf), mf)) {
+        if (buf[0] == '#')
+            continue;
+        if (sscanf(buf, "%15s %u %d %u %u %u %u %u %u %u %u %u %u %u %llu %llu %x %x %x %x %x %x %x %x",
+                   m.name, &m.amode, &m.y_rpt, &m.pll_h_total, &m.h_active, &m.h_synclen, &m.h_backporch,
+                   &m.v_total, &m.v_active, &m.v_synclen, &m.v_backporch, &m.interlaced, &m.h_skip, &m.pclk_i_hz,
+                   &m.clk_num, &m.clk_den, &m.hv_out_config, &m.hv_out_config2, &m.hv_out_config3,
+                   &m.xy_out_config, &m.xy_out_config2, &m.misc_config, &m.hscale_config, &m.vscale_config) != 24)
+            continue;
+        if (filter && strcmp(filter, m.name))
+            continue;
+
+        out_cfg c(m);
+        char in_str[16], out_str[16];
+        snprintf(in_str, sizeof(in_str), "%ux%u%c", m.h_active, m.v_active<<m.interlaced, m.interlaced ? 'i' : 'p');
+        snprintf(out_str, sizeof(out_str), "%ux%u%c", c.h_active, c.v_active<<c.v_interlaced, c.v_interlaced ? 'i' : 'p');
+
+        printf("%s: %s -> %s (%s)\n", m.name, in_str, out_str, m.amode ? "adaptive" : "pure");
+        result res = run_mode(m, frames);
+
+        // one input line is pll_h_total capture clocks of clk_num units
+        const double line_units = (double)m.pll_h_total*m.clk_num;
+        const double us_units = (double)m.pclk_i_hz*m.clk_num/1000000.0;
+        const bool lat_valid = (res.lat_max > 0);
+
+        fprintf(rf, "%-14s %-5s %-5d %-12s %-12s %3d ", m.name, m.amode ? "adapt" : "pure", m.y_rpt+1, in_str, out_str, res.pp_latency);
+        if (lat_valid)
+            fprintf(rf, "%9.2f %9.2f %9.2f %9.2f ", res.lat_min/line_units, res.lat_max/line_units, res.lat_min/us_units, res.lat_max/us_units);
+        else
+            fprintf(rf, "%9s %9s %9s %9s ", "-", "-", "-", "-");
+        fprintf(rf, "%8lu %s\n", res.errors, res.errors ? "FAIL" : "PASS");
+
+        printf("  %lu pixels checked, %lu errors\n", res.pixels, res.errors);
+        n_modes++;
+        if (res.errors)
+            n_fail++;
+    }
+
+    fclose(mf);
+    fclose(rf);
+
+    printf("\n%u modes, %u failed, report in %s\n", n_modes, n_fail, argv[2]);
+    return (n_modes == 0) || (n_fail > 0);
+}
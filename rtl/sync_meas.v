@@ -0,0 +1,180 @@
+//
+// Copyright (C) 2020  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+// Sync timing measurement on the fixed 27MHz measurement clock.
+//
+// h_period and hsync width are accumulated over 16 lines for sub-pixel
+// precision. v_total is measured separately for two consecutive fields so
+// that interlace can be identified from the field lengths. Sync polarity is
+// resolved from duty cycle (active level is the shorter one). Results are
+// updated at each field boundary and changed_toggle flips whenever they
+// differ from previous field by more than the given tolerance.
+
+module sync_meas #(
+    parameter H_PERIOD_TOL = 16,
+    parameter V_TIMEOUT = 22'h3fffff
+) (
+    input clk,
+    input reset_n,
+    input hsync_i,
+    input vsync_i,
+    output reg [15:0] h_period_x16,
+    output reg [12:0] h_synclen_x16,
+    output reg h_polarity,
+    output reg [10:0] v_total_f0,
+    output reg [10:0] v_total_f1,
+    output reg [4:0] v_synclen,
+    output reg v_polarity,
+    output reg meas_valid,
+    output reg changed_toggle
+);
+
+reg hsync_prev, vsync_prev;
+
+// horizontal accumulators
+reg [16:0] h_acc, h_hi_acc;
+reg [3:0] h_lines;
+reg h_run, h_locked;
+reg [15:0] h_period_meas, h_hi_meas;
+
+// vertical counters
+reg [10:0] v_lines, v_hi_lines;
+reg [21:0] v_tmo_ctr;
+reg v_run, field_id;
+
+wire h_edge = hsync_i & ~hsync_prev;
+wire v_lead = v_polarity ? (~vsync_i & vsync_prev) : (vsync_i & ~vsync_prev);
+
+// results of the field that just ended
+wire h_pol_new = ({h_hi_meas, 1'b0} > {1'b0, h_period_meas});
+wire [15:0] h_synclen_new = h_pol_new ? (h_period_meas - h_hi_meas) : h_hi_meas;
+wire v_pol_new = ({v_hi_lines, 1'b0} > {1'b0, v_lines});
+wire [10:0] v_synclen_new = v_pol_new ? (v_lines - v_hi_lines) : v_hi_lines;
+wire [10:0] v_total_prev = field_id ? v_total_f1 : v_total_f0;
+wire [15:0] h_diff = (h_period_meas > h_period_x16) ? (h_period_meas - h_period_x16) : (h_period_x16 - h_period_meas);
+
+wire valid_new = h_locked & v_run;
+wire meas_changed = (valid_new != meas_valid) ||
+                    (h_diff > H_PERIOD_TOL) ||
+                    (h_pol_new != h_polarity) ||
+                    (v_pol_new != v_polarity) ||
+                    (v_lines != v_total_prev) ||
+                    (v_synclen_new[4:0] != v_synclen);
+
+always @(posedge clk or negedge reset_n) begin
+    if (!reset_n) begin
+        hsync_prev <= 1'b0;
+        h_acc <= 0;
+        h_hi_acc <= 0;
+        h_lines <= 0;
+        h_run <= 1'b0;
+        h_locked <= 1'b0;
+        h_period_meas <= 0;
+        h_hi_meas <= 0;
+    end else begin
+        hsync_prev <= hsync_i;
+
+        if (h_edge) begin
+            if (h_run && (h_lines == 4'hf)) begin
+                h_period_meas <= h_acc[15:0];
+                h_hi_meas <= h_hi_acc[15:0];
+                h_locked <= 1'b1;
+            end
+            if (!h_run || (h_lines == 4'hf)) begin
+                h_acc <= 1;
+                h_hi_acc <= 1;
+            end else begin
+                h_acc <= h_acc + 1'b1;
+                h_hi_acc <= h_hi_acc + hsync_i;
+            end
+            h_lines <= h_run ? h_lines + 1'b1 : 4'h0;
+            h_run <= 1'b1;
+        end else if (h_acc[16]) begin
+            // no hsync edges within measurement range
+            h_run <= 1'b0;
+            h_locked <= 1'b0;
+            h_acc <= 0;
+            h_hi_acc <= 0;
+        end else if (h_run) begin
+            h_acc <= h_acc + 1'b1;
+            h_hi_acc <= h_hi_acc + hsync_i;
+        end
+    end
+end
+
+always @(posedge clk or negedge reset_n) begin
+    if (!reset_n) begin
+        vsync_prev <= 1'b0;
+        v_lines <= 0;
+        v_hi_lines <= 0;
+        v_tmo_ctr <= 0;
+        v_run <= 1'b0;
+        field_id <= 1'b0;
+        h_period_x16 <= 0;
+        h_synclen_x16 <= 0;
+        h_polarity <= 1'b0;
+        v_total_f0 <= 0;
+        v_total_f1 <= 0;
+        v_synclen <= 0;
+        v_polarity <= 1'b0;
+        meas_valid <= 1'b0;
+        changed_toggle <= 1'b0;
+    end else begin
+        vsync_prev <= vsync_i;
+
+        if (v_lead) begin
+            if (v_run) begin
+                h_period_x16 <= h_period_meas;
+                h_synclen_x16 <= (h_synclen_new > 16'h1fff) ? 13'h1fff : h_synclen_new[12:0];
+                h_polarity <= h_pol_new;
+                v_polarity <= v_pol_new;
+                v_synclen <= (v_synclen_new > 11'h1f) ? 5'h1f : v_synclen_new[4:0];
+                if (field_id)
+                    v_total_f1 <= v_lines;
+                else
+                    v_total_f0 <= v_lines;
+                meas_valid <= valid_new;
+                if (meas_changed)
+                    changed_toggle <= ~changed_toggle;
+            end
+            field_id <= ~field_id;
+            v_lines <= {10'h0, h_edge};
+            v_hi_lines <= {10'h0, h_edge & vsync_i};
+            v_tmo_ctr <= 0;
+            v_run <= 1'b1;
+        end else if (v_tmo_ctr == V_TIMEOUT) begin
+            // no vsync, report loss once
+            v_run <= 1'b0;
+            v_tmo_ctr <= 0;
+            if (meas_valid) begin
+                meas_valid <= 1'b0;
+                changed_toggle <= ~changed_toggle;
+            end
+        end else begin
+            v_tmo_ctr <= v_tmo_ctr + 1'b1;
+            if (h_edge) begin
+                v_lines <= v_lines + 1'b1;
+                v_hi_lines <= v_hi_lines + vsync_i;
+            end
+        end
+    end
+end
+
+endmodule
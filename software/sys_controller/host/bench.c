@@ -0,0 +1,266 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+// Host benchmark for mode lookup (index build, indexed lookup, lookup cache)
+// and Si5351 solver. Absolute figures do not carry over to the softcore,
+// use them to compare changes against each other.
+
+#include <stdio.h>
+#include <time.h>
+// included for table sizes and static helpers
+#include "../src/video_modes.c"
+
+#undef printf
+
+#define NUM_SMP_PRESETS     (sizeof(smp_presets_default)/sizeof(smp_preset_t))
+#define MAX_KEYS            (2*NUM_VIDEO_MODES+NUM_SMP_PRESETS)
+
+static mode_data_t keys[MAX_KEYS];
+static unsigned num_keys;
+
+static uint64_t now_ns() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+// Lookup keys as mainloop builds them from ISL51002 / ADV761x sync measurements
+static void add_analog_key(const sync_timings_t *t) {
+    mode_data_t *k = &keys[num_keys++];
+
+    memset(k, 0, sizeof(mode_data_t));
+    k->timings.h_synclen = t->h_synclen;
+    k->timings.v_hz_max = t->v_hz_max ? t->v_hz_max : 60;
+    k->timings.v_total = t->v_total;
+    k->timings.interlaced = t->interlaced;
+}
+
+static void add_hdmi_key(const sync_timings_t *t) {
+    mode_data_t *k = &keys[num_keys++];
+
+    memset(k, 0, sizeof(mode_data_t));
+    snprintf(k->name, 14, "%ux%u%c", t->h_active, t->v_active<<t->interlaced, t->interlaced ? 'i' : ' ');
+    k->timings.h_active = t->h_active;
+    k->timings.v_active = t->v_active;
+    k->timings.v_hz_max = t->v_hz_max ? t->v_hz_max : 60;
+    k->timings.h_total = t->h_total;
+    k->timings.v_total = t->v_total;
+    k->timings.h_backporch = t->h_backporch;
+    k->timings.v_backporch = t->v_backporch;
+    k->timings.h_synclen = t->h_synclen;
+    k->timings.v_synclen = t->v_synclen;
+    k->timings.interlaced = t->interlaced;
+}
+
+static int lookup(mode_data_t *key, uint8_t *amode_match) {
+    mode_data_t vm_in, vm_out;
+    vm_mult_config_t vm_conf;
+    int mode;
+
+    memcpy(&vm_in, key, sizeof(mode_data_t));
+    mode = get_adaptive_lm_mode(&vm_in, &vm_out, &vm_conf);
+    *amode_match = (mode >= 0);
+    if (mode < 0)
+        mode = get_pure_lm_mode(&vm_in, &vm_out, &vm_conf);
+
+    return mode;
+}
+
+// First candidate entries for a key, found by scanning full tables with avconfig filters
+// as lookups did before vm_index_t, and through the index. Preset specific 400p/480p
+// checks and config calculation are the same for both and left out.
+static int find_linear(mode_data_t *key, int *ad) {
+    avconfig_t *cc = get_vm_avconfig();
+    smp_preset_t *smp_preset;
+    ad_mode_id_t target_ad_id;
+    smp_mode_t target_sm;
+    mode_flags target_lm;
+    uint8_t hdmi = !!key->timings.h_total;
+    uint8_t il = key->timings.interlaced;
+    int i;
+
+    *ad = -1;
+    for (i=0; i<NUM_ADAPTIVE_MODES; i++) {
+        smp_preset = &smp_presets_default[adaptive_modes[i].smp_preset_id];
+        get_ad_target(cc, smp_preset->group, &target_ad_id, &target_sm);
+        if ((smp_preset->timings_i.interlaced != il) || (target_ad_id != adaptive_modes[i].id) || (!hdmi && (target_sm != smp_preset->sm)))
+            continue;
+        if (smp_preset->timings_i.v_hz_max && (key->timings.v_hz_max > smp_preset->timings_i.v_hz_max))
+            continue;
+        if (((adaptive_modes[i].v_total_override && (key->timings.v_total == adaptive_modes[i].v_total_override)) || (!adaptive_modes[i].v_total_override && (key->timings.v_total == smp_preset->timings_i.v_total))) &&
+            (!key->timings.h_total || (key->timings.h_total == smp_preset->timings_i.h_total)))
+        {
+            *ad = i;
+            break;
+        }
+    }
+
+    for (i=0; i<NUM_VIDEO_MODES; i++) {
+        target_lm = hdmi ? MODE_PT : get_pure_lm_target(cc, video_modes[i].group);
+        if (!(target_lm & video_modes[i].flags) || (video_modes[i].timings.interlaced != il))
+            continue;
+        if (video_modes[i].timings.v_hz_max && (key->timings.v_hz_max > video_modes[i].timings.v_hz_max))
+            continue;
+        if (key->timings.v_total <= (video_modes[i].timings.v_total+LINECNT_MAX_TOLERANCE))
+            return i;
+    }
+
+    return -1;
+}
+
+static int find_indexed(mode_data_t *key, int *ad) {
+    smp_preset_t *smp_preset;
+    uint8_t hdmi = !!key->timings.h_total;
+    uint8_t il = key->timings.interlaced;
+    vm_index_t *idx = get_vm_index();
+    int i, j, b;
+
+    *ad = -1;
+    for (j=0; j<idx->ad_list_len[hdmi][il]; j++) {
+        i = idx->ad_list[hdmi][il][j];
+        smp_preset = &smp_presets_default[adaptive_modes[i].smp_preset_id];
+        if (smp_preset->timings_i.v_hz_max && (key->timings.v_hz_max > smp_preset->timings_i.v_hz_max))
+            continue;
+        if (((adaptive_modes[i].v_total_override && (key->timings.v_total == adaptive_modes[i].v_total_override)) || (!adaptive_modes[i].v_total_override && (key->timings.v_total == smp_preset->timings_i.v_total))) &&
+            (!key->timings.h_total || (key->timings.h_total == smp_preset->timings_i.h_total)))
+        {
+            *ad = i;
+            break;
+        }
+    }
+
+    b = key->timings.v_total>>VM_IDX_VTOTAL_SHIFT;
+    if (b > VM_IDX_VTOTAL_BUCKETS-1)
+        b = VM_IDX_VTOTAL_BUCKETS-1;
+    for (j=idx->pm_list_start[hdmi][il][b]; j<idx->pm_list_len[hdmi][il]; j++) {
+        i = idx->pm_list[hdmi][il][j];
+        if (video_modes[i].timings.v_hz_max && (key->timings.v_hz_max > video_modes[i].timings.v_hz_max))
+            continue;
+        if (key->timings.v_total <= (video_modes[i].timings.v_total+LINECNT_MAX_TOLERANCE))
+            return i;
+    }
+
+    return -1;
+}
+
+static void report(const char *name, uint64_t t_ns, unsigned ops) {
+    printf("%-28s %9u ops %10.1f ns/op\n", name, ops, (double)t_ns/ops);
+}
+
+int main(int argc, char **argv) {
+    unsigned i, r, rounds = (argc > 1) ? atoi(argv[1]) : 1000;
+    unsigned n_ad=0, n_pm=0, n_none=0, n_diff=0;
+    int ad_lin, ad_idx;
+    mode_data_t vm_in, vm_out;
+    vm_mult_config_t vm_conf;
+    si5351_ms_config_t ms_conf;
+    int32_t err_ppb;
+    uint8_t amode_match;
+    uint64_t t;
+    volatile int sink = 0;
+
+    set_default_avconfig(1);
+
+    for (i=0; i<NUM_VIDEO_MODES; i++) {
+        add_analog_key(&video_modes_default[i].timings);
+        add_hdmi_key(&video_modes_default[i].timings);
+    }
+    for (i=0; i<NUM_SMP_PRESETS; i++)
+        add_analog_key(&smp_presets_default[i].timings_i);
+
+    for (i=0; i<num_keys; i++) {
+        if (lookup(&keys[i], &amode_match) < 0)
+            n_none++;
+        else if (amode_match)
+            n_ad++;
+        else
+            n_pm++;
+    }
+    printf("%u video modes, %u adaptive modes, %u presets\n", (unsigned)NUM_VIDEO_MODES, (unsigned)NUM_ADAPTIVE_MODES, (unsigned)NUM_SMP_PRESETS);
+    printf("%u keys: %u adaptive, %u pure, %u unmatched\n", num_keys, n_ad, n_pm, n_none);
+
+    for (i=0; i<num_keys; i++) {
+        if ((find_linear(&keys[i], &ad_lin) != find_indexed(&keys[i], &ad_idx)) || (ad_lin != ad_idx))
+            n_diff++;
+    }
+    printf("%u keys with different candidates in linear and indexed search\n\n", n_diff);
+
+    t = now_ns();
+    for (r=0; r<rounds; r++) {
+        vm_idx.valid = 0;
+        build_vm_index(&vm_idx);
+    }
+    report("index build", now_ns()-t, rounds);
+
+    t = now_ns();
+    for (r=0; r<rounds; r++) {
+        for (i=0; i<num_keys; i++)
+            sink += find_linear(&keys[i], &ad_lin) + ad_lin;
+    }
+    report("candidate search, linear", now_ns()-t, rounds*num_keys);
+
+    t = now_ns();
+    for (r=0; r<rounds; r++) {
+        for (i=0; i<num_keys; i++)
+            sink += find_indexed(&keys[i], &ad_idx) + ad_idx;
+    }
+    report("candidate search, indexed", now_ns()-t, rounds*num_keys);
+
+    t = now_ns();
+    for (r=0; r<rounds; r++) {
+        for (i=0; i<num_keys; i++)
+            sink += lookup(&keys[i], &amode_match);
+    }
+    report("indexed lookup", now_ns()-t, rounds*num_keys);
+
+    // keys cycled within cache size
+    t = now_ns();
+    for (r=0; r<rounds; r++) {
+        for (i=0; i<num_keys; i++) {
+            memcpy(&vm_in, &keys[i%VM_CACHE_SIZE], sizeof(mode_data_t));
+            sink += get_lm_mode(&vm_in, &vm_out, &vm_conf, &amode_match);
+        }
+    }
+    report("get_lm_mode, cache hit", now_ns()-t, rounds*num_keys);
+
+    // every key misses with cache size smaller than key count
+    t = now_ns();
+    for (r=0; r<rounds; r++) {
+        for (i=0; i<num_keys; i++) {
+            memcpy(&vm_in, &keys[i], sizeof(mode_data_t));
+            sink += get_lm_mode(&vm_in, &vm_out, &vm_conf, &amode_match);
+        }
+    }
+    report("get_lm_mode, cache miss", now_ns()-t, rounds*num_keys);
+
+    // 1080p output locked to 240p input with drifting frame rate
+    t = now_ns();
+    for (r=0; r<rounds; r++)
+        sink += si5351_calc_frac_mult(858*262*60, 2200*1125, 858*262+(r%97), &ms_conf, &err_ppb);
+    report("Si5351 solver", now_ns()-t, rounds);
+
+    t = now_ns();
+    for (r=0; r<rounds; r++)
+        sink += si5351_calc_frac_mult(858*262*60, 2200*1125, 858*262, &ms_conf, &err_ppb);
+    report("Si5351 solver, cache hit", now_ns()-t, rounds);
+
+    return (n_diff > 0);
+}
@@ -0,0 +1,414 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+// Replays a timestamped event trace through init_events()/wait_events() of
+// events.c against simulated PIO edge capture, event unit and WFI, and reports
+// event-to-handler latency per source next to what the former 10ms polled
+// loop would have given. Trace lines are "<time_us> <source>" with sources
+// listed in sources[], '#' starts a comment. Without a trace file a random
+// trace is generated. Mainloop tick edge is generated every
+// MAINLOOP_INTERVAL_US as by ossc_pro.v. Returns nonzero if an event is lost,
+// WFI never wakes up or latency exceeds LAT_LIMIT_US.
+//   ev_replay.bin [-c handler_us] [trace_file]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "system.h"
+#include "altera_avalon_pio_regs.h"
+#include "sysconfig.h"
+#include "i2c_opencores.h"
+#include "av_controller.h"
+#include "controls.h"
+
+#undef printf
+
+// simulated register access, see sim_* below
+#undef IORD_ALTERA_AVALON_PIO_EDGE_CAP
+#undef IOWR_ALTERA_AVALON_PIO_EDGE_CAP
+#undef IOWR_ALTERA_AVALON_PIO_IRQ_MASK
+#undef EU_IRQ_ENABLE
+#undef EU_IRQ_PENDING
+#undef EU_IRQ_CLEAR_PENDING
+#undef cpu_irq_disable
+#undef cpu_wfi
+#define IORD_ALTERA_AVALON_PIO_EDGE_CAP(base)       sim_pio_rd_cap(base)
+#define IOWR_ALTERA_AVALON_PIO_EDGE_CAP(base, data) sim_pio_wr_cap(base, data)
+#define IOWR_ALTERA_AVALON_PIO_IRQ_MASK(base, data) sim_pio_wr_mask(base, data)
+#define EU_IRQ_ENABLE                               (*sim_eu_reg(&eu_enable))
+#define EU_IRQ_PENDING                              (*sim_eu_reg(&eu_pending))
+#define EU_IRQ_CLEAR_PENDING                        (*sim_eu_reg(&eu_icp))
+#define cpu_irq_disable()                           sim_irq_disable()
+#define cpu_wfi()                                   sim_wfi()
+
+static uint32_t sim_pio_rd_cap(uint32_t base);
+static void sim_pio_wr_cap(uint32_t base, uint32_t data);
+static void sim_pio_wr_mask(uint32_t base, uint32_t data);
+static uint32_t *sim_eu_reg(uint32_t *reg);
+static void sim_irq_disable();
+static void sim_wfi();
+static uint32_t eu_enable, eu_pending, eu_icp;
+
+#include "../src/events.c"
+
+// cost model in ns
+#define ACCESS_NS       100     // register access
+#define I2C_SERVICE_NS  1000    // I2C_queue_service() without transfer in progress
+#define WAKE_NS         500     // WFI exit
+#define HANDLER_US      200     // mainloop body after wait_events(), -c to override
+
+#define LAT_LIMIT_US    1000
+#define TICK_NS         (MAINLOOP_INTERVAL_US*1000ULL)
+#define HANG_TICKS      10
+
+#define RAND_EVENTS     5000
+#define RAND_SEED       12345
+
+static const struct {
+    const char *name;
+    uint8_t pio;
+    uint8_t bit;
+} sources[] = {
+    {"sd",       1, SSTAT_SD_DETECT_BIT},
+    {"isl",      1, SSTAT_ISL_INT_BIT},
+    {"hdmirx",   1, SSTAT_HDMIRX_INT_BIT},
+    {"hdmitx",   1, SSTAT_HDMITX_INT_BIT},
+    {"syncmeas", 1, SSTAT_SYNC_MEAS_BIT},
+    {"rc",       0, CONTROLS_RRPT_OFFS},
+    {"btn0",     0, CONTROLS_BTN_OFFS},
+    {"btn1",     0, CONTROLS_BTN_OFFS+1},
+};
+#define NUM_SOURCES (int)(sizeof(sources)/sizeof(sources[0]))
+#define SRC_TICK    -1
+
+typedef struct {
+    uint64_t t_ns;
+    int src;
+} trace_ev_t;
+
+typedef struct {
+    unsigned events, handled, coalesced;
+    uint64_t lat_sum, lat_max, poll_sum, poll_max;
+} src_stats_t;
+
+static trace_ev_t *trace;
+static unsigned trace_len, trace_pos;
+
+static uint64_t now, next_tick = TICK_NS;
+static int mie = 1, hang;
+
+// PIO_1 and PIO_2 state, pending edge arrival time and source
+static uint32_t cap[2], irq_mask[2];
+static uint64_t t_edge[2][32];
+static int edge_src[2][32];
+
+static src_stats_t stats[NUM_SOURCES];
+static unsigned n_wait, n_wfi, n_i2c_service, n_spurious;
+
+// event unit latches IRQ lines, which stay asserted while PIO has unmasked edges
+static void eu_update() {
+    eu_pending &= ~eu_icp;
+    eu_icp = 0;
+    if (cap[0] & irq_mask[0])
+        eu_pending |= (1<<PIO_1_IRQ);
+    if (cap[1] & irq_mask[1])
+        eu_pending |= (1<<PIO_2_IRQ);
+
+    if (mie && (eu_pending & eu_enable)) {
+        printf("FAIL: IRQ taken at %llu ns with MIE set, no handler installed\n", (unsigned long long)now);
+        exit(1);
+    }
+}
+
+static void edge(int pio, int bit, int src, uint64_t t) {
+    if (cap[pio] & (1<<bit)) {
+        if (src >= 0)
+            stats[src].coalesced++;
+        return;
+    }
+    cap[pio] |= (1<<bit);
+    t_edge[pio][bit] = t;
+    edge_src[pio][bit] = src;
+}
+
+// apply trace events and ticks up to time t
+static void advance_to(uint64_t t) {
+    while (1) {
+        uint64_t t_next = (trace_pos < trace_len) ? trace[trace_pos].t_ns : UINT64_MAX;
+
+        if (next_tick <= t_next && next_tick <= t) {
+            edge(1, SSTAT_MAINLOOP_TICK_BIT, SRC_TICK, next_tick);
+            next_tick += TICK_NS;
+        } else if (t_next <= t) {
+            edge(sources[trace[trace_pos].src].pio, sources[trace[trace_pos].src].bit, trace[trace_pos].src, t_next);
+            trace_pos++;
+        } else {
+            break;
+        }
+    }
+    now = t;
+    eu_update();
+}
+
+static void step(uint64_t ns) {
+    advance_to(now+ns);
+}
+
+static int pio_idx(uint32_t base) {
+    if (base == PIO_1_BASE)
+        return 0;
+    if (base == PIO_2_BASE)
+        return 1;
+    printf("FAIL: access to unknown PIO 0x%lx\n", (unsigned long)base);
+    exit(1);
+}
+
+static uint32_t sim_pio_rd_cap(uint32_t base) {
+    step(ACCESS_NS);
+    return cap[pio_idx(base)];
+}
+
+static void sim_pio_wr_cap(uint32_t base, uint32_t data) {
+    step(ACCESS_NS);
+    cap[pio_idx(base)] &= ~data;
+    eu_update();
+}
+
+static void sim_pio_wr_mask(uint32_t base, uint32_t data) {
+    step(ACCESS_NS);
+    irq_mask[pio_idx(base)] = data;
+    eu_update();
+}
+
+// writes land in the variable and take effect on next access
+static uint32_t *sim_eu_reg(uint32_t *reg) {
+    step(ACCESS_NS);
+    return reg;
+}
+
+static void sim_irq_disable() {
+    mie = 0;
+}
+
+// sleep until an enabled IRQ is pending
+static void sim_wfi() {
+    uint64_t t_next;
+
+    n_wfi++;
+    eu_update();
+
+    while (!(eu_pending & eu_enable)) {
+        t_next = (trace_pos < trace_len && trace[trace_pos].t_ns < next_tick) ? trace[trace_pos].t_ns : next_tick;
+        if ((trace_pos == trace_len) && (t_next > trace[trace_len-1].t_ns + HANG_TICKS*TICK_NS)) {
+            hang = 1;
+            return;
+        }
+        advance_to(t_next);
+    }
+
+    step(WAKE_NS);
+}
+
+int I2C_queue_service(I2C_queue *q) {
+    n_i2c_service++;
+    step(I2C_SERVICE_NS);
+    return 0;
+}
+
+void si_seq_service() {}
+
+I2C_queue i2c_qa;
+
+static void handle(int pio, uint32_t ev) {
+    src_stats_t *s;
+    uint64_t lat, poll;
+    int bit, src;
+
+    for (bit=0; bit<32; bit++) {
+        if (!(ev & (1<<bit)))
+            continue;
+        src = edge_src[pio][bit];
+        if (src == SRC_TICK)
+            continue;
+
+        // polled loop noticed events only after next tick
+        s = &stats[src];
+        lat = now - t_edge[pio][bit];
+        poll = TICK_NS - (t_edge[pio][bit] % TICK_NS);
+        s->handled++;
+        s->lat_sum += lat;
+        s->poll_sum += poll;
+        if (lat > s->lat_max)
+            s->lat_max = lat;
+        if (poll > s->poll_max)
+            s->poll_max = poll;
+    }
+}
+
+static int trace_cmp(const void *a, const void *b) {
+    const trace_ev_t *ta = a, *tb = b;
+    return (ta->t_ns > tb->t_ns) - (ta->t_ns < tb->t_ns);
+}
+
+static int load_trace(const char *fname) {
+    FILE *f;
+    char line[128], name[32];
+    double t_us;
+    unsigned cap_len = 0;
+    int i, lineno = 0;
+
+    if ((f = fopen(fname, "r")) == NULL) {
+        printf("Cannot open %s\n", fname);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        if ((line[0] == '#') || (sscanf(line, "%lf %31s", &t_us, name) != 2))
+            continue;
+        for (i=0; i<NUM_SOURCES; i++) {
+            if (!strcmp(name, sources[i].name))
+                break;
+        }
+        if ((i == NUM_SOURCES) || (t_us < 0)) {
+            printf("%s:%d: invalid event\n", fname, lineno);
+            fclose(f);
+            return -1;
+        }
+        if (trace_len == cap_len) {
+            cap_len = cap_len ? 2*cap_len : 256;
+            trace = realloc(trace, cap_len*sizeof(trace_ev_t));
+        }
+        trace[trace_len].t_ns = (uint64_t)(t_us*1000.0);
+        trace[trace_len].src = i;
+        trace_len++;
+    }
+
+    fclose(f);
+    return 0;
+}
+
+// random sources with gaps up to 2 ticks, every 8th event closely after previous
+static void gen_trace() {
+    uint64_t t = 0;
+    unsigned i;
+
+    srand(RAND_SEED);
+    trace = malloc(RAND_EVENTS*sizeof(trace_ev_t));
+    for (i=0; i<RAND_EVENTS; i++) {
+        if ((rand() % 8) == 0)
+            t += rand() % 50000;
+        else
+            t += rand() % (2*TICK_NS);
+        trace[i].t_ns = t;
+        trace[i].src = rand() % NUM_SOURCES;
+    }
+    trace_len = RAND_EVENTS;
+}
+
+int main(int argc, char **argv) {
+    src_stats_t *s, tot = {0};
+    uint64_t handler_ns = HANDLER_US*1000ULL;
+    unsigned lost = 0, trace_pending;
+    int i, pio, bit, fail = 0;
+
+    for (i=1; i<argc; i++) {
+        if (!strcmp(argv[i], "-c") && (i+1 < argc)) {
+            handler_ns = strtoul(argv[++i], NULL, 0)*1000ULL;
+        } else if (load_trace(argv[i]) != 0) {
+            return 1;
+        }
+    }
+    if (trace_len == 0)
+        gen_trace();
+    qsort(trace, trace_len, sizeof(trace_ev_t), trace_cmp);
+    for (i=0; i<(int)trace_len; i++)
+        stats[trace[i].src].events++;
+
+    init_events();
+    if (mie || ((eu_enable & ((1<<PIO_1_IRQ)|(1<<PIO_2_IRQ))) != ((1<<PIO_1_IRQ)|(1<<PIO_2_IRQ)))) {
+        printf("FAIL: init_events() left MIE=%d, event unit enable 0x%lx\n", mie, (unsigned long)eu_enable);
+        return 1;
+    }
+
+    while (1) {
+        n_wait++;
+        wait_events();
+        if (hang) {
+            printf("FAIL: WFI did not wake up at %llu ns\n", (unsigned long long)now);
+            fail = 1;
+            break;
+        }
+        if (!ev_controls && !ev_sys_status)
+            n_spurious++;
+        handle(0, ev_controls);
+        handle(1, ev_sys_status);
+
+        trace_pending = 0;
+        for (pio=0; pio<2; pio++) {
+            for (bit=0; bit<32; bit++) {
+                if ((cap[pio] & (1<<bit)) && (edge_src[pio][bit] != SRC_TICK))
+                    trace_pending++;
+            }
+        }
+        if ((trace_pos == trace_len) && !trace_pending)
+            break;
+
+        step(handler_ns);
+    }
+
+    printf("# handler %llu us, %u events over %llu ms, %u waits, %u WFI, %u I2C services, %u empty returns\n",
+           (unsigned long long)(handler_ns/1000), trace_len, (unsigned long long)(now/1000000), n_wait, n_wfi, n_i2c_service, n_spurious);
+    printf("# source   events  handled coalesced  lat_avg  lat_max  poll_avg poll_max (us)\n");
+    for (i=0; i<NUM_SOURCES; i++) {
+        s = &stats[i];
+        if (s->events == 0)
+            continue;
+        if (s->handled + s->coalesced != s->events)
+            lost += s->events - s->handled - s->coalesced;
+        printf("%-9s %7u %8u %9u %8llu %8llu %9llu %8llu\n", sources[i].name, s->events, s->handled, s->coalesced,
+               (unsigned long long)(s->handled ? s->lat_sum/s->handled/1000 : 0), (unsigned long long)(s->lat_max/1000),
+               (unsigned long long)(s->handled ? s->poll_sum/s->handled/1000 : 0), (unsigned long long)(s->poll_max/1000));
+        tot.events += s->events;
+        tot.handled += s->handled;
+        tot.coalesced += s->coalesced;
+        tot.lat_sum += s->lat_sum;
+        tot.poll_sum += s->poll_sum;
+        if (s->lat_max > tot.lat_max)
+            tot.lat_max = s->lat_max;
+        if (s->poll_max > tot.poll_max)
+            tot.poll_max = s->poll_max;
+    }
+    printf("%-9s %7u %8u %9u %8llu %8llu %9llu %8llu\n", "all", tot.events, tot.handled, tot.coalesced,
+           (unsigned long long)(tot.handled ? tot.lat_sum/tot.handled/1000 : 0), (unsigned long long)(tot.lat_max/1000),
+           (unsigned long long)(tot.handled ? tot.poll_sum/tot.handled/1000 : 0), (unsigned long long)(tot.poll_max/1000));
+
+    if (lost) {
+        printf("FAIL: %u events lost\n", lost);
+        fail = 1;
+    }
+    if (tot.lat_max > LAT_LIMIT_US*1000ULL) {
+        printf("FAIL: max latency %llu us above %u us\n", (unsigned long long)(tot.lat_max/1000), LAT_LIMIT_US);
+        fail = 1;
+    }
+
+    return fail;
+}
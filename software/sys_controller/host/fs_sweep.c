@@ -0,0 +1,186 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+// Runs adaptive and pure lookup for every video_modes_default entry as analog
+// source, for several linebuf depths, and checks linebuf framestart window of
+// get_framesync_bounds() against a straightforward 64-bit model evaluated for
+// every output line. Vertical scaling window is checked for progressive pure
+// modes with a set of fractional steps, as get_vscale_config() would use for
+// sources shorter than output. Prints chosen framesync_line per mode and
+// returns nonzero on any mismatch.
+
+#include <stdio.h>
+// included for static helpers
+#include "../src/video_modes.c"
+
+#undef printf
+
+static const uint8_t lb_depths[] = {16, 32, LINEBUF_LINES_DEFAULT, 64, 128};
+
+// vscale source heights as fraction of output height, numerator/denominator
+static const uint8_t vs_ratios[][2] = {{1, 4}, {1, 3}, {1, 2}, {2, 3}, {5, 6}};
+
+// reference model, see get_framesync_bounds()
+static int ref_framesync_bounds(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *vm_conf, uint32_t step_num, uint32_t step_den, uint8_t vscale, int32_t *d_min, int32_t *d_max, int32_t *latency)
+{
+    int64_t r_num, r_den, t_write, t_reuse, d;
+    int32_t L, L0, v_first, v_last, s, s_lo, s_hi, s_first=-1;
+    int32_t in_il = vm_in->timings.interlaced ? 2 : 1;
+    int32_t out_il = vm_out->timings.interlaced ? 2 : 1;
+    int32_t in_vstart = vm_in->timings.v_synclen + vm_in->timings.v_backporch;
+    int32_t y_offset = vm_conf->y_offset;
+
+    r_num = vm_out->timings.v_total * in_il;
+    r_den = vm_in->timings.v_total * out_il;
+
+    L0 = vm_out->timings.v_synclen + vm_out->timings.v_backporch;
+    v_first = L0 + ((y_offset < 0) ? 0 : y_offset);
+    v_last = L0 + y_offset + vm_conf->y_size - 1;
+    if (v_last > L0 + vm_out->timings.v_active - 1)
+        v_last = L0 + vm_out->timings.v_active - 1;
+
+    *d_min = INT32_MIN;
+    *d_max = INT32_MAX;
+
+    for (L=v_first; L<=v_last; L++) {
+        s = vm_conf->y_start_lb + (int32_t)(((int64_t)(L-L0)*step_num)/step_den);
+
+        s_lo = s - (vm_in->timings.interlaced ? 1 : 0);
+        s_hi = s + vscale + ((vm_conf->y_rpt == (uint8_t)(-1)) && vm_out->timings.interlaced ? 1 : 0);
+        if (s_lo < 0)
+            s_lo = 0;
+        if (s_hi < 0)
+            continue;
+        if (s_first < 0)
+            s_first = s_hi;
+
+        t_write = (in_vstart + s_hi + 1) * r_num;
+        d = L - ((t_write + r_den - 1) / r_den);
+        if (d < *d_max)
+            *d_max = d;
+
+        if (s_lo + linebuf_lines < vm_in->timings.v_active)
+            t_reuse = (in_vstart + s_lo + linebuf_lines) * r_num;
+        else
+            t_reuse = (vm_out->timings.v_total / out_il) * r_den + (in_vstart + (s_lo % linebuf_lines)) * r_num;
+        d = L + 1 - (t_reuse / r_den);
+        if (d > *d_min)
+            *d_min = d;
+    }
+
+    if ((s_first < 0) || (*d_min > *d_max))
+        return -1;
+
+    *latency = (int32_t)(((v_first - *d_max) * r_den - (in_vstart + s_first) * r_num) / r_den);
+
+    return 0;
+}
+
+// compare both models for one setup, returns 0 if they agree
+static int check_bounds(const char *type, const char *name, mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *vm_conf, uint32_t step_num, uint32_t step_den, uint8_t vscale)
+{
+    int32_t d_min=0, d_max=0, latency=0, r_min=0, r_max=0, r_latency=0;
+    int ret, r_ret;
+
+    ret = get_framesync_bounds(vm_in, vm_out, vm_conf, step_num, step_den, vscale, &d_min, &d_max, &latency);
+    r_ret = ref_framesync_bounds(vm_in, vm_out, vm_conf, step_num, step_den, vscale, &r_min, &r_max, &r_latency);
+
+    printf("%-6s %-14s %-14s %3u", type, name, vm_out->name, linebuf_lines);
+    if (r_ret != 0)
+        printf("      -      -      -    -");
+    else
+        printf(" %6d %6d %6d %4u", (int)r_min, (int)r_max, (int)r_latency, framesync_line_from_diff(vm_out, r_max));
+
+    if ((ret != r_ret) || ((ret == 0) && ((d_min != r_min) || (d_max != r_max) || (latency != r_latency)))) {
+        printf("  MISMATCH %d %d %d %d\n", ret, (int)d_min, (int)d_max, (int)latency);
+        return 1;
+    }
+    printf("\n");
+
+    return 0;
+}
+
+int main() {
+    mode_data_t vm_key, vm_in, vm_out;
+    vm_mult_config_t vm_conf;
+    const mode_data_t *m;
+    int32_t src_h, dst_h;
+    uint32_t step;
+    unsigned i, j, k, n_ad=0, n_pm=0, n_vs=0, n_err=0;
+
+    set_default_avconfig(1);
+
+    printf("# type name output lb_lines d_min d_max latency framesync_line\n");
+
+    for (j=0; j<sizeof(lb_depths)/sizeof(lb_depths[0]); j++) {
+        set_linebuf_lines(lb_depths[j]);
+
+        for (i=0; i<NUM_VIDEO_MODES; i++) {
+            // lookup key as mainloop builds it from ISL51002 sync measurements
+            m = &video_modes_default[i];
+            memset(&vm_key, 0, sizeof(mode_data_t));
+            vm_key.timings.h_synclen = m->timings.h_synclen;
+            vm_key.timings.v_hz_max = m->timings.v_hz_max ? m->timings.v_hz_max : 60;
+            vm_key.timings.v_total = m->timings.v_total;
+            vm_key.timings.interlaced = m->timings.interlaced;
+
+            // called directly to bypass mode cache of get_lm_mode()
+            memcpy(&vm_in, &vm_key, sizeof(mode_data_t));
+            if (get_adaptive_lm_mode(&vm_in, &vm_out, &vm_conf) >= 0) {
+                n_ad++;
+                if (vm_conf.y_rpt == (uint8_t)(-1))
+                    n_err += check_bounds("adapt", m->name, &vm_in, &vm_out, &vm_conf, 2, 1, 0);
+                else
+                    n_err += check_bounds("adapt", m->name, &vm_in, &vm_out, &vm_conf, 1, vm_conf.y_rpt+1, 0);
+            }
+
+            memcpy(&vm_in, &vm_key, sizeof(mode_data_t));
+            if (get_pure_lm_mode(&vm_in, &vm_out, &vm_conf) < 0)
+                continue;
+            n_pm++;
+            if (vm_conf.y_rpt == (uint8_t)(-1))
+                n_err += check_bounds("pure", m->name, &vm_in, &vm_out, &vm_conf, 2, 1, 0);
+            else
+                n_err += check_bounds("pure", m->name, &vm_in, &vm_out, &vm_conf, 1, vm_conf.y_rpt+1, 0);
+
+            // setup as in get_vscale_config(), with source height swept
+            if (vm_in.timings.interlaced || vm_out.timings.interlaced || (vm_conf.y_rpt == (uint8_t)(-1)))
+                continue;
+            dst_h = vm_out.timings.v_active;
+            vm_conf.y_rpt = 0;
+            vm_conf.y_offset = 0;
+            vm_conf.y_size = dst_h;
+            if (vm_conf.y_start_lb < 0)
+                vm_conf.y_start_lb = 0;
+            for (k=0; k<sizeof(vs_ratios)/sizeof(vs_ratios[0]); k++) {
+                src_h = (dst_h*vs_ratios[k][0])/vs_ratios[k][1];
+                if (src_h == 0)
+                    continue;
+                step = ((uint32_t)src_h<<16)/dst_h;
+                n_vs++;
+                n_err += check_bounds("vscale", m->name, &vm_in, &vm_out, &vm_conf, step, 1<<16, 1);
+            }
+        }
+    }
+
+    printf("%u adaptive, %u pure, %u vscale setups checked, %u mismatches\n", n_ad, n_pm, n_vs, n_err);
+
+    return (n_err > 0);
+}
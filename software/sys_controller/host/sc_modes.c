@@ -0,0 +1,107 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Resolves every video_modes_default entry as an analog source with default
+// settings and prints scanconverter config words as update_sc_config() would
+// write them, one mode per line. Used as stimulus by rtl/sim scanconverter
+// bench. Clock ratio is given as PCLK_OUT/PCLK_IN = clk_num/clk_den.
+
+#include <stdio.h>
+// included for table size
+#include "../src/video_modes.c"
+#include "sc_config.h"
+
+#undef printf
+
+static uint64_t gcd(uint64_t a, uint64_t b) {
+    uint64_t t;
+
+    while (b) {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+int main() {
+    mode_data_t vm_in, vm_out;
+    vm_mult_config_t vm_conf;
+    sc_config_t cfg;
+    const sync_timings_t *t;
+    uint64_t clk_num, clk_den, g;
+    uint32_t pll_h_total, h_hz, pclk_i_hz;
+    uint8_t amode_match;
+    char name[15];
+    unsigned i, j;
+
+    set_default_avconfig(1);
+
+    printf("# name amode y_rpt pll_h_total h_active h_synclen h_backporch v_total v_active v_synclen v_backporch interlaced h_skip pclk_i_hz clk_num clk_den "
+           "hv_out_config hv_out_config2 hv_out_config3 xy_out_config xy_out_config2 misc_config hscale_config vscale_config\n");
+
+    for (i=0; i<NUM_VIDEO_MODES; i++) {
+        // lookup key as mainloop builds it from ISL51002 sync measurements
+        t = &video_modes_default[i].timings;
+        memset(&vm_in, 0, sizeof(mode_data_t));
+        vm_in.timings.h_synclen = t->h_synclen;
+        vm_in.timings.v_hz_max = t->v_hz_max ? t->v_hz_max : 60;
+        vm_in.timings.v_total = t->v_total;
+        vm_in.timings.interlaced = t->interlaced;
+
+        if (get_lm_mode(&vm_in, &vm_out, &vm_conf, &amode_match) < 0) {
+            fprintf(stderr, "%s: no mode found\n", video_modes_default[i].name);
+            continue;
+        }
+
+        pll_h_total = (vm_conf.h_skip+1) * vm_in.timings.h_total + (((vm_conf.h_skip+1) * vm_in.timings.h_total_adj * 5 + 50) / 100);
+        h_hz = (vm_in.timings.v_hz_max * vm_in.timings.v_total) / (1+vm_in.timings.interlaced);
+        pclk_i_hz = h_hz * pll_h_total;
+
+        if (amode_match) {
+            clk_num = (uint64_t)vm_out.timings.h_total * vm_out.timings.v_total * (1+vm_in.timings.interlaced);
+            clk_den = (uint64_t)pll_h_total * vm_in.timings.v_total * (1+vm_out.timings.interlaced);
+        } else {
+            clk_num = vm_out.si_pclk_mult;
+            clk_den = 1;
+        }
+        g = gcd(clk_num, clk_den);
+
+        get_sc_config(&vm_in, &vm_out, &vm_conf, get_current_avconfig(), &cfg);
+
+        strncpy(name, video_modes_default[i].name, 14);
+        name[14] = 0;
+        for (j=0; name[j]; j++) {
+            if (name[j] == ' ')
+                name[j] = '_';
+        }
+
+        printf("%-14s %u %d %u %u %u %u %u %u %u %u %u %u %u %llu %llu 0x%.8x 0x%.8x 0x%.8x 0x%.8x 0x%.8x 0x%.8x 0x%.8x 0x%.8x\n",
+               name, amode_match, (int8_t)vm_conf.y_rpt, pll_h_total,
+               vm_in.timings.h_active, vm_in.timings.h_synclen, vm_in.timings.h_backporch,
+               vm_in.timings.v_total, vm_in.timings.v_active, vm_in.timings.v_synclen, vm_in.timings.v_backporch,
+               vm_in.timings.interlaced, vm_conf.h_skip, pclk_i_hz,
+               (unsigned long long)(clk_num/g), (unsigned long long)(clk_den/g),
+               cfg.hv_out_config.data, cfg.hv_out_config2.data, cfg.hv_out_config3.data,
+               cfg.xy_out_config.data, cfg.xy_out_config2.data, cfg.misc_config.data,
+               cfg.hscale_config.data, cfg.vscale_config.data);
+    }
+
+    return 0;
+}
@@ -0,0 +1,135 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Runs Si5351 solver for every video_modes_default entry, both as test
+// pattern output from crystal (as mainloop does) and as analog source for
+// adaptive modes. Adaptive lookup is run as is, with solver calls recorded
+// through a wrapper, so that entries with precalculated config are skipped
+// as in firmware. Prints resulting frequency error per mode and returns
+// nonzero if any mode has no valid config.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "si5351_calc.h"
+
+static int calc_calls, calc_ret;
+static uint32_t calc_fin_hz;
+static int32_t calc_err_ppb;
+
+static int sweep_calc_frac_mult(uint32_t fin_hz, uint32_t num, uint32_t den, si5351_ms_config_t *ms_conf, int32_t *err_ppb)
+{
+    calc_calls++;
+    calc_fin_hz = fin_hz;
+    calc_ret = si5351_calc_frac_mult(fin_hz, num, den, ms_conf, err_ppb);
+    calc_err_ppb = *err_ppb;
+    return calc_ret;
+}
+
+// included for table size and to route solver calls through wrapper
+#define si5351_calc_frac_mult sweep_calc_frac_mult
+#include "../src/video_modes.c"
+#undef si5351_calc_frac_mult
+
+#undef printf
+
+#define SI_XTAL_HZ  27000000UL
+
+static void print_result(const char *path, int ret, int32_t err_ppb, int32_t *err_max)
+{
+    if (ret != 0) {
+        printf(" %-5s   none\n", path);
+        return;
+    }
+    printf(" %-5s %6d\n", path, (int)err_ppb);
+    if (abs(err_ppb) > abs(*err_max))
+        *err_max = err_ppb;
+}
+
+int main() {
+    mode_data_t vm_in, vm_out;
+    vm_mult_config_t vm_conf;
+    si5351_ms_config_t ms_conf;
+    const mode_data_t *m;
+    uint32_t pclk_o_hz, pll_h_total, pclk_i_hz;
+    int32_t err_ppb, err_max=0;
+    int mode, ret;
+    unsigned i, n_tp=0, n_ad=0, n_fail=0;
+
+    set_default_avconfig(1);
+
+    // path: int = integer multiplier, table = precalculated config (solver
+    // result shown for reference only), calc = solved at mode switch
+    printf("# test pattern: name pclk_o_hz path err_ppb\n");
+    for (i=0; i<NUM_VIDEO_MODES; i++) {
+        m = &video_modes_default[i];
+        n_tp++;
+        if (m->si_pclk_mult > 0) {
+            printf("TP %-14s %10lu int        0\n", m->name, m->si_pclk_mult*SI_XTAL_HZ);
+            continue;
+        }
+
+        // same as test pattern path in mainloop
+        pclk_o_hz = (m->timings.h_total*m->timings.v_total*(m->timings.v_hz_max ? m->timings.v_hz_max : 60))/(1+m->timings.interlaced);
+        ret = si5351_calc_frac_mult(SI_XTAL_HZ, pclk_o_hz, SI_XTAL_HZ, &ms_conf, &err_ppb);
+        printf("TP %-14s %10u", m->name, pclk_o_hz);
+        print_result(m->si_ms_conf.pll_p3 ? "table" : "calc", ret, err_ppb, &err_max);
+        if (!m->si_ms_conf.pll_p3 && (ret != 0))
+            n_fail++;
+    }
+
+    printf("# adaptive: name output pclk_i_hz path err_ppb\n");
+    for (i=0; i<NUM_VIDEO_MODES; i++) {
+        // lookup key as mainloop builds it from ISL51002 sync measurements
+        m = &video_modes_default[i];
+        memset(&vm_in, 0, sizeof(mode_data_t));
+        vm_in.timings.h_synclen = m->timings.h_synclen;
+        vm_in.timings.v_hz_max = m->timings.v_hz_max ? m->timings.v_hz_max : 60;
+        vm_in.timings.v_total = m->timings.v_total;
+        vm_in.timings.interlaced = m->timings.interlaced;
+
+        // called directly to bypass mode cache of get_lm_mode()
+        calc_calls = 0;
+        mode = get_adaptive_lm_mode(&vm_in, &vm_out, &vm_conf);
+
+        if (calc_calls) {
+            // solver failure makes get_lm_mode() fall back to pure linemult
+            n_ad++;
+            printf("AD %-14s %-14s %10u", m->name, vm_out.name, calc_fin_hz);
+            print_result("calc", calc_ret, calc_err_ppb, &err_max);
+            if (calc_ret != 0)
+                n_fail++;
+        } else if (mode >= 0) {
+            // same parameters as solver call in get_adaptive_lm_mode()
+            n_ad++;
+            pll_h_total = (vm_conf.h_skip+1) * vm_in.timings.h_total + (((vm_conf.h_skip+1) * vm_in.timings.h_total_adj * 5 + 50) / 100);
+            pclk_i_hz = (pll_h_total * vm_in.timings.v_total * (vm_in.timings.v_hz_max ? vm_in.timings.v_hz_max : 60)) / (1+vm_in.timings.interlaced);
+            ret = si5351_calc_frac_mult(pclk_i_hz,
+                                        vm_out.timings.h_total * vm_out.timings.v_total * (1+vm_in.timings.interlaced),
+                                        pll_h_total * vm_in.timings.v_total * (1+vm_out.timings.interlaced),
+                                        &ms_conf,
+                                        &err_ppb);
+            printf("AD %-14s %-14s %10u", m->name, vm_out.name, pclk_i_hz);
+            print_result("table", ret, err_ppb, &err_max);
+        }
+    }
+
+    printf("%u test pattern modes, %u adaptive modes, %u without config, max solver error %dppb\n", n_tp, n_ad, n_fail, (int)err_max);
+
+    return (n_fail > 0);
+}
@@ -0,0 +1,45 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+// Host replacements for driver and av_controller functions referenced by
+// avconfig.c. Default chip configs are left zeroed.
+
+#include <string.h>
+#include "avconfig.h"
+
+void isl_get_default_cfg(isl51002_config *cfg) {
+    memset(cfg, 0, sizeof(isl51002_config));
+}
+
+#ifdef INC_ADV7513
+void adv7513_get_default_cfg(adv7513_config *cfg) {
+    memset(cfg, 0, sizeof(adv7513_config));
+}
+#endif
+
+#ifdef INC_PCM186X
+void pcm186x_get_default_cfg(pcm186x_config *cfg) {
+    memset(cfg, 0, sizeof(pcm186x_config));
+}
+#endif
+
+void switch_audmux(uint8_t audmux_sel) {}
+
+void switch_audsrc(audinput_t *audsrc_map, HDMI_audio_fmt_t *aud_tx_fmt) {}
@@ -0,0 +1,45 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef AUTO_INPUT_H_
+#define AUTO_INPUT_H_
+
+#include <stdint.h>
+#include "av_controller.h"
+
+// idle time on current input before scanning starts
+#define AUTO_INPUT_IDLE_MS          2000
+// maximum time spent waiting for sync on a probed input
+#define AUTO_INPUT_DWELL_ISL_MS     300
+#define AUTO_INPUT_DWELL_HDMI_MS    1200
+
+typedef enum {
+    AUTO_OFF            = 0,
+    AUTO_CURRENT_INPUT  = 1,
+    AUTO_ALL_INPUTS     = 2
+} auto_input_mode_t;
+
+extern uint8_t auto_input, auto_av1_ypbpr, auto_av2_ypbpr, auto_av3_ypbpr;
+
+void auto_input_reset();
+
+avinput_t auto_input_select(avinput_t cur_input, uint8_t sync_active);
+
+#endif /* AUTO_INPUT_H_ */
@@ -49,6 +49,14 @@
 #define SSTAT_MEMSTAT_INIT_DONE_BIT     0
 #define SSTAT_MEMSTAT_POWERDN_ACK_BIT   3
 #define SSTAT_SD_DETECT_BIT             4
+#define SSTAT_ISL_INT_BIT               5
+#define SSTAT_HDMIRX_INT_BIT            6
+#define SSTAT_HDMITX_INT_BIT            7
+#define SSTAT_MAINLOOP_TICK_BIT         8
+#define SSTAT_SYNC_MEAS_BIT             9
+
+// sys_status bits which wake up mainloop
+#define SSTAT_EVENT_MASK                ((1<<SSTAT_SD_DETECT_BIT)|(1<<SSTAT_ISL_INT_BIT)|(1<<SSTAT_HDMIRX_INT_BIT)|(1<<SSTAT_HDMITX_INT_BIT)|(1<<SSTAT_MAINLOOP_TICK_BIT)|(1<<SSTAT_SYNC_MEAS_BIT))
 
 typedef enum {
     AV_TESTPAT      = 0,
@@ -85,6 +93,8 @@ void switch_audmux(uint8_t audmux_sel);
 
 void switch_audsrc(audinput_t *audsrc_map, HDMI_audio_fmt_t *aud_tx_fmt);
 
+int switch_profile(rc_code_t code);
+
 void switch_tp_mode(rc_code_t code);
 
 int sys_is_powered_on();
@@ -93,4 +103,16 @@ void sys_toggle_power();
 
 void print_vm_stats();
 
+void print_ms_stats();
+
+int export_mode_stats();
+
+int load_profile();
+
+int save_profile();
+
+int latency_test();
+
+void si_seq_service();
+
 #endif
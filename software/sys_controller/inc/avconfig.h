@@ -76,6 +76,17 @@ typedef enum {
     ACTIVITY_CHANGE     = 4
 } status_t;
 
+// Dirty flags for groups of target config fields
+#define AVC_DIRTY_SC        (1<<0)
+#define AVC_DIRTY_MODE      (1<<1)
+#define AVC_DIRTY_AUDIO     (1<<2)
+#define AVC_DIRTY_MISC      (1<<3)
+#define AVC_DIRTY_ISL       (1<<4)
+#define AVC_DIRTY_TX        (1<<5)
+#define AVC_DIRTY_HDMIRX    (1<<6)
+#define AVC_DIRTY_PCM       (1<<7)
+#define AVC_DIRTY_ALL       0xff
+
 typedef struct {
     uint8_t sl_mode;
     uint8_t sl_type;
@@ -128,6 +139,9 @@ typedef struct {
     uint8_t reverse_lpf;
     uint8_t default_vic;
     uint8_t audio_fmt;
+    uint8_t framebuffer;
+    uint8_t hscale;
+    uint8_t vscale;
     isl51002_config isl_cfg __attribute__ ((aligned (4)));
 #ifdef INC_ADV7513
     adv7513_config hdmitx_cfg __attribute__ ((aligned (4)));
@@ -147,8 +161,18 @@ int reset_target_avconfig();
 
 avconfig_t* get_current_avconfig();
 
+avconfig_t* get_target_avconfig();
+
 int set_default_avconfig(int update_cc);
 
+void set_avconfig_dirty(uint8_t mask);
+
+void set_avconfig_field_dirty(const void *field);
+
+uint8_t get_avconfig_changes(uint8_t mask);
+
 status_t update_avconfig();
 
+int get_lm_mode_avconfig(avconfig_t *avconfig, mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *vm_conf, uint8_t *amode_match);
+
 #endif
@@ -0,0 +1,41 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef FLASH_H_
+#define FLASH_H_
+
+#include <stdint.h>
+
+#define FLASH_SIZE          0x1000000
+#define FLASH_SUBSECTOR_SIZE 4096
+#define FLASH_SECTOR_SIZE   65536
+
+// Program granularity of flash_write(), offset and length must be aligned to it
+#define FLASH_WRITE_ALIGN   8
+
+int flash_read(uint32_t offset, uint32_t length, uint8_t *dstbuf);
+
+int flash_write(uint32_t offset, const uint8_t *srcbuf, uint32_t length);
+
+int flash_erase_subsector(uint32_t offset);
+
+const uint8_t* flash_ptr(uint32_t offset);
+
+#endif /* FLASH_H_ */
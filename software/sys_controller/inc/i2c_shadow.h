@@ -0,0 +1,68 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef I2C_SHADOW_H_
+#define I2C_SHADOW_H_
+
+#include <stdint.h>
+
+// Max number of unchanged (but known) registers rewritten to join two dirty
+// runs into one burst. Each extra transfer costs START+dev addr+reg addr.
+#define I2C_SHADOW_MAX_GAP 2
+
+// Max number of devices whose driver writes are filtered through shadow
+#define I2C_SHADOW_MAX_DEVS 6
+
+// Shadow copy of an I2C device register map (8-bit register address, auto-increment)
+typedef struct {
+    uint32_t i2cm_base;
+    uint8_t i2c_addr;
+    uint8_t regs[256];
+    uint32_t valid[256/32];
+    uint32_t dirty[256/32];
+    uint32_t nocache[256/32];
+    int16_t page_reg;
+    uint8_t page;
+} i2c_shadow_t;
+
+void i2c_shadow_init(i2c_shadow_t *sh, uint32_t i2cm_base, uint8_t i2c_addr);
+
+void i2c_shadow_set_nocache(i2c_shadow_t *sh, uint8_t regaddr);
+
+void i2c_shadow_set_nocache_range(i2c_shadow_t *sh, uint8_t first, uint8_t last);
+
+void i2c_shadow_set_pagereg(i2c_shadow_t *sh, uint8_t regaddr);
+
+int i2c_shadow_register(i2c_shadow_t *sh);
+
+uint32_t i2c_shadow_get_saved();
+
+void i2c_shadow_invalidate(i2c_shadow_t *sh);
+
+int i2c_shadow_readreg(i2c_shadow_t *sh, uint8_t regaddr, uint8_t *data);
+
+int i2c_shadow_writereg(i2c_shadow_t *sh, uint8_t regaddr, uint8_t data);
+
+void i2c_shadow_setreg(i2c_shadow_t *sh, uint8_t regaddr, uint8_t data);
+
+void i2c_shadow_update(i2c_shadow_t *sh, uint8_t regaddr, const uint8_t *data, int len);
+
+int i2c_shadow_flush(i2c_shadow_t *sh);
+
+#endif /* I2C_SHADOW_H_ */
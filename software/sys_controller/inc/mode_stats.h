@@ -0,0 +1,64 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef MODE_STATS_H_
+#define MODE_STATS_H_
+
+#include <stdint.h>
+
+#define MS_LOG_LEN 8
+
+typedef enum {
+    MSP_SYNC_STATS = 0,
+    MSP_MODE_SEARCH,
+    MSP_FE_SETUP,
+    MSP_SI5351,
+    MSP_SC_CONFIG,
+    MSP_TX_SETUP,
+    MSP_LAST
+} ms_phase_t;
+
+typedef struct {
+    char name[14];
+    uint8_t amode_match;
+    uint32_t phase_us[MSP_LAST];
+    uint32_t total_us;
+} ms_record_t;
+
+extern const char *ms_phase_str[];
+
+void ms_log_start();
+
+void ms_log_stop();
+
+int ms_log_active();
+
+void ms_log_mark();
+
+void ms_log_phase(ms_phase_t phase);
+
+void ms_log_commit(const char *name, uint8_t amode_match);
+
+unsigned ms_log_count();
+
+const ms_record_t* ms_log_get(unsigned idx);
+
+int ms_log_export_csv(const char *path);
+
+#endif /* MODE_STATS_H_ */
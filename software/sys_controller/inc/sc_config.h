@@ -0,0 +1,56 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef SC_CONFIG_H_
+#define SC_CONFIG_H_
+
+#include <stdint.h>
+#include "sc_config_regs.h"
+#include "video_modes.h"
+#include "avconfig.h"
+
+// Frame buffer DMA ports are 64-bit on clk108, transferring 2px per beat in
+// bursts of 4. Keep DMA utilization below FB_DMA_UTIL_PCT.
+#define FB_DMA_CLK_HZ 108000000UL
+#define FB_DMA_UTIL_PCT 80
+#define FB_LINE_W_MAX 2048
+#define FB_LINES_MAX 2048
+
+// Scanconverter configuration registers
+typedef struct {
+    hv_config_reg hv_in_config;
+    hv_config2_reg hv_in_config2;
+    hv_config3_reg hv_in_config3;
+    hv_config_reg hv_out_config;
+    hv_config2_reg hv_out_config2;
+    hv_config3_reg hv_out_config3;
+    xy_config_reg xy_out_config;
+    xy_config2_reg xy_out_config2;
+    misc_config_reg misc_config;
+    sl_config_reg sl_config;
+    sl_config2_reg sl_config2;
+    hscale_config_reg hscale_config;
+    vscale_config_reg vscale_config;
+} sc_config_t;
+
+int framebuf_supported(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *vm_conf);
+
+void get_sc_config(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *vm_conf, avconfig_t *avconfig, sc_config_t *cfg);
+
+#endif
@@ -0,0 +1,38 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef SI5351_CALC_H_
+#define SI5351_CALC_H_
+
+#include <stdint.h>
+#include "si5351.h"
+
+#define SI_VCO_MIN_HZ       600000000UL
+#define SI_VCO_MAX_HZ       900000000UL
+#define SI_PLL_MULT_MIN     15
+#define SI_PLL_MULT_MAX     90
+#define SI_FRAC_DENOM_MAX   1048575UL
+#define SI_MS_DIV_MAX       2048
+#define SI_RDIV_LOG2_MAX    7
+
+#define SI_CALC_CACHE_SIZE  4
+
+int si5351_calc_frac_mult(uint32_t fin_hz, uint32_t num, uint32_t den, si5351_ms_config_t *ms_conf, int32_t *err_ppb);
+
+#endif /* SI5351_CALC_H_ */
@@ -21,13 +21,20 @@
 #define SYSCONFIG_H_
 
 #include "system.h"
+#include "pulpino.h"
 
 #define INC_ADV7513
 #define INC_ADV761X
 #define INC_PCM186X
 
 //#define I2C_DEBUG
+// I2CA: frontend, clock and audio ADC chips, I2CB: HDMI RX/TX and character display.
+// All chips sit on the single SCL/SDA pair of the board (see ossc_pro.qsf), so both
+// groups share one master and its transaction queue.
 #define I2CA_BASE I2C_OPENCORES_0_BASE
+#define I2CB_BASE I2C_OPENCORES_0_BASE
+// I2CA core is built with register list sequencer
+#define I2CA_SEQUENCER
 
 #ifndef DEBUG
 #define OS_PRINTF(...)
@@ -43,6 +50,22 @@
 #define printf dd_printf
 #endif
 
+// must match MAINLOOP_TICK_CYCLES in ossc_pro.v
 #define MAINLOOP_INTERVAL_US   10000
 
+// PULPino event unit. IRQ lines reach the core only if enabled in its mask,
+// and pending bits stay latched until cleared. Register offsets as in PULPino event.h.
+#define REG_IRQ_ENABLE         0x00
+#define REG_IRQ_PENDING        0x04
+#define REG_IRQ_CLEAR_PENDING  0x0C
+#define EU_IRQ_ENABLE          REG(EVENT_UNIT_BASE_ADDR + REG_IRQ_ENABLE)
+#define EU_IRQ_PENDING         REG(EVENT_UNIT_BASE_ADDR + REG_IRQ_PENDING)
+#define EU_IRQ_CLEAR_PENDING   REG(EVENT_UNIT_BASE_ADDR + REG_IRQ_CLEAR_PENDING)
+
+#define cpu_irq_disable()      __asm__ volatile ("csrci mstatus, 0x8")
+#define cpu_wfi()              __asm__ volatile ("wfi")
+
+// IRQ lines which wake main loop from WFI: controls, sys_status and I2C master
+#define WAKE_IRQ_MASK          ((1<<PIO_1_IRQ)|(1<<PIO_2_IRQ)|(1<<I2C_OPENCORES_0_IRQ))
+
 #endif /* SYSCONFIG_H_ */
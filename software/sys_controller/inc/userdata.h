@@ -0,0 +1,67 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef USERDATA_H_
+#define USERDATA_H_
+
+#include <stdint.h>
+#include "avconfig.h"
+#include "controls.h"
+
+#define USERDATA_VER        2
+
+#define MAX_PROFILE         9
+#define MAX_USERDATA_ENTRY  15
+#define INIT_CONFIG_SLOT    MAX_USERDATA_ENTRY
+
+#define PROFILE_NAME_LEN    13
+
+typedef enum {
+    UDE_INITCFG  = 0,
+    UDE_PROFILE,
+} ude_type;
+
+typedef struct {
+    uint8_t profile_sel;
+    uint8_t auto_input;
+    uint8_t auto_av1_ypbpr;
+    uint8_t auto_av2_ypbpr;
+    uint8_t auto_av3_ypbpr;
+    uint16_t keymap[REMOTE_MAX_KEYS];
+} __attribute__((packed)) ude_initcfg;
+
+typedef struct {
+    char name[PROFILE_NAME_LEN+1];
+    avconfig_t avc;
+} __attribute__((packed)) ude_profile;
+
+int init_userdata();
+
+int read_userdata(int entry, int dry_run);
+
+int read_userdata_profile(int entry, avconfig_t *avc);
+
+int write_userdata(int entry);
+
+void write_initcfg_deferred();
+
+void userdata_service();
+
+#endif /* USERDATA_H_ */
@@ -43,6 +43,8 @@
 
 #define DEFAULT_SAMPLER_PHASE 0
 
+#define LINEBUF_LINES_DEFAULT 40
+
 typedef enum {
     FORMAT_RGBS = 0,
     FORMAT_RGBHV = 1,
@@ -272,12 +274,20 @@ typedef struct {
 
 void set_default_vm_table();
 
+void set_linebuf_lines(uint8_t lines);
+
+void invalidate_vm_index();
+
 uint32_t estimate_dotclk(mode_data_t *vm_in, uint32_t h_hz);
 
 int get_adaptive_lm_mode(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *vm_conf);
 
 int get_pure_lm_mode(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *vm_conf);
 
+int get_lm_mode(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *vm_conf, uint8_t *amode_match);
+
+int get_vscale_config(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *vm_conf, uint32_t *step);
+
 int get_standard_mode(unsigned stdmode_idx_arr_idx, vm_mult_config_t *vm_conf, mode_data_t *vm_in, mode_data_t *vm_out);
 
 #endif /* VIDEO_MODES_H_ */
@@ -0,0 +1,138 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <stdio.h>
+#include "system.h"
+#include "sys/alt_timestamp.h"
+#include "auto_input.h"
+
+#define MS_TO_TS(ms) ((alt_timestamp_type)(ms)*(TIMER_0_FREQ/1000))
+
+typedef enum {
+    CONN_NONE = 0,
+    CONN_AV1,
+    CONN_AV2,
+    CONN_AV3,
+    CONN_AV4
+} av_connector_t;
+
+uint8_t auto_input, auto_av1_ypbpr, auto_av2_ypbpr, auto_av3_ypbpr;
+
+// One probe per distinct sync path. RGsB and YPbPr share the same path, so
+// only the variant selected in settings is probed.
+static const avinput_t ai_probes[] = { AV1_RGBS, AV1_RGsB, AV1_RGBHV, AV1_RGBCS, AV2_YPbPr, AV3_RGBS, AV3_RGsB, AV3_RGBHV, AV3_RGBCS, AV4 };
+
+// sequence number of most recent sync detection on each input
+static uint32_t ai_activity[AV_LAST];
+static uint32_t ai_seq;
+
+static avinput_t ai_order[sizeof(ai_probes)/sizeof(avinput_t)];
+static unsigned ai_num, ai_pos;
+static alt_timestamp_type ai_probe_ts;
+
+static av_connector_t get_connector(avinput_t input) {
+    if ((input >= AV1_RGBS) && (input <= AV1_RGBCS))
+        return CONN_AV1;
+    else if ((input >= AV2_YPbPr) && (input <= AV2_RGsB))
+        return CONN_AV2;
+    else if ((input >= AV3_RGBHV) && (input <= AV3_YPbPr))
+        return CONN_AV3;
+    else if (input == AV4)
+        return CONN_AV4;
+
+    return CONN_NONE;
+}
+
+static avinput_t get_probe_input(avinput_t probe) {
+    switch (probe) {
+    case AV1_RGsB:
+        return auto_av1_ypbpr ? AV1_YPbPr : AV1_RGsB;
+    case AV2_YPbPr:
+        return auto_av2_ypbpr ? AV2_YPbPr : AV2_RGsB;
+    case AV3_RGsB:
+        return auto_av3_ypbpr ? AV3_YPbPr : AV3_RGsB;
+    default:
+        return probe;
+    }
+}
+
+// Build probe order for a scan round, most recently active inputs first
+static void build_order(avinput_t cur_input) {
+    avinput_t input;
+    unsigned i, j;
+
+    ai_num = 0;
+    ai_pos = 0;
+
+    for (i=0; i<sizeof(ai_probes)/sizeof(avinput_t); i++) {
+        input = get_probe_input(ai_probes[i]);
+
+        if ((input == cur_input) ||
+            ((auto_input == AUTO_CURRENT_INPUT) && (get_connector(input) != get_connector(cur_input))))
+            continue;
+
+        for (j=ai_num; (j > 0) && (ai_activity[ai_order[j-1]] < ai_activity[input]); j--)
+            ai_order[j] = ai_order[j-1];
+        ai_order[j] = input;
+        ai_num++;
+    }
+}
+
+// Restart idle timer, e.g. after manual input change
+void auto_input_reset() {
+    ai_num = 0;
+    ai_pos = 0;
+    ai_probe_ts = alt_timestamp();
+}
+
+// Called once per mainloop iteration. Returns input to switch to, which is
+// cur_input unless current input has been idle and its dwell time expired.
+avinput_t auto_input_select(avinput_t cur_input, uint8_t sync_active) {
+    alt_timestamp_type ts = alt_timestamp();
+    uint32_t dwell_ms;
+
+    if ((auto_input == AUTO_OFF) || (cur_input == AV_TESTPAT))
+        return cur_input;
+
+    if (sync_active) {
+        if ((ai_seq == 0) || (ai_activity[cur_input] != ai_seq))
+            ai_activity[cur_input] = ++ai_seq;
+        auto_input_reset();
+        return cur_input;
+    }
+
+    if (ai_num == 0)
+        dwell_ms = AUTO_INPUT_IDLE_MS;
+    else
+        dwell_ms = (cur_input == AV4) ? AUTO_INPUT_DWELL_HDMI_MS : AUTO_INPUT_DWELL_ISL_MS;
+
+    if (ts - ai_probe_ts < MS_TO_TS(dwell_ms))
+        return cur_input;
+
+    ai_probe_ts = ts;
+
+    if (ai_pos >= ai_num) {
+        build_order(cur_input);
+        if (ai_num == 0)
+            return cur_input;
+    }
+
+    return ai_order[ai_pos++];
+}
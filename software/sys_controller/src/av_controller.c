@@ -27,6 +27,7 @@
 #include "utils.h"
 #include "sys/alt_timestamp.h"
 #include "i2c_opencores.h"
+#include "i2c_shadow.h"
 #include "av_controller.h"
 #include "avconfig.h"
 #include "isl51002.h"
@@ -41,7 +42,13 @@
 #include "adv7513.h"
 #include "adv761x.h"
 #include "sc_config_regs.h"
+#include "sc_config.h"
 #include "video_modes.h"
+#include "si5351_calc.h"
+#include "mode_stats.h"
+#include "userdata.h"
+#include "auto_input.h"
+#include "events.h"
 
 #define FW_VER_MAJOR 0
 #define FW_VER_MINOR 43
@@ -70,6 +77,52 @@
 #define BLKSIZE 512
 #define BLKCNT 2
 
+// Clock of FPGA sync measurement block
+#define SYNC_MEAS_CLK_HZ 27000000UL
+
+// Gate time of FPGA pixel clock counters is 1/PCLK_MEAS_GATE_HZ
+#define PCLK_MEAS_GATE_HZ 100
+// Time for PLLs to settle and counters to complete two gates after setup
+#define PCLK_CHECK_DELAY_MS 30
+#define LT_TIMEOUT_MS 10000
+#define PCLK_OUT_TOL_PERMILLE 5
+
+// Number of profiles kept in RAM for hotkey switching
+#define HOTPROF_NUM 4
+
+typedef enum {
+    HP_EMPTY        = 0,
+    HP_LOADED,
+    HP_RESOLVED,
+    HP_NOMODE,
+} hotprof_state_t;
+
+// Output setup resolved for an input mode
+typedef struct {
+    uint8_t amode_match;
+    uint32_t pll_h_total;
+    uint32_t pclk_i_hz;
+    uint32_t dotclk_hz;
+    mode_data_t vm_in;
+    mode_data_t vm_out;
+    vm_mult_config_t vm_conf;
+    sc_config_t sc_cfg;
+} mode_setup_t;
+
+// Profile and its output setup resolved against current input mode
+typedef struct {
+    hotprof_state_t state;
+    mode_setup_t ms;
+    avconfig_t avc;
+} hotprof_t;
+
+// Last mode locked on an input and table entry it was resolved from
+typedef struct {
+    uint8_t valid;
+    int mode;
+    mode_setup_t ms;
+} input_mode_t;
+
 unsigned char pro_edid_bin[] = {
   0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x36, 0x51, 0x5c, 0x05,
   0x15, 0xcd, 0x5b, 0x07, 0x0a, 0x1d, 0x01, 0x04, 0xa2, 0x3c, 0x22, 0x78,
@@ -95,19 +148,19 @@ unsigned char pro_edid_bin[] = {
   0x1e, 0x20, 0x6e, 0x0c
 };
 
-isl51002_dev isl_dev = {.i2cm_base = I2C_OPENCORES_0_BASE,
+isl51002_dev isl_dev = {.i2cm_base = I2CA_BASE,
                         .i2c_addr = ISL51002_BASE,
                         .xclk_out_en = 0,
                         .xtal_freq = 27000000LU};
 
-ths7353_dev ths_dev = {.i2cm_base = I2C_OPENCORES_0_BASE,
+ths7353_dev ths_dev = {.i2cm_base = I2CA_BASE,
                         .i2c_addr = THS7353_BASE};
 
-si5351_dev si_dev = {.i2cm_base = I2C_OPENCORES_0_BASE,
+si5351_dev si_dev = {.i2cm_base = I2CA_BASE,
                      .i2c_addr = SI5351_BASE,
                      .xtal_freq = 27000000LU};
 
-adv761x_dev advrx_dev = {.i2cm_base = I2C_OPENCORES_0_BASE,
+adv761x_dev advrx_dev = {.i2cm_base = I2CB_BASE,
                          .io_base = ADV7610_IO_BASE,
                          .cec_base = ADV7610_CEC_BASE,
                          .infoframe_base = ADV7610_INFOFRAME_BASE,
@@ -120,21 +173,23 @@ adv761x_dev advrx_dev = {.i2cm_base = I2C_OPENCORES_0_BASE,
                          .edid = pro_edid_bin,
                          .edid_len = sizeof(pro_edid_bin)};
 
-adv7513_dev advtx_dev = {.i2cm_base = I2C_OPENCORES_0_BASE,
+adv7513_dev advtx_dev = {.i2cm_base = I2CB_BASE,
                          .main_base = ADV7513_MAIN_BASE,
                          .edid_base = ADV7513_EDID_BASE,
                          .pktmem_base = ADV7513_PKTMEM_BASE,
                          .cec_base = ADV7513_CEC_BASE};
 
-pcm186x_dev pcm_dev = {.i2cm_base = I2C_OPENCORES_0_BASE,
+pcm186x_dev pcm_dev = {.i2cm_base = I2CA_BASE,
                        .i2c_addr = PCM1863_BASE};
 
-us2066_dev chardisp_dev = {.i2cm_base = I2C_OPENCORES_0_BASE,
+us2066_dev chardisp_dev = {.i2cm_base = I2CB_BASE,
                            .i2c_addr = US2066_BASE};
 
 volatile sc_regs *sc = (volatile sc_regs*)SC_CONFIG_0_BASE;
 volatile osd_regs *osd = (volatile osd_regs*)OSD_GENERATOR_0_BASE;
 
+I2C_queue i2c_qa;
+
 struct mmc *mmc_dev;
 struct mmc * ocsdc_mmc_init(int base_addr, int clk_freq);
 
@@ -143,6 +198,48 @@ FRESULT res;
 
 uint16_t sys_ctrl;
 uint32_t sys_status;
+uint32_t i2c_bytecnt_prev, i2c_bytes_tick;
+uint32_t i2c_savedcnt_prev, i2c_saved_tick;
+
+// Register shadows. Status, interrupt clear, reset and trigger registers are
+// excluded from caching, see init_i2c_shadows(). ISL51002 is not shadowed as its
+// per-tick traffic is sync status reads which a write shadow cannot save.
+i2c_shadow_t si_shadow, ths_shadow, pcm_shadow, advtx_shadow, advrx_io_shadow;
+
+// Si5351 PLLA (MSNA) and MS0 parameter registers
+#define SI_REG_MSNA         26
+#define SI_REG_MS0          42
+#define SI_REG_PLL_RESET    177
+#define SI_PLLA_RESET       0x20
+#define SI_REG_STATUS       0
+#define SI_STATUS_LOL_A     0x20
+
+// Queued Si5351 update used on adaptive mode switches while fractional setup
+// is active. Only PLLA/MS0 parameters change, so they are run as a sequencer
+// list (or posted on I2C queue if sequencer is not available) and completed
+// from event loop while rest of the switch proceeds.
+//
+// ISL51002, ADV761x and ADV7513 mode change writes are not queued. Their
+// register sequences live in ic_drivers, which only offers synchronous
+// calls, and queue callbacks must not issue synchronous transfers
+// themselves. As all devices share one I2C core, any
+// synchronous call first drains a pending Si5351 update, so mode switches
+// issue those driver calls before the Si5351 update is started. The update
+// then overlaps with scanconverter/OSD register writes and the return to
+// event loop.
+typedef struct {
+    I2C_xfer xfer[3];
+    uint8_t msna[1+8];
+    uint8_t ms0[1+8];
+    uint8_t pll_rst[2];
+    uint8_t busy;
+} si_qupdate_t;
+
+si_qupdate_t si_qupd;
+si5351_ms_config_t si_frac_conf;
+si_clk_src_t si_frac_src;
+uint8_t si_frac_active;
+uint8_t si_seq_failed;
 uint8_t sys_powered_on;
 
 uint8_t sd_det, sd_det_prev;
@@ -152,12 +249,35 @@ int enable_isl, enable_hdmirx, enable_tp;
 extern uint8_t osd_enable;
 
 avinput_t avinput, target_avinput;
+uint8_t profile_sel, profile_sel_menu;
+uint8_t lt_sel;
+char target_profile_name[PROFILE_NAME_LEN+1];
+int target_profile = -1;
+uint8_t prof_hotkey_armed;
+
+hotprof_t hotprof[HOTPROF_NUM];
+// Measured input mode which hot profiles are resolved against
+mode_data_t hotprof_src;
+uint32_t hotprof_h_hz;
+uint8_t hotprof_src_valid;
+
+input_mode_t input_mode[AV_LAST];
+uint8_t input_mode_prearmed;
+uint8_t sync_meas_pending;
+
+uint8_t pclk_check_pending, pclk_check_isl_div;
+uint32_t pclk_check_o_hz;
+alt_timestamp_type pclk_check_ts;
+uint8_t lt_pending;
+alt_timestamp_type lt_ts;
 unsigned tp_stdmode_idx, target_tp_stdmode_idx;
+int tp_stdmode_step = 1;
 
 mode_data_t vmode_in, vmode_out;
 
 char row1[US2066_ROW_LEN+1], row2[US2066_ROW_LEN+1];
 extern char menu_row1[US2066_ROW_LEN+1], menu_row2[US2066_ROW_LEN+1];
+extern const unsigned num_stdmodes;
 
 static const char *avinput_str[] = { "Test pattern", "AV1_RGBS", "AV1_RGsB", "AV1_YPbPr", "AV1_RGBHV", "AV1_RGBCS", "AV2_YPbPr", "AV2_RGsB", "AV3_RGBHV", "AV3_RGBCS", "AV3_RGBS", "AV3_RGsB", "AV3_YPbPr", "AV4", "Last used" };
 
@@ -195,71 +315,461 @@ void ui_disp_status(uint8_t refresh_osd_timer) {
     }
 }
 
+// Load Catmull-Rom coefficients (2.8 fixed point) into scaler phase banks
+void init_hscale_coefs()
+{
+    hscale_coef_reg coef;
+    int k, t, c[4];
+
+    for (k=0; k<16; k++) {
+        c[0] = (-k*k*k + 32*k*k - 256*k)/32;
+        c[2] = (-3*k*k*k + 64*k*k + 256*k)/32;
+        c[3] = (k*k*k - 16*k*k)/32;
+        c[1] = 256 - c[0] - c[2] - c[3];
+
+        for (t=0; t<4; t++) {
+            coef.data = 0;
+            coef.phase = k;
+            coef.tap = t;
+            coef.coef = c[t];
+            sc->hscale_coef.data = coef.data;
+        }
+    }
+}
+
+void write_sc_config(sc_config_t *cfg)
+{
+    sc->hv_in_config = cfg->hv_in_config;
+    sc->hv_in_config2 = cfg->hv_in_config2;
+    sc->hv_in_config3 = cfg->hv_in_config3;
+    sc->hv_out_config = cfg->hv_out_config;
+    sc->hv_out_config2 = cfg->hv_out_config2;
+    sc->hv_out_config3 = cfg->hv_out_config3;
+    sc->xy_out_config = cfg->xy_out_config;
+    sc->xy_out_config2 = cfg->xy_out_config2;
+    sc->misc_config = cfg->misc_config;
+    sc->sl_config = cfg->sl_config;
+    sc->sl_config2 = cfg->sl_config2;
+    sc->hscale_config = cfg->hscale_config;
+    sc->vscale_config = cfg->vscale_config;
+}
+
 void update_sc_config(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *vm_conf, avconfig_t *avconfig)
 {
-    hv_config_reg hv_in_config = {.data=0x00000000};
-    hv_config2_reg hv_in_config2 = {.data=0x00000000};
-    hv_config3_reg hv_in_config3 = {.data=0x00000000};
-    hv_config_reg hv_out_config = {.data=0x00000000};
-    hv_config2_reg hv_out_config2 = {.data=0x00000000};
-    hv_config3_reg hv_out_config3 = {.data=0x00000000};
-    xy_config_reg xy_out_config = {.data=0x00000000};
-    xy_config2_reg xy_out_config2 = {.data=0x00000000};
-    misc_config_reg misc_config = {.data=0x00000000};
-    sl_config_reg sl_config = {.data=0x00000000};
-    sl_config2_reg sl_config2 = {.data=0x00000000};
-
-    // Set input params
-    hv_in_config.h_total = vm_in->timings.h_total;
-    hv_in_config.h_active = vm_in->timings.h_active;
-    hv_in_config.h_synclen = vm_in->timings.h_synclen;
-    hv_in_config2.h_backporch = vm_in->timings.h_backporch;
-    hv_in_config2.v_active = vm_in->timings.v_active;
-    hv_in_config3.v_backporch = vm_in->timings.v_backporch;
-    hv_in_config3.v_synclen = vm_in->timings.v_synclen;
-    hv_in_config2.interlaced = vm_in->timings.interlaced;
-    hv_in_config3.h_skip = vm_conf->h_skip;
-    hv_in_config3.h_sample_sel = vm_conf->h_skip / 2; // TODO: fix
-
-    // Set output params
-    hv_out_config.h_total = vm_out->timings.h_total;
-    hv_out_config.h_active = vm_out->timings.h_active;
-    hv_out_config.h_synclen = vm_out->timings.h_synclen;
-    hv_out_config2.h_backporch = vm_out->timings.h_backporch;
-    hv_out_config2.v_total = vm_out->timings.v_total;
-    hv_out_config2.v_active = vm_out->timings.v_active;
-    hv_out_config3.v_backporch = vm_out->timings.v_backporch;
-    hv_out_config3.v_synclen = vm_out->timings.v_synclen;
-    hv_out_config2.interlaced = vm_out->timings.interlaced;
-    hv_out_config3.v_startline = vm_conf->framesync_line;
-
-    xy_out_config.x_size = vm_conf->x_size;
-    xy_out_config.y_size = vm_conf->y_size;
-    xy_out_config.y_offset = vm_conf->y_offset;
-    xy_out_config2.x_offset = vm_conf->x_offset;
-    xy_out_config2.x_start_lb = vm_conf->x_start_lb;
-    xy_out_config2.y_start_lb = vm_conf->y_start_lb;
-    xy_out_config2.x_rpt = vm_conf->x_rpt;
-    xy_out_config2.y_rpt = vm_conf->y_rpt;
-
-    misc_config.mask_br = avconfig->mask_br;
-    misc_config.mask_color = avconfig->mask_color;
-    misc_config.reverse_lpf = avconfig->reverse_lpf;
-    misc_config.lm_deint_mode = avconfig->lm_deint_mode;
-    misc_config.nir_even_offset = avconfig->nir_even_offset;
-    misc_config.ypbpr_cs = avconfig->ypbpr_cs;
-
-    sc->hv_in_config = hv_in_config;
-    sc->hv_in_config2 = hv_in_config2;
-    sc->hv_in_config3 = hv_in_config3;
-    sc->hv_out_config = hv_out_config;
-    sc->hv_out_config2 = hv_out_config2;
-    sc->hv_out_config3 = hv_out_config3;
-    sc->xy_out_config = xy_out_config;
-    sc->xy_out_config2 = xy_out_config2;
-    sc->misc_config = misc_config;
-    sc->sl_config = sl_config;
-    sc->sl_config2 = sl_config2;
+    sc_config_t cfg;
+
+    get_sc_config(vm_in, vm_out, vm_conf, avconfig, &cfg);
+    write_sc_config(&cfg);
+}
+
+void hotprof_load(int idx) {
+    if (idx >= HOTPROF_NUM)
+        return;
+
+    hotprof[idx].state = (read_userdata_profile(idx, &hotprof[idx].avc) == 0) ? HP_LOADED : HP_EMPTY;
+}
+
+// Set input mode (before mode lookup) which hot profiles are resolved against
+void hotprof_set_source(mode_data_t *vm_in, uint32_t h_hz) {
+    int i;
+
+    memcpy(&hotprof_src, vm_in, sizeof(mode_data_t));
+    hotprof_h_hz = h_hz;
+    hotprof_src_valid = 1;
+
+    for (i=0; i<HOTPROF_NUM; i++) {
+        if (hotprof[i].state != HP_EMPTY)
+            hotprof[i].state = HP_LOADED;
+    }
+}
+
+int resolve_mode_setup(mode_data_t *vm_key, uint32_t h_hz, avconfig_t *avconfig, mode_setup_t *ms) {
+    memcpy(&ms->vm_in, vm_key, sizeof(mode_data_t));
+
+    if (get_lm_mode_avconfig(avconfig, &ms->vm_in, &ms->vm_out, &ms->vm_conf, &ms->amode_match) < 0)
+        return -1;
+
+    if (vm_key->timings.h_total) {
+        // HDMI input, h_total is measured
+        ms->pll_h_total = 0;
+        ms->pclk_i_hz = h_hz * vm_key->timings.h_total;
+    } else {
+        ms->pll_h_total = (ms->vm_conf.h_skip+1) * ms->vm_in.timings.h_total + (((ms->vm_conf.h_skip+1) * ms->vm_in.timings.h_total_adj * 5 + 50) / 100);
+        ms->pclk_i_hz = h_hz * ms->pll_h_total;
+        ms->dotclk_hz = estimate_dotclk(&ms->vm_in, h_hz);
+    }
+
+    get_sc_config(&ms->vm_in, &ms->vm_out, &ms->vm_conf, avconfig, &ms->sc_cfg);
+
+    return 0;
+}
+
+static void si_pack_params(uint8_t *buf, uint8_t regaddr, uint32_t p1, uint32_t p2, uint32_t p3, uint8_t div_bits) {
+    buf[0] = regaddr;
+    buf[1] = (p3 >> 8) & 0xff;
+    buf[2] = p3 & 0xff;
+    buf[3] = div_bits | ((p1 >> 16) & 0x03);
+    buf[4] = (p1 >> 8) & 0xff;
+    buf[5] = p1 & 0xff;
+    buf[6] = ((p3 >> 12) & 0xf0) | ((p2 >> 16) & 0x0f);
+    buf[7] = (p2 >> 8) & 0xff;
+    buf[8] = p2 & 0xff;
+}
+
+static void si_qupdate_done(I2C_xfer *xfer) {
+    if (xfer->status == I2C_OK) {
+        i2c_shadow_update(&si_shadow, xfer->wdata[0], xfer->wdata+1, xfer->wlen-1);
+    } else {
+        // contents unknown, next update goes through driver
+        i2c_shadow_invalidate(&si_shadow);
+        si_frac_active = 0;
+    }
+
+    if (xfer == &si_qupd.xfer[2])
+        si_qupd.busy = 0;
+}
+
+// Check whether Si5351 already runs fractional setup from the same source
+// so that only PLLA/MS0 parameters need to be updated
+static int si_frac_params_only(si5351_ms_config_t *ms_conf, si_clk_src_t src) {
+    return (si_frac_active && (si_frac_src == src) &&
+            ((ms_conf->ms_p1 == 0) == (si_frac_conf.ms_p1 == 0)) &&
+            ((ms_conf->ms_p2 == 0) == (si_frac_conf.ms_p2 == 0)));
+}
+
+static void si_pack_frac_params(si5351_ms_config_t *ms_conf) {
+    // previous update still on bus
+    if (si_qupd.busy)
+        I2C_queue_flush(&i2c_qa);
+
+    si_pack_params(si_qupd.msna, SI_REG_MSNA, ms_conf->pll_p1, ms_conf->pll_p2, ms_conf->pll_p3, 0);
+    si_pack_params(si_qupd.ms0, SI_REG_MS0, ms_conf->ms_p1, ms_conf->ms_p2, ms_conf->ms_p3,
+                   (ms_conf->outdiv << 4) | ((ms_conf->ms_p1 == 0) ? 0x0c : 0));
+    si_qupd.pll_rst[0] = SI_REG_PLL_RESET;
+    si_qupd.pll_rst[1] = SI_PLLA_RESET;
+}
+
+static void si_post_frac_params(si5351_ms_config_t *ms_conf) {
+    int i;
+
+    si_pack_frac_params(ms_conf);
+
+    si_qupd.xfer[0].wdata = si_qupd.msna;
+    si_qupd.xfer[0].wlen = sizeof(si_qupd.msna);
+    si_qupd.xfer[1].wdata = si_qupd.ms0;
+    si_qupd.xfer[1].wlen = sizeof(si_qupd.ms0);
+    si_qupd.xfer[2].wdata = si_qupd.pll_rst;
+    si_qupd.xfer[2].wlen = sizeof(si_qupd.pll_rst);
+
+    si_qupd.busy = 1;
+    for (i=0; i<3; i++) {
+        si_qupd.xfer[i].addr = si_dev.i2c_addr;
+        si_qupd.xfer[i].rlen = 0;
+        si_qupd.xfer[i].callback = si_qupdate_done;
+        I2C_queue_post(&i2c_qa, &si_qupd.xfer[i]);
+    }
+}
+
+#ifdef I2CA_SEQUENCER
+#define SI_SEQ_PUT(...) do { const uint8_t e[4] = {__VA_ARGS__}; memcpy(list+len, e, 4); len += 4; } while (0)
+
+static void si_seq_done(int status, void *ctx) {
+    if (status == 0) {
+        i2c_shadow_update(&si_shadow, SI_REG_MSNA, si_qupd.msna+1, 8);
+        i2c_shadow_update(&si_shadow, SI_REG_MS0, si_qupd.ms0+1, 8);
+    } else {
+        // contents unknown, redo setup through driver in si_seq_service()
+        i2c_shadow_invalidate(&si_shadow);
+        si_seq_failed = 1;
+    }
+
+    si_qupd.busy = 0;
+}
+
+// Update PLLA/MS0 parameters with I2C sequencer. List is started with done IRQ
+// enabled and completes in background including PLLA relock poll. Completion
+// is handled from wait_events() and other transfers to the same core wait
+// until list has finished.
+static int si_seq_frac_params(si5351_ms_config_t *ms_conf) {
+    uint8_t list[4*(2*8+3)];
+    int i, len=0;
+
+    si_pack_frac_params(ms_conf);
+
+    for (i=0; i<8; i++)
+        SI_SEQ_PUT(I2C_SEQ_WRITE(si_dev.i2c_addr, SI_REG_MSNA+i, si_qupd.msna[1+i]));
+    for (i=0; i<8; i++)
+        SI_SEQ_PUT(I2C_SEQ_WRITE(si_dev.i2c_addr, SI_REG_MS0+i, si_qupd.ms0[1+i]));
+    SI_SEQ_PUT(I2C_SEQ_WRITE(si_dev.i2c_addr, SI_REG_PLL_RESET, SI_PLLA_RESET));
+    SI_SEQ_PUT(I2C_SEQ_POLL_CLR(si_dev.i2c_addr, SI_REG_STATUS, SI_STATUS_LOL_A));
+    SI_SEQ_PUT(I2C_SEQ_END);
+
+    if (I2C_seq_load(si_dev.i2cm_base, list, len) != 0)
+        return -1;
+
+    si_seq_failed = 0;
+    si_qupd.busy = 1;
+    I2C_queue_seq_start(&i2c_qa, si_seq_done, NULL);
+
+    return 0;
+}
+#endif
+
+// Called from wait_events() after I2C queue service. Falls back to full driver
+// setup if last sequencer update failed and fractional setup is still wanted.
+void si_seq_service() {
+    if (!si_seq_failed)
+        return;
+
+    si_seq_failed = 0;
+    if (si_frac_active) {
+        printf("Si5351 sequencer error, full setup\n");
+        si5351_set_frac_mult(&si_dev, SI_PLLA, SI_CLK0, si_frac_src, &si_frac_conf);
+    }
+}
+
+// Setup Si5351 for adaptive linemult. Full setup through driver is needed only
+// when switching from another clock config or MS0 integer/divby4 mode changes.
+void set_pclk_frac(si5351_ms_config_t *ms_conf) {
+    if (si_frac_params_only(ms_conf, SI_CLKIN)) {
+#ifdef I2CA_SEQUENCER
+        if (si_seq_frac_params(ms_conf) != 0)
+#endif
+            si_post_frac_params(ms_conf);
+    } else {
+        si5351_set_frac_mult(&si_dev, SI_PLLA, SI_CLK0, SI_CLKIN, ms_conf);
+    }
+
+    memcpy(&si_frac_conf, ms_conf, sizeof(si5351_ms_config_t));
+    si_frac_src = SI_CLKIN;
+    si_frac_active = 1;
+}
+
+// Setup Si5351 for fractional test pattern mode from crystal
+void set_tp_pclk_frac(si5351_ms_config_t *ms_conf) {
+#ifdef I2CA_SEQUENCER
+    if (!si_frac_params_only(ms_conf, SI_XTAL) || (si_seq_frac_params(ms_conf) != 0))
+#endif
+        si5351_set_frac_mult(&si_dev, SI_PLLA, SI_CLK0, SI_XTAL, ms_conf);
+
+    memcpy(&si_frac_conf, ms_conf, sizeof(si5351_ms_config_t));
+    si_frac_src = SI_XTAL;
+    si_frac_active = 1;
+}
+
+// Setup Si5351 for pure linemult
+void set_pclk_int(uint32_t pclk_i_hz, uint8_t mult) {
+    si5351_set_integer_mult(&si_dev, SI_PLLA, SI_CLK0, SI_CLKIN, pclk_i_hz, mult, 0);
+    si_frac_active = 0;
+}
+
+// Program frontend PLL according to resolved setup, ISL51002 must be powered up.
+// Kept as driver calls: register sequence is owned by isl51002 driver and may
+// depend on readback, while sequencer lists are fixed write/delay/poll entries.
+void apply_fe_setup(mode_setup_t *ms, uint32_t *pll_h_total_prev) {
+    if (ms->pll_h_total) {
+        isl_source_setup(&isl_dev, ms->pll_h_total);
+        isl_set_afe_bw(&isl_dev, ms->dotclk_hz);
+        if (ms->pll_h_total != *pll_h_total_prev)
+            isl_set_sampler_phase(&isl_dev, ms->vm_in.sampler_phase);
+        *pll_h_total_prev = ms->pll_h_total;
+    }
+}
+
+// Program Si5351, scanconverter and TX according to resolved setup
+void apply_output_setup(mode_setup_t *ms) {
+    // TX goes first, see si_qupdate_t
+    adv7513_set_pixelrep_vic(&advtx_dev, ms->vm_out.tx_pixelrep, ms->vm_out.hdmitx_pixr_ifr, ms->vm_out.vic);
+    ms_log_phase(MSP_TX_SETUP);
+
+    if (ms->amode_match) {
+        set_pclk_frac(&ms->vm_out.si_ms_conf);
+        sys_ctrl |= SCTRL_ADAPT_LM;
+    } else {
+        set_pclk_int(ms->pclk_i_hz, ms->vm_out.si_pclk_mult);
+        sys_ctrl &= ~SCTRL_ADAPT_LM;
+    }
+    IOWR_ALTERA_AVALON_PIO_DATA(PIO_0_BASE, sys_ctrl);
+    ms_log_phase(MSP_SI5351);
+
+    update_osd_size(&ms->vm_out);
+    write_sc_config(&ms->sc_cfg);
+    ms_log_phase(MSP_SC_CONFIG);
+}
+
+void apply_mode_setup(mode_setup_t *ms, uint32_t *pll_h_total_prev) {
+    apply_fe_setup(ms, pll_h_total_prev);
+    ms_log_phase(MSP_FE_SETUP);
+    apply_output_setup(ms);
+}
+
+// Check whether FPGA has reported new sync timings since last call
+int sync_meas_changed() {
+    if (!sync_meas_pending && !(ev_sys_status & (1<<SSTAT_SYNC_MEAS_BIT)))
+        return 0;
+
+    // wait until a full field has been measured
+    sync_meas_pending = !sc->sync_meas.meas_valid;
+
+    return !sync_meas_pending;
+}
+
+// Fill sync stats from FPGA measurement registers
+void get_sync_meas(isl_sync_status *ss, isl_sync_meas *sm, uint32_t *h_hz, uint32_t *v_hz_x100) {
+    sync_meas_reg meas;
+    sync_meas2_reg meas2;
+
+    meas.data = sc->sync_meas.data;
+    meas2.data = sc->sync_meas2.data;
+
+    // fields of different length indicate interlaced source
+    ss->interlace_flag = (meas2.v_total_f0 != meas2.v_total_f1);
+    ss->v_total = ss->interlace_flag ? (meas2.v_total_f0 + meas2.v_total_f1) : meas2.v_total_f0;
+    ss->h_polarity = meas.h_polarity;
+    ss->v_polarity = meas.v_polarity;
+    sm->h_period_x16 = meas.h_period_x16;
+    sm->h_synclen_x16 = meas.h_synclen_x16;
+
+    if (sm->h_period_x16 > 0)
+        *h_hz = (16*SYNC_MEAS_CLK_HZ)/sm->h_period_x16;
+    else
+        *h_hz = 0;
+    if ((sm->h_period_x16 > 0) && (ss->v_total > 0))
+        *v_hz_x100 = (16*5*SYNC_MEAS_CLK_HZ)/((sm->h_period_x16 * ss->v_total) / ((100/5)*(1+ss->interlace_flag)));
+    else
+        *v_hz_x100 = 0;
+}
+
+uint32_t get_pclk_meas_hz(uint32_t reg_data) {
+    pclk_meas_reg meas;
+
+    meas.data = reg_data;
+
+    return meas.cnt * PCLK_MEAS_GATE_HZ;
+}
+
+// Schedule check of measured clocks after new mode setup. Output clock is
+// verified if pclk_o_hz is nonzero, and AFE bandwidth is refined from ISL
+// sampling clock if isl_div (samples per source pixel) is nonzero.
+void pclk_check_arm(uint32_t pclk_o_hz, uint8_t isl_div) {
+    pclk_check_o_hz = pclk_o_hz;
+    pclk_check_isl_div = isl_div;
+    pclk_check_ts = alt_timestamp();
+    pclk_check_pending = 1;
+}
+
+void pclk_check_service() {
+    uint32_t meas_hz, diff;
+
+    if (!pclk_check_pending || (alt_timestamp() - pclk_check_ts < PCLK_CHECK_DELAY_MS*(TIMER_0_FREQ/1000)))
+        return;
+
+    pclk_check_pending = 0;
+
+    if (pclk_check_o_hz) {
+        meas_hz = get_pclk_meas_hz(sc->pclk_out_meas.data);
+        diff = (meas_hz > pclk_check_o_hz) ? (meas_hz - pclk_check_o_hz) : (pclk_check_o_hz - meas_hz);
+        if (diff > (pclk_check_o_hz/1000)*PCLK_OUT_TOL_PERMILLE)
+            printf("Si5351 output at %luHz, target %luHz\n", meas_hz, pclk_check_o_hz);
+    }
+
+    if (pclk_check_isl_div && enable_isl && isl_dev.sync_active) {
+        meas_hz = get_pclk_meas_hz(sc->pclk_isl_meas.data);
+        isl_set_afe_bw(&isl_dev, meas_hz/pclk_check_isl_div);
+    }
+}
+
+void invalidate_input_modes() {
+    int i;
+
+    for (i=0; i<AV_LAST; i++)
+        input_mode[i].valid = 0;
+}
+
+// Resolve at most one hot profile per call
+void hotprof_service() {
+    int i;
+
+    if (!hotprof_src_valid)
+        return;
+
+    for (i=0; i<HOTPROF_NUM; i++) {
+        if (hotprof[i].state == HP_LOADED) {
+            if (resolve_mode_setup(&hotprof_src, hotprof_h_hz, &hotprof[i].avc, &hotprof[i].ms) == 0)
+                hotprof[i].state = HP_RESOLVED;
+            else
+                hotprof[i].state = HP_NOMODE;
+            break;
+        }
+    }
+}
+
+// Apply precomputed output setup of a hot profile and adopt its config
+// as target without going through mode lookup. Between adaptive profiles of
+// the same clock source only PLLA/MS0 parameters change and Si5351 update runs
+// in background (see set_pclk_frac()), other cases go through blocking driver
+// setup. Apply time is logged as a mode switch and checked against output frame.
+int hotprof_apply(int idx, mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *vm_conf, uint8_t *amode_match, uint32_t *pll_h_total_prev) {
+    mode_setup_t *ms;
+    uint32_t frame_us;
+
+    if ((idx >= HOTPROF_NUM) || !hotprof_src_valid || (hotprof[idx].state != HP_RESOLVED))
+        return -1;
+
+    ms = &hotprof[idx].ms;
+    ms_log_start();
+    apply_mode_setup(ms, pll_h_total_prev);
+    ms_log_commit(ms->vm_in.name, ms->amode_match);
+
+    frame_us = 1000000/(ms->vm_out.timings.v_hz_max ? ms->vm_out.timings.v_hz_max : 60);
+    if (ms_log_get(0)->total_us > frame_us)
+        printf("Hot profile apply exceeded output frame (%luus)\n", frame_us);
+
+    memcpy(vm_in, &ms->vm_in, sizeof(mode_data_t));
+    memcpy(vm_out, &ms->vm_out, sizeof(mode_data_t));
+    memcpy(vm_conf, &ms->vm_conf, sizeof(vm_mult_config_t));
+    *amode_match = ms->amode_match;
+
+    memcpy(get_target_avconfig(), &hotprof[idx].avc, sizeof(avconfig_t));
+    set_avconfig_dirty(AVC_DIRTY_ALL & ~AVC_DIRTY_MODE);
+    invalidate_vm_index();
+    invalidate_input_modes();
+
+    return 0;
+}
+
+void init_i2c_shadows(int post_init) {
+    if (!post_init) {
+        // Si5351: device status, interrupt status and PLL reset
+        i2c_shadow_init(&si_shadow, si_dev.i2cm_base, si_dev.i2c_addr);
+        i2c_shadow_set_nocache(&si_shadow, 0);
+        i2c_shadow_set_nocache(&si_shadow, 1);
+        i2c_shadow_set_nocache(&si_shadow, 177);
+        i2c_shadow_register(&si_shadow);
+        i2c_shadow_init(&ths_shadow, ths_dev.i2cm_base, ths_dev.i2c_addr);
+        i2c_shadow_register(&ths_shadow);
+        return;
+    }
+
+    // PCM186x: page select (0xff there is software reset), power and status block
+    i2c_shadow_init(&pcm_shadow, pcm_dev.i2cm_base, pcm_dev.i2c_addr);
+    i2c_shadow_set_pagereg(&pcm_shadow, 0x00);
+    i2c_shadow_set_nocache_range(&pcm_shadow, 0x70, 0x7f);
+    i2c_shadow_register(&pcm_shadow);
+
+    // ADV7513 main map: interrupt status (write 1 to clear) and EDID read
+    // triggers. Contents are lost on HPD loss, see mainloop.
+    i2c_shadow_init(&advtx_shadow, advtx_dev.i2cm_base, advtx_dev.main_base>>1);
+    i2c_shadow_set_nocache_range(&advtx_shadow, 0x96, 0x97);
+    i2c_shadow_set_nocache(&advtx_shadow, 0xc4);
+    i2c_shadow_set_nocache(&advtx_shadow, 0xc9);
+    i2c_shadow_register(&advtx_shadow);
+
+    // ADV761x IO map: interrupt raw/status/clear/mask groups and main reset
+    i2c_shadow_init(&advrx_io_shadow, advrx_dev.i2cm_base, advrx_dev.io_base>>1);
+    i2c_shadow_set_nocache_range(&advrx_io_shadow, 0x3f, 0x9f);
+    i2c_shadow_set_nocache(&advrx_io_shadow, 0xff);
+    i2c_shadow_register(&advrx_io_shadow);
 }
 
 int init_emif()
@@ -404,7 +914,7 @@ int check_sdcard() {
 
 int init_hw()
 {
-    int ret;
+    int i, ret;
 
     // unreset hw
     usleep(400000);
@@ -412,6 +922,9 @@ int init_hw()
     IOWR_ALTERA_AVALON_PIO_DATA(PIO_0_BASE, sys_ctrl);
 
     I2C_init(I2CA_BASE,ALT_CPU_FREQ, 400000);
+    I2C_queue_init(&i2c_qa, I2CA_BASE);
+
+    init_i2c_shadows(0);
 
     // Init character OLED
     us2066_init(&chardisp_dev);
@@ -437,6 +950,12 @@ int init_hw()
         return ret;
     }
 
+    // Line buffer depth depends on FPGA build
+    if (sc->sc_caps.lb_lines)
+        set_linebuf_lines(sc->sc_caps.lb_lines);
+
+    init_hscale_coefs();
+
     // Enable test pattern generation
     sys_ctrl |= SCTRL_VGTP_ENABLE;
     IOWR_ALTERA_AVALON_PIO_DATA(PIO_0_BASE, sys_ctrl);
@@ -467,6 +986,9 @@ int init_hw()
         return ret;
     }
 
+    // Chips whose init sequence includes resets are shadowed only afterwards
+    init_i2c_shadows(1);
+
     /*check_flash();
     ret = read_flash(0, 100, buf);
     printf("ret: %d\n", ret);
@@ -478,6 +1000,14 @@ int init_hw()
     set_default_keymap();
     init_menu();
 
+    // Restore keymap and last used profile
+    init_userdata();
+    read_userdata(INIT_CONFIG_SLOT, 0);
+    read_userdata(profile_sel, 0);
+    profile_sel_menu = profile_sel;
+    for (i=0; i<HOTPROF_NUM; i++)
+        hotprof_load(i);
+
     return 0;
 }
 
@@ -531,11 +1061,43 @@ void switch_audsrc(audinput_t *audsrc_map, HDMI_audio_fmt_t *aud_tx_fmt) {
     *aud_tx_fmt = (audsrc == AUD_SPDIF) ? AUDIO_SPDIF : AUDIO_I2S;
 }
 
+// Profile hotkey followed by number key loads the profile, pressing
+// hotkey again switches to next hot profile. Returns 1 if key was consumed.
+int switch_profile(rc_code_t code) {
+    if (!prof_hotkey_armed) {
+        if (code != RC_PROF_HOTKEY)
+            return 0;
+
+        strncpy(menu_row1, "Profile load:", US2066_ROW_LEN+1);
+        sniprintf(menu_row2, US2066_ROW_LEN+1, "press 0-%u", MAX_PROFILE);
+        ui_disp_menu(1);
+        prof_hotkey_armed = 1;
+        return 1;
+    }
+
+    if (code >= REMOTE_MAX_KEYS)
+        return 0;
+
+    if (code <= RC_BTN0)
+        target_profile = (code == RC_BTN0) ? 0 : (code-RC_BTN1+1);
+    else if (code == RC_PROF_HOTKEY)
+        target_profile = (profile_sel+1) % HOTPROF_NUM;
+
+    ui_disp_status(1);
+    prof_hotkey_armed = 0;
+
+    return 1;
+}
+
 void switch_tp_mode(rc_code_t code) {
     if (code == RC_LEFT)
-        target_tp_stdmode_idx--;
+        tp_stdmode_step = -1;
     else if (code == RC_RIGHT)
-        target_tp_stdmode_idx++;
+        tp_stdmode_step = 1;
+    else
+        return;
+
+    target_tp_stdmode_idx += tp_stdmode_step;
 }
 
 int sys_is_powered_on() {
@@ -546,9 +1108,154 @@ void sys_toggle_power() {
     sys_powered_on ^= 1;
 }
 
+int load_profile() {
+    int retval;
+
+    retval = read_userdata(profile_sel_menu, 0);
+    if (retval == 0) {
+        profile_sel = profile_sel_menu;
+        write_userdata(INIT_CONFIG_SLOT);
+    }
+
+    return retval;
+}
+
+int save_profile() {
+    int retval;
+
+    strncpy(target_profile_name, (enable_tp || (vmode_in.name[0] == 0)) ? "<used>" : vmode_in.name, PROFILE_NAME_LEN+1);
+
+    retval = write_userdata(profile_sel_menu);
+    if (retval == 0) {
+        profile_sel = profile_sel_menu;
+        write_userdata(INIT_CONFIG_SLOT);
+        hotprof_load(profile_sel);
+    }
+
+    return retval;
+}
+
+// Arms measurement of delay from selected region turning bright on input until
+// it turns bright on output. Result is polled by latency_test_service().
+int latency_test() {
+    lt_config_reg lt_config = {.data=0};
+
+    lt_config.lt_mode = lt_sel;
+    lt_config.lt_arm = 1;
+    sc->lt_config.data = lt_config.data;
+
+    strncpy(menu_row2, "Waiting event", US2066_ROW_LEN+1);
+    ui_disp_menu(2);
+
+    lt_ts = alt_timestamp();
+    lt_pending = 1;
+
+    return 1;
+}
+
+static int lt_menu_visible() {
+    menunavi *navi = get_current_menunavi();
+    menuitem_t *item = &navi->m->items[navi->mp];
+
+    return is_menu_active() && (item->type == OPT_FUNC_CALL) && (item->fun.f == latency_test);
+}
+
+// Show result of armed latency test on second menu row. Test is cancelled if
+// user leaves the menu item.
+void latency_test_service() {
+    lt_status_reg lt_status;
+    uint32_t pclk_o_hz, lat_clks, lat_us;
+
+    if (!lt_pending)
+        return;
+
+    lt_status.data = sc->lt_status.data;
+
+    if (!lt_menu_visible()) {
+        sc->lt_config.data = 0;
+        lt_pending = 0;
+        return;
+    }
+
+    if (!lt_status.lt_finished && (alt_timestamp() - lt_ts < LT_TIMEOUT_MS*(TIMER_0_FREQ/1000)))
+        return;
+
+    sc->lt_config.data = 0;
+    lt_pending = 0;
+
+    pclk_o_hz = get_pclk_meas_hz(sc->pclk_out_meas.data);
+
+    if (!lt_status.lt_finished) {
+        sniprintf(menu_row2, US2066_ROW_LEN+1, "Failed (%d)", -1);
+    } else if (pclk_o_hz == 0) {
+        sniprintf(menu_row2, US2066_ROW_LEN+1, "Failed (%d)", -2);
+    } else {
+        lat_clks = lt_status.lt_lat_lines*vmode_out.timings.h_total + lt_status.lt_lat_pixels;
+        lat_us = (uint32_t)(((uint64_t)lat_clks*1000000)/pclk_o_hz);
+
+        printf("Latency: %u lines + %u pixels (%u.%03ums)\n", (unsigned)lt_status.lt_lat_lines, (unsigned)lt_status.lt_lat_pixels, (unsigned)(lat_us/1000), (unsigned)(lat_us%1000));
+        sniprintf(menu_row2, US2066_ROW_LEN+1, "%u.%02ums", (unsigned)(lat_us/1000), (unsigned)((lat_us%1000)/10));
+    }
+
+    ui_disp_menu(2);
+}
+
+int export_mode_stats() {
+    int ret;
+
+    if (!mmc_dev->has_init)
+        return -1;
+
+    res = f_mount(&fs, "", 1);
+    if (res != FR_OK)
+        return -res;
+
+    ret = ms_log_export_csv("modesw.csv");
+    f_mount(NULL, "", 0);
+
+    return ret;
+}
+
+void print_ms_stats() {
+    const ms_record_t *rec;
+    uint32_t total_sum=0, total_max=0;
+    int i, row = 0;
+    memset((void*)osd->osd_array.data, 0, sizeof(osd_char_array));
+
+    rec = ms_log_get(0);
+    if (rec) {
+        sniprintf((char*)osd->osd_array.data[row][0], OSD_CHAR_COLS, "Last mode switch:");
+        sniprintf((char*)osd->osd_array.data[row][1], OSD_CHAR_COLS, "%s (%s)", rec->name, rec->amode_match ? "Adaptive" : "Pure");
+        for (i=0; i<MSP_LAST; i++) {
+            sniprintf((char*)osd->osd_array.data[++row][0], OSD_CHAR_COLS, "%s:", ms_phase_str[i]);
+            sniprintf((char*)osd->osd_array.data[row][1], OSD_CHAR_COLS, "%luus", rec->phase_us[i]);
+        }
+        sniprintf((char*)osd->osd_array.data[++row][0], OSD_CHAR_COLS, "Total:");
+        sniprintf((char*)osd->osd_array.data[row][1], OSD_CHAR_COLS, "%luus", rec->total_us);
+        row++;
+
+        for (i=0; i<ms_log_count(); i++) {
+            rec = ms_log_get(i);
+            total_sum += rec->total_us;
+            if (rec->total_us > total_max)
+                total_max = rec->total_us;
+        }
+        sniprintf((char*)osd->osd_array.data[++row][0], OSD_CHAR_COLS, "Avg/max (last %u):", ms_log_count());
+        sniprintf((char*)osd->osd_array.data[row][1], OSD_CHAR_COLS, "%luus / %luus", total_sum/ms_log_count(), total_max);
+    } else {
+        sniprintf((char*)osd->osd_array.data[row][0], OSD_CHAR_COLS, "No mode switches");
+    }
+    osd->osd_config.status_refresh = 1;
+    osd->osd_row_color.mask = 0;
+    osd->osd_sec_enable[0].mask = (1<<(row+1))-1;
+    osd->osd_sec_enable[1].mask = (1<<(row+1))-1;
+}
+
 void print_vm_stats() {
     alt_timestamp_type ts = alt_timestamp();
+    uint32_t pclk_i_hz, pclk_o_hz;
     int row = 0;
+
     memset((void*)osd->osd_array.data, 0, sizeof(osd_char_array));
 
     if (enable_tp || (enable_isl && isl_dev.sync_active) || (enable_hdmirx && advrx_dev.sync_active)) {
@@ -577,6 +1284,13 @@ void print_vm_stats() {
         sniprintf((char*)osd->osd_array.data[row][1], OSD_CHAR_COLS, "%-5u %-5u", vmode_out.timings.h_active, vmode_out.timings.v_active);
         sniprintf((char*)osd->osd_array.data[++row][0], OSD_CHAR_COLS, "H/V total:");
         sniprintf((char*)osd->osd_array.data[row][1], OSD_CHAR_COLS, "%-5u %-5u", vmode_out.timings.h_total, vmode_out.timings.v_total);
+        pclk_i_hz = enable_tp ? 0 : get_pclk_meas_hz(enable_hdmirx ? sc->pclk_hdmirx_meas.data : sc->pclk_isl_meas.data);
+        pclk_o_hz = get_pclk_meas_hz(sc->pclk_out_meas.data);
+        sniprintf((char*)osd->osd_array.data[++row][0], OSD_CHAR_COLS, "PCLK in/out:");
+        sniprintf((char*)osd->osd_array.data[row][1], OSD_CHAR_COLS, "%lu.%.2lu/%lu.%.2luMHz", pclk_i_hz/1000000, (pclk_i_hz%1000000)/10000, pclk_o_hz/1000000, (pclk_o_hz%1000000)/10000);
+        // CRC32 of last output frame, taken before OSD overlay
+        sniprintf((char*)osd->osd_array.data[++row][0], OSD_CHAR_COLS, "Frame CRC:");
+        sniprintf((char*)osd->osd_array.data[row][1], OSD_CHAR_COLS, "0x%.8lx", sc->frame_crc);
         row++;
 
         sniprintf((char*)osd->osd_array.data[++row][0], OSD_CHAR_COLS, "Audio fmt/fs/CC/CA:");
@@ -587,17 +1301,24 @@ void print_vm_stats() {
     sniprintf((char*)osd->osd_array.data[row][1], OSD_CHAR_COLS, "v%u.%.2u @ " __DATE__, FW_VER_MAJOR, FW_VER_MINOR);
     sniprintf((char*)osd->osd_array.data[++row][0], OSD_CHAR_COLS, "Uptime:");
     sniprintf((char*)osd->osd_array.data[row][1], OSD_CHAR_COLS, "%luh %lumin", (uint32_t)((ts/TIMER_0_FREQ)/3600), ((uint32_t)((ts/TIMER_0_FREQ)/60) % 60));
+    sniprintf((char*)osd->osd_array.data[++row][0], OSD_CHAR_COLS, "I2C load:");
+    sniprintf((char*)osd->osd_array.data[row][1], OSD_CHAR_COLS, "%lu bytes/tick", i2c_bytes_tick);
+    sniprintf((char*)osd->osd_array.data[++row][0], OSD_CHAR_COLS, "I2C saved:");
+    sniprintf((char*)osd->osd_array.data[row][1], OSD_CHAR_COLS, "%lu bytes/tick", i2c_saved_tick);
     osd->osd_config.status_refresh = 1;
     osd->osd_row_color.mask = 0;
     osd->osd_sec_enable[0].mask = (1<<(row+1))-1;
     osd->osd_sec_enable[1].mask = (1<<(row+1))-1;
-}
+}
 
 void mainloop()
 {
     int i, man_input_change;
-    int mode, amode_match;
+    int mode;
+    uint8_t amode_match;
+    input_mode_t *im;
     uint32_t pclk_i_hz, pclk_o_hz, dotclk_hz, h_hz, v_hz_x100, pll_h_total, pll_h_total_prev=0;
+    int32_t si_err_ppb;
     ths_channel_t target_ths_ch;
     ths_input_t target_ths_input;
     isl_input_t target_isl_input=0;
@@ -606,7 +1327,6 @@ void mainloop()
     vm_mult_config_t vm_conf;
     status_t status;
     avconfig_t *cur_avconfig;
-    alt_timestamp_type start_ts;
 
     enable_isl = 0;
     enable_hdmirx = 0;
@@ -614,8 +1334,9 @@ void mainloop()
 
     cur_avconfig = get_current_avconfig();
 
+    init_events();
+
     while (1) {
-        start_ts = alt_timestamp();
         target_avinput = avinput;
         read_controls();
         parse_control();
@@ -623,7 +1344,15 @@ void mainloop()
         if (!sys_powered_on)
             break;
 
+        man_input_change = (target_avinput != avinput);
+
+        if (man_input_change)
+            auto_input_reset();
+        else
+            target_avinput = auto_input_select(avinput, (enable_isl && isl_dev.sync_active) || (enable_hdmirx && advrx_dev.sync_active));
+
         if (target_avinput != avinput) {
+            ms_log_start();
 
             // defaults
             enable_isl = 1;
@@ -728,14 +1457,27 @@ void mainloop()
                 isl_dev.sync_active = 0;
                 pll_h_total_prev = 0;
 
-                // send current PLL h_total to isl_frontend for mode detection
-                sc->hv_in_config.h_total = isl_get_pll_htotal(&isl_dev);
-
                 // set some defaults
                 if (target_isl_sync == SYNC_HV)
                     sys_ctrl |= SCTRL_ISL_VS_TYPE;
                 if (target_format == FORMAT_YPbPr)
                     sys_ctrl |= SCTRL_CSC_ENABLE;
+
+                // pre-arm with last mode seen on this input so that matching
+                // source does not need reconfiguration once sync is detected.
+                // ISL51002 is powered down until then, frontend is set up on sync up.
+                im = &input_mode[avinput];
+                if (im->valid) {
+                    get_sc_config(&im->ms.vm_in, &im->ms.vm_out, &im->ms.vm_conf, cur_avconfig, &im->ms.sc_cfg);
+                    apply_output_setup(&im->ms);
+                    input_mode_prearmed = 1;
+                    printf("Pre-armed %s\n", im->ms.vm_in.name);
+                } else {
+                    input_mode_prearmed = 0;
+                }
+
+                // send current PLL h_total to isl_frontend for mode detection
+                sc->hv_in_config.h_total = isl_get_pll_htotal(&isl_dev);
             } else if (enable_hdmirx) {
                 advrx_dev.sync_active = 0;
                 sys_ctrl |= SCTRL_CAPTURE_SEL;
@@ -746,6 +1488,9 @@ void mainloop()
             adv761x_enable_power(&advrx_dev, enable_hdmirx);
 
             switch_audsrc(cur_avconfig->audio_src_map, &cur_avconfig->hdmitx_cfg.audio_fmt);
+            hotprof_src_valid = 0;
+            // restore TX audio config possibly overridden by previous input
+            set_avconfig_dirty(AVC_DIRTY_TX);
 
             IOWR_ALTERA_AVALON_PIO_DATA(PIO_0_BASE, sys_ctrl);
 
@@ -756,20 +1501,55 @@ void mainloop()
 
         status = update_avconfig();
 
+        // cached setups are stale after mode option changes
+        if (status == MODE_CHANGE) {
+            invalidate_input_modes();
+            input_mode_prearmed = 0;
+        }
+
+        if (target_profile >= 0) {
+            if (((enable_isl && isl_dev.sync_active) || (enable_hdmirx && advrx_dev.sync_active)) &&
+                (hotprof_apply(target_profile, &vmode_in, &vmode_out, &vm_conf, &amode_match, &pll_h_total_prev) == 0))
+            {
+                printf("Hot profile %d applied\n", target_profile);
+                profile_sel = target_profile;
+                write_initcfg_deferred();
+            } else {
+                profile_sel_menu = target_profile;
+                load_profile();
+            }
+            target_profile = -1;
+        }
+
         if (enable_tp) {
             if (tp_stdmode_idx != target_tp_stdmode_idx) {
-                get_standard_mode((unsigned)target_tp_stdmode_idx, &vm_conf, &vmode_in, &vmode_out);
+                // skip modes without a Si5351 config, in direction of last mode change
+                for (i=0; i<num_stdmodes; i++) {
+                    get_standard_mode((unsigned)target_tp_stdmode_idx, &vm_conf, &vmode_in, &vmode_out);
+                    if (vmode_out.si_pclk_mult > 0) {
+                        pclk_o_hz = vmode_out.si_pclk_mult*si_dev.xtal_freq;
+                        break;
+                    }
+                    pclk_o_hz = (vmode_out.timings.h_total*vmode_out.timings.v_total*(vmode_out.timings.v_hz_max ? vmode_out.timings.v_hz_max : 60))/(1+vmode_out.timings.interlaced);
+                    if (vmode_out.si_ms_conf.pll_p3 ||
+                        (si5351_calc_frac_mult(si_dev.xtal_freq, pclk_o_hz, si_dev.xtal_freq, &vmode_out.si_ms_conf, &si_err_ppb) == 0))
+                        break;
+                    printf("Test mode %s skipped, no Si5351 config\n", vmode_out.name);
+                    target_tp_stdmode_idx += tp_stdmode_step;
+                }
+
+                adv7513_set_pixelrep_vic(&advtx_dev, vmode_out.tx_pixelrep, vmode_out.hdmitx_pixr_ifr, vmode_out.vic);
+
                 if (vmode_out.si_pclk_mult > 0) {
                     si5351_set_integer_mult(&si_dev, SI_PLLA, SI_CLK0, SI_XTAL, si_dev.xtal_freq, vmode_out.si_pclk_mult, vmode_out.si_ms_conf.outdiv);
-                    pclk_o_hz = vmode_out.si_pclk_mult*si_dev.xtal_freq;
-                } else {
-                    si5351_set_frac_mult(&si_dev, SI_PLLA, SI_CLK0, SI_XTAL, &vmode_out.si_ms_conf);
-                    pclk_o_hz = (vmode_out.timings.h_total*vmode_out.timings.v_total*(vmode_out.timings.v_hz_max ? vmode_out.timings.v_hz_max : 60))/(1+vmode_out.timings.interlaced);
+                    si_frac_active = 0;
+                } else if (vmode_out.si_ms_conf.pll_p3) {
+                    set_tp_pclk_frac(&vmode_out.si_ms_conf);
                 }
 
                 update_osd_size(&vmode_out);
                 update_sc_config(&vmode_in, &vmode_out, &vm_conf, cur_avconfig);
-                adv7513_set_pixelrep_vic(&advtx_dev, vmode_out.tx_pixelrep, vmode_out.hdmitx_pixr_ifr, vmode_out.vic);
+                pclk_check_arm(pclk_o_hz, 0);
 
                 //sniprintf(row2, US2066_ROW_LEN+1, "%ux%u%c @ %uHz", vmode_out.timings.h_active, vmode_out.timings.v_active<<vmode_out.timings.interlaced, vmode_out.timings.interlaced ? 'i' : ' ', vmode_out.timings.v_hz_max);
                 sniprintf(row2, US2066_ROW_LEN+1, "Test: %s", vmode_out.name);
@@ -779,9 +1559,13 @@ void mainloop()
             }
         } else if (enable_isl) {
             if (isl_check_activity(&isl_dev, target_isl_input, target_isl_sync)) {
+                ms_log_start();
                 if (isl_dev.sync_active) {
                     isl_enable_power(&isl_dev, 1);
                     isl_enable_outputs(&isl_dev, 1);
+                    if (input_mode_prearmed)
+                        apply_fe_setup(&input_mode[avinput].ms, &pll_h_total_prev);
+                    sync_meas_pending = 1;
                     printf("ISL51002 sync up\n");
                 } else {
                     isl_enable_power(&isl_dev, 0);
@@ -794,21 +1578,12 @@ void mainloop()
             }
 
             if (isl_dev.sync_active) {
-                if (isl_get_sync_stats(&isl_dev, sc->fe_status.vtotal, sc->fe_status.interlace_flag, sc->fe_status2.pcnt_frame) || (status == MODE_CHANGE)) {
-
-#ifdef ISL_MEAS_HZ
-                    if (isl_dev.sm.h_period_x16 > 0)
-                        h_hz = (16*isl_dev.xtal_freq)/isl_dev.sm.h_period_x16;
-                    else
-                        h_hz = 0;
-                    if ((isl_dev.sm.h_period_x16 > 0) && (isl_dev.ss.v_total > 0))
-                        v_hz_x100 = (16*5*isl_dev.xtal_freq)/((isl_dev.sm.h_period_x16 * isl_dev.ss.v_total) / (100/5));
-                    else
-                        v_hz_x100 = 0;
-#else
-                    v_hz_x100 = (100*27000000UL)/isl_dev.ss.pcnt_frame;
-                    h_hz = (100*27000000UL)/((100*isl_dev.ss.pcnt_frame*(1+isl_dev.ss.interlace_flag))/isl_dev.ss.v_total);
-#endif
+                if (sync_meas_changed() || (status == MODE_CHANGE)) {
+                    // changes without sync loss are timed from detection
+                    if (!ms_log_active())
+                        ms_log_start();
+                    get_sync_meas(&isl_dev.ss, &isl_dev.sm, &h_hz, &v_hz_x100);
+                    ms_log_phase(MSP_SYNC_STATS);
 
                     memset(&vmode_in, 0, sizeof(mode_data_t));
                     vmode_in.timings.h_synclen = isl_dev.sm.h_synclen_x16 / 16;
@@ -816,14 +1591,21 @@ void mainloop()
                     vmode_in.timings.v_total = isl_dev.ss.v_total;
                     vmode_in.timings.interlaced = isl_dev.ss.interlace_flag;
 
-                    mode = get_adaptive_lm_mode(&vmode_in, &vmode_out, &vm_conf);
+                    hotprof_set_source(&vmode_in, h_hz);
+                    im = &input_mode[avinput];
 
-                    if (mode < 0) {
-                        amode_match = 0;
-                        mode = get_pure_lm_mode(&vmode_in, &vmode_out, &vm_conf);
+                    mode = get_lm_mode(&vmode_in, &vmode_out, &vm_conf, &amode_match);
+
+                    // keep pre-armed setup if measured timings select the same mode, otherwise
+                    // go through full setup with lookup result
+                    if (input_mode_prearmed && (mode >= 0) && (mode == im->mode) && (amode_match == im->ms.amode_match)) {
+                        memcpy(&vmode_in, &im->ms.vm_in, sizeof(mode_data_t));
+                        memcpy(&vmode_out, &im->ms.vm_out, sizeof(mode_data_t));
+                        memcpy(&vm_conf, &im->ms.vm_conf, sizeof(vm_mult_config_t));
                     } else {
-                        amode_match = 1;
+                        input_mode_prearmed = 0;
                     }
+                    ms_log_phase(MSP_MODE_SEARCH);
 
                     if (mode >= 0) {
                         printf("\nMode %s selected (%s linemult)\n", vmode_in.name, amode_match ? "Adaptive" : "Pure");
@@ -845,22 +1627,31 @@ void mainloop()
                         printf("Estimated source dot clock: %lu.%.2uMHz\n", (dotclk_hz+5000)/1000000, ((dotclk_hz+5000)%1000000)/10000);
                         printf("PCLK_IN: %luHz PCLK_OUT: %luHz\n", pclk_i_hz, pclk_o_hz);
 
-                        isl_source_setup(&isl_dev, pll_h_total);
+                        ms_log_mark();
+                        if (!input_mode_prearmed) {
+                            isl_source_setup(&isl_dev, pll_h_total);
 
-                        isl_set_afe_bw(&isl_dev, dotclk_hz);
+                            isl_set_afe_bw(&isl_dev, dotclk_hz);
 
-                        if (pll_h_total != pll_h_total_prev)
-                            isl_set_sampler_phase(&isl_dev, vmode_in.sampler_phase);
+                            if (pll_h_total != pll_h_total_prev)
+                                isl_set_sampler_phase(&isl_dev, vmode_in.sampler_phase);
 
-                        pll_h_total_prev = pll_h_total;
+                            pll_h_total_prev = pll_h_total;
+                            ms_log_phase(MSP_FE_SETUP);
 
-                        // Setup Si5351
-                        if (amode_match) {
-                            si5351_set_frac_mult(&si_dev, SI_PLLA, SI_CLK0, SI_CLKIN, &vmode_out.si_ms_conf);
-                            sys_ctrl |= SCTRL_ADAPT_LM;
-                        } else {
-                            si5351_set_integer_mult(&si_dev, SI_PLLA, SI_CLK0, SI_CLKIN, pclk_i_hz, vmode_out.si_pclk_mult, 0);
-                            sys_ctrl &= ~SCTRL_ADAPT_LM;
+                            // Setup VIC and pixel repetition before Si5351, see si_qupdate_t
+                            adv7513_set_pixelrep_vic(&advtx_dev, vmode_out.tx_pixelrep, vmode_out.hdmitx_pixr_ifr, vmode_out.vic);
+                            ms_log_phase(MSP_TX_SETUP);
+
+                            // Setup Si5351
+                            if (amode_match) {
+                                set_pclk_frac(&vmode_out.si_ms_conf);
+                                sys_ctrl |= SCTRL_ADAPT_LM;
+                            } else {
+                                set_pclk_int(pclk_i_hz, vmode_out.si_pclk_mult);
+                                sys_ctrl &= ~SCTRL_ADAPT_LM;
+                            }
+                            ms_log_phase(MSP_SI5351);
                         }
 
                         // TODO: dont read polarity from ISL51002
@@ -871,12 +1662,32 @@ void mainloop()
                             sys_ctrl |= SCTRL_ISL_VS_POL;
                         IOWR_ALTERA_AVALON_PIO_DATA(PIO_0_BASE, sys_ctrl);
 
-                        update_osd_size(&vmode_out);
-                        update_sc_config(&vmode_in, &vmode_out, &vm_conf, cur_avconfig);
+                        if (!input_mode_prearmed) {
+                            update_osd_size(&vmode_out);
+                            update_sc_config(&vmode_in, &vmode_out, &vm_conf, cur_avconfig);
+                            ms_log_phase(MSP_SC_CONFIG);
+                        }
 
-                        // Setup VIC and pixel repetition
-                        adv7513_set_pixelrep_vic(&advtx_dev, vmode_out.tx_pixelrep, vmode_out.hdmitx_pixr_ifr, vmode_out.vic);
+                        ms_log_commit(vmode_in.name, amode_match);
+
+                        // adaptive mode output follows source rate, nothing to verify
+                        pclk_check_arm(amode_match ? 0 : pclk_o_hz, vm_conf.h_skip+1);
+
+                        // remember setup for pre-arming on next switch to this input
+                        im->mode = mode;
+                        memcpy(&im->ms.vm_in, &vmode_in, sizeof(mode_data_t));
+                        memcpy(&im->ms.vm_out, &vmode_out, sizeof(mode_data_t));
+                        memcpy(&im->ms.vm_conf, &vm_conf, sizeof(vm_mult_config_t));
+                        im->ms.amode_match = amode_match;
+                        im->ms.pll_h_total = pll_h_total;
+                        im->ms.pclk_i_hz = pclk_i_hz;
+                        im->ms.dotclk_hz = dotclk_hz;
+                        im->valid = 1;
+                    } else {
+                        im->valid = 0;
+                        ms_log_stop();
                     }
+                    input_mode_prearmed = 0;
                 } else if (status == SC_CONFIG_CHANGE) {
                     update_sc_config(&vmode_in, &vmode_out, &vm_conf, cur_avconfig);
                 }
@@ -884,9 +1695,11 @@ void mainloop()
 
             }
 
-            isl_update_config(&isl_dev, &cur_avconfig->isl_cfg);
+            if (get_avconfig_changes(AVC_DIRTY_ISL))
+                isl_update_config(&isl_dev, &cur_avconfig->isl_cfg);
         } else if (enable_hdmirx) {
             if (adv761x_check_activity(&advrx_dev)) {
+                ms_log_start();
                 if (advrx_dev.sync_active) {
                     printf("adv sync up\n");
                 } else {
@@ -899,6 +1712,9 @@ void mainloop()
 
             if (advrx_dev.sync_active) {
                 if (adv761x_get_sync_stats(&advrx_dev) || (status == MODE_CHANGE)) {
+                    if (!ms_log_active())
+                        ms_log_start();
+                    ms_log_phase(MSP_SYNC_STATS);
                     h_hz = advrx_dev.pclk_hz/advrx_dev.ss.h_total;
                     v_hz_x100 = (((h_hz*10000)/advrx_dev.ss.v_total)+50)/100;
 
@@ -919,14 +1735,9 @@ void mainloop()
                     vmode_in.timings.interlaced = advrx_dev.ss.interlace_flag;
                     //TODO: VIC+pixelrep
 
-                    mode = get_adaptive_lm_mode(&vmode_in, &vmode_out, &vm_conf);
-
-                    if (mode < 0) {
-                        amode_match = 0;
-                        mode = get_pure_lm_mode(&vmode_in, &vmode_out, &vm_conf);
-                    } else {
-                        amode_match = 1;
-                    }
+                    hotprof_set_source(&vmode_in, h_hz);
+                    mode = get_lm_mode(&vmode_in, &vmode_out, &vm_conf, &amode_match);
+                    ms_log_phase(MSP_MODE_SEARCH);
 
                     if (mode >= 0) {
                         printf("\nMode %s selected (%s linemult)\n", vmode_in.name, amode_match ? "Adaptive" : "Pure");
@@ -942,26 +1753,37 @@ void mainloop()
                         pclk_i_hz = h_hz * advrx_dev.ss.h_total;
                         pclk_o_hz = vmode_out.si_pclk_mult ? vmode_out.si_pclk_mult*pclk_i_hz : (vmode_out.timings.h_total*vmode_out.timings.v_total*(vmode_out.timings.v_hz_max ? vmode_out.timings.v_hz_max : 60))/(1+vmode_out.timings.interlaced);
                         printf("H: %u.%.2ukHz V: %u.%.2uHz PCLK_IN: %luHz\n\n", h_hz/1000, (((h_hz%1000)+5)/10), (v_hz_x100/100), (v_hz_x100%100), pclk_i_hz);
+                        ms_log_mark();
+
+                        // Setup RX input color space
+                        adv761x_set_input_cs(&advrx_dev);
+                        ms_log_phase(MSP_FE_SETUP);
+
+                        // Setup VIC and pixel repetition before Si5351, see si_qupdate_t
+                        adv7513_set_pixelrep_vic(&advtx_dev, vmode_out.tx_pixelrep, vmode_out.hdmitx_pixr_ifr, vmode_out.vic);
+                        ms_log_phase(MSP_TX_SETUP);
 
                         // Setup Si5351
                         if (amode_match) {
-                            si5351_set_frac_mult(&si_dev, SI_PLLA, SI_CLK0, SI_CLKIN, &vmode_out.si_ms_conf);
+                            set_pclk_frac(&vmode_out.si_ms_conf);
                             sys_ctrl |= SCTRL_ADAPT_LM;
                         } else {
-                            si5351_set_integer_mult(&si_dev, SI_PLLA, SI_CLK0, SI_CLKIN, pclk_i_hz, vmode_out.si_pclk_mult, 0);
+                            set_pclk_int(pclk_i_hz, vmode_out.si_pclk_mult);
                             sys_ctrl &= ~SCTRL_ADAPT_LM;
                         }
+                        ms_log_phase(MSP_SI5351);
 
                         IOWR_ALTERA_AVALON_PIO_DATA(PIO_0_BASE, sys_ctrl);
 
                         update_osd_size(&vmode_out);
                         update_sc_config(&vmode_in, &vmode_out, &vm_conf, cur_avconfig);
+                        ms_log_phase(MSP_SC_CONFIG);
 
-                        // Setup RX input color space
-                        adv761x_set_input_cs(&advrx_dev);
+                        ms_log_commit(vmode_in.name, amode_match);
 
-                        // Setup VIC and pixel repetition
-                        adv7513_set_pixelrep_vic(&advtx_dev, vmode_out.tx_pixelrep, vmode_out.hdmitx_pixr_ifr, vmode_out.vic);
+                        pclk_check_arm(amode_match ? 0 : pclk_o_hz, 0);
+                    } else {
+                        ms_log_stop();
                     }
                 } else if (status == SC_CONFIG_CHANGE) {
                     update_sc_config(&vmode_in, &vmode_out, &vm_conf, cur_avconfig);
@@ -983,17 +1805,34 @@ void mainloop()
                     IOWR_ALTERA_AVALON_PIO_DATA(PIO_0_BASE, sys_ctrl);
                 }
             }
-            adv761x_update_config(&advrx_dev, &cur_avconfig->hdmirx_cfg);
+            if (get_avconfig_changes(AVC_DIRTY_HDMIRX))
+                adv761x_update_config(&advrx_dev, &cur_avconfig->hdmirx_cfg);
         }
 
+        // TX interrupt signals HPD change, main map is reset while HPD is low
+        if (ev_sys_status & (1<<SSTAT_HDMITX_INT_BIT))
+            i2c_shadow_invalidate(&advtx_shadow);
         adv7513_check_hpd_power(&advtx_dev);
         adv7513_update_config(&advtx_dev, &cur_avconfig->hdmitx_cfg);
 
-        pcm186x_update_config(&pcm_dev, &cur_avconfig->pcm_cfg);
+        if (get_avconfig_changes(AVC_DIRTY_PCM))
+            pcm186x_update_config(&pcm_dev, &cur_avconfig->pcm_cfg);
 
         check_sdcard();
 
-        while (alt_timestamp() < start_ts + MAINLOOP_INTERVAL_US*(TIMER_0_FREQ/1000000)) {}
+        userdata_service();
+        hotprof_service();
+        pclk_check_service();
+        latency_test_service();
+
+        // I2C bus traffic during this iteration
+        i2c_bytes_tick = I2C_get_bytecnt() - i2c_bytecnt_prev;
+        i2c_bytecnt_prev += i2c_bytes_tick;
+        i2c_saved_tick = i2c_shadow_get_saved() - i2c_savedcnt_prev;
+        i2c_savedcnt_prev += i2c_saved_tick;
+
+        // sleep until next input/frontend/TX event or mainloop tick
+        wait_events();
     }
 }
 
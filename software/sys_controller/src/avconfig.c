@@ -18,6 +18,7 @@
 //
 
 #include <string.h>
+#include <stddef.h>
 #include "system.h"
 #include "avconfig.h"
 #include "av_controller.h"
@@ -28,6 +29,10 @@
 // Current and target configuration
 avconfig_t cc, tc;
 
+// Groups of tc fields modified since last update, and groups applied
+// to cc but not yet consumed by device drivers
+static uint8_t tc_dirty, cc_pending;
+
 // Default configuration
 const avconfig_t tc_default = {
     .l3_mode = 1,
@@ -62,6 +67,10 @@ avconfig_t* get_current_avconfig() {
     return &cc;
 }
 
+avconfig_t* get_target_avconfig() {
+    return &tc;
+}
+
 int set_default_avconfig(int update_cc)
 {
     memcpy(&tc, &tc_default, sizeof(avconfig_t));
@@ -85,60 +94,146 @@ int set_default_avconfig(int update_cc)
 
     set_default_vm_table();
 
+    tc_dirty = AVC_DIRTY_ALL;
+
     return 0;
 }
 
+#define AVC_IN_FIELD(offs, f) (((offs) >= offsetof(avconfig_t, f)) && ((offs) < offsetof(avconfig_t, f)+sizeof(tc.f)))
+
+static uint8_t get_field_dirty_flags(size_t offs) {
+    if (AVC_IN_FIELD(offs, isl_cfg))
+        return AVC_DIRTY_ISL;
+    if (AVC_IN_FIELD(offs, hdmitx_cfg))
+        return AVC_DIRTY_TX;
+#ifdef INC_ADV761X
+    if (AVC_IN_FIELD(offs, hdmirx_cfg))
+        return AVC_DIRTY_HDMIRX;
+#endif
+#ifdef INC_PCM186X
+    if (AVC_IN_FIELD(offs, pcm_cfg))
+        return AVC_DIRTY_PCM;
+#endif
+    if (AVC_IN_FIELD(offs, audio_src_map) ||
+        AVC_IN_FIELD(offs, audmux_sel) ||
+        AVC_IN_FIELD(offs, audio_fmt))
+        return AVC_DIRTY_AUDIO;
+
+    if (AVC_IN_FIELD(offs, mask_br) ||
+        AVC_IN_FIELD(offs, mask_color) ||
+        AVC_IN_FIELD(offs, reverse_lpf) ||
+        AVC_IN_FIELD(offs, lm_deint_mode) ||
+        AVC_IN_FIELD(offs, nir_even_offset) ||
+        AVC_IN_FIELD(offs, ypbpr_cs) ||
+        AVC_IN_FIELD(offs, framebuffer) ||
+        AVC_IN_FIELD(offs, hscale) ||
+        AVC_IN_FIELD(offs, vscale))
+        return AVC_DIRTY_SC;
+
+    if (AVC_IN_FIELD(offs, pm_240p) ||
+        AVC_IN_FIELD(offs, pm_384p) ||
+        AVC_IN_FIELD(offs, pm_480i) ||
+        AVC_IN_FIELD(offs, pm_480p) ||
+        AVC_IN_FIELD(offs, pm_1080i) ||
+        AVC_IN_FIELD(offs, l2_mode) ||
+        AVC_IN_FIELD(offs, l3_mode) ||
+        AVC_IN_FIELD(offs, l4_mode) ||
+        AVC_IN_FIELD(offs, l5_mode) ||
+        AVC_IN_FIELD(offs, l5_fmt) ||
+        AVC_IN_FIELD(offs, pm_ad_240p) ||
+        AVC_IN_FIELD(offs, pm_ad_288p) ||
+        AVC_IN_FIELD(offs, pm_ad_480i) ||
+        AVC_IN_FIELD(offs, pm_ad_576i) ||
+        AVC_IN_FIELD(offs, pm_ad_480p) ||
+        AVC_IN_FIELD(offs, pm_ad_576p) ||
+        AVC_IN_FIELD(offs, sm_ad_240p_288p) ||
+        AVC_IN_FIELD(offs, sm_ad_480i_576i) ||
+        AVC_IN_FIELD(offs, sm_ad_480p) ||
+        AVC_IN_FIELD(offs, sm_ad_576p) ||
+        AVC_IN_FIELD(offs, adapt_lm) ||
+        AVC_IN_FIELD(offs, s480p_mode) ||
+        AVC_IN_FIELD(offs, s400p_mode) ||
+        AVC_IN_FIELD(offs, upsample2x) ||
+        AVC_IN_FIELD(offs, default_vic))
+        return AVC_DIRTY_MODE;
+
+    return AVC_DIRTY_MISC;
+}
+
+void set_avconfig_dirty(uint8_t mask) {
+    tc_dirty |= mask;
+}
+
+void set_avconfig_field_dirty(const void *field) {
+    const uint8_t *ptr = field;
+
+    // ignore menu items not backed by target config
+    if ((ptr < (const uint8_t*)&tc) || (ptr >= (const uint8_t*)&tc + sizeof(avconfig_t)))
+        return;
+
+    tc_dirty |= get_field_dirty_flags((size_t)(ptr - (const uint8_t*)&tc));
+}
+
+// Return and clear the given groups that have been applied to cc since last call
+uint8_t get_avconfig_changes(uint8_t mask) {
+    uint8_t changes = cc_pending & mask;
+
+    cc_pending &= ~mask;
+
+    return changes;
+}
+
 status_t update_avconfig() {
     status_t status = NO_CHANGE;
+    uint8_t dirty = tc_dirty;
 
-    if ((tc.mask_br != cc.mask_br) ||
-        (tc.mask_color != cc.mask_color) ||
-        (tc.reverse_lpf != cc.reverse_lpf) ||
-        (tc.lm_deint_mode != cc.lm_deint_mode) ||
-        (tc.nir_even_offset != cc.nir_even_offset) ||
-        (tc.ypbpr_cs != cc.ypbpr_cs))
-        status = (status < SC_CONFIG_CHANGE) ? SC_CONFIG_CHANGE : status;
-
-    if ((tc.pm_240p != cc.pm_240p) ||
-        (tc.pm_384p != cc.pm_384p) ||
-        (tc.pm_480i != cc.pm_480i) ||
-        (tc.pm_480p != cc.pm_480p) ||
-        (tc.pm_1080i != cc.pm_1080i) ||
-        (tc.l2_mode != cc.l2_mode) ||
-        (tc.l3_mode != cc.l3_mode) ||
-        (tc.l4_mode != cc.l4_mode) ||
-        (tc.l5_mode != cc.l5_mode) ||
-        (tc.l5_fmt != cc.l5_fmt) ||
-        (tc.pm_ad_240p != cc.pm_ad_240p) ||
-        (tc.pm_ad_288p != cc.pm_ad_288p) ||
-        (tc.pm_ad_480i != cc.pm_ad_480i) ||
-        (tc.pm_ad_576i != cc.pm_ad_576i) ||
-        (tc.pm_ad_480p != cc.pm_ad_480p) ||
-        (tc.pm_ad_576p != cc.pm_ad_576p) ||
-        (tc.sm_ad_240p_288p != cc.sm_ad_240p_288p) ||
-        (tc.sm_ad_480i_576i != cc.sm_ad_480i_576i) ||
-        (tc.sm_ad_480p != cc.sm_ad_480p) ||
-        (tc.sm_ad_576p != cc.sm_ad_576p) ||
-        (tc.adapt_lm != cc.adapt_lm) ||
-        (tc.upsample2x != cc.upsample2x) ||
-        (tc.default_vic != cc.default_vic))
-        status = (status < MODE_CHANGE) ? MODE_CHANGE : status;
+    if (!dirty)
+        return NO_CHANGE;
 
-#ifndef DExx_FW
-    if (tc.audmux_sel != cc.audmux_sel)
-        switch_audmux(tc.audmux_sel);
-#endif
-    if (memcmp(tc.audio_src_map, cc.audio_src_map, 4*sizeof(audinput_t)))
-        switch_audsrc(tc.audio_src_map, &tc.hdmitx_cfg.audio_fmt);
+    tc_dirty = 0;
+
+    if (dirty & AVC_DIRTY_SC)
+        status = SC_CONFIG_CHANGE;
 
-    memcpy(&cc, &tc, sizeof(avconfig_t));
+    if (dirty & AVC_DIRTY_MODE) {
+        status = MODE_CHANGE;
+        invalidate_vm_index();
+    }
 
+    if (dirty & AVC_DIRTY_AUDIO) {
+#ifndef DExx_FW
+        if (tc.audmux_sel != cc.audmux_sel)
+            switch_audmux(tc.audmux_sel);
+#endif
+        if (memcmp(tc.audio_src_map, cc.audio_src_map, 4*sizeof(audinput_t)))
+            switch_audsrc(tc.audio_src_map, &tc.hdmitx_cfg.audio_fmt);
+
+        // derived TX/PCM fields below depend on audio settings
+        dirty |= AVC_DIRTY_TX|AVC_DIRTY_PCM;
+    }
+
+    if (dirty & (AVC_DIRTY_SC|AVC_DIRTY_MODE|AVC_DIRTY_AUDIO|AVC_DIRTY_MISC))
+        memcpy(&cc, &tc, offsetof(avconfig_t, isl_cfg));
+    if (dirty & AVC_DIRTY_ISL)
+        memcpy(&cc.isl_cfg, &tc.isl_cfg, sizeof(tc.isl_cfg));
+    if (dirty & AVC_DIRTY_TX) {
+        memcpy(&cc.hdmitx_cfg, &tc.hdmitx_cfg, sizeof(tc.hdmitx_cfg));
+        cc.hdmitx_cfg.i2s_fs = audio_fmt_iec_map[cc.audio_fmt];
+        cc.hdmitx_cfg.audio_cc_val = CC_2CH;
+        cc.hdmitx_cfg.audio_ca_val = CA_2p0;
+    }
+#ifdef INC_ADV761X
+    if (dirty & AVC_DIRTY_HDMIRX)
+        memcpy(&cc.hdmirx_cfg, &tc.hdmirx_cfg, sizeof(tc.hdmirx_cfg));
+#endif
 #ifdef INC_PCM186X
-    cc.pcm_cfg.fs = cc.audio_fmt;
+    if (dirty & AVC_DIRTY_PCM) {
+        memcpy(&cc.pcm_cfg, &tc.pcm_cfg, sizeof(tc.pcm_cfg));
+        cc.pcm_cfg.fs = cc.audio_fmt;
+    }
 #endif
-    cc.hdmitx_cfg.i2s_fs = audio_fmt_iec_map[cc.audio_fmt];
-    cc.hdmitx_cfg.audio_cc_val = CC_2CH;
-    cc.hdmitx_cfg.audio_ca_val = CA_2p0;
+
+    cc_pending |= dirty;
 
     return status;
 }
@@ -140,14 +140,18 @@ void parse_control()
 
     if (sys_is_powered_on()) {
         if (!is_menu_active()) {
-            if ((c <= RC_BTN0) || (c == RC_UP) || (c == RC_DOWN))
+            if (switch_profile(c))
+                ; // consumed by profile hotkey sequence
+            else if ((c <= RC_BTN0) || (c == RC_UP) || (c == RC_DOWN))
                 switch_input(c, b);
             else if (c == RC_MENU)
                 display_menu(c);
-            if ((c == RC_LEFT) || (c == RC_RIGHT))
+            else if ((c == RC_LEFT) || (c == RC_RIGHT))
                 switch_tp_mode(c);
-            if (c == RC_INFO)
+            else if (c == RC_INFO)
                 print_vm_stats();
+            else if (c == RC_OK)
+                print_ms_stats();
         } else {
             if (c <= RC_RIGHT)
                 display_menu(c);
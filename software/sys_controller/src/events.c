@@ -0,0 +1,69 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <stdint.h>
+#include "system.h"
+#include "altera_avalon_pio_regs.h"
+#include "sysconfig.h"
+#include "i2c_opencores.h"
+#include "av_controller.h"
+#include "controls.h"
+#include "events.h"
+
+extern I2C_queue i2c_qa;
+
+uint32_t ev_controls, ev_sys_status;
+
+void init_events() {
+    // PIO edge captures and I2C cores are routed to CPU IRQ lines. Interrupts are kept
+    // globally disabled and only used to resume execution from WFI, which zero-riscy
+    // does for any IRQ passed on by event unit.
+    IOWR_ALTERA_AVALON_PIO_EDGE_CAP(PIO_1_BASE, 0xffffffff);
+    IOWR_ALTERA_AVALON_PIO_EDGE_CAP(PIO_2_BASE, 0xffffffff);
+    IOWR_ALTERA_AVALON_PIO_IRQ_MASK(PIO_1_BASE, CONTROLS_RRPT_MASK|CONTROLS_BTN_MASK);
+    IOWR_ALTERA_AVALON_PIO_IRQ_MASK(PIO_2_BASE, SSTAT_EVENT_MASK);
+
+    cpu_irq_disable();
+    EU_IRQ_CLEAR_PENDING = WAKE_IRQ_MASK;
+    EU_IRQ_ENABLE |= WAKE_IRQ_MASK;
+}
+
+void wait_events() {
+    while (1) {
+        // drop latched IRQs before polling sources. Anything arriving after this sets its
+        // pending bit again and makes WFI return at once.
+        EU_IRQ_CLEAR_PENDING = WAKE_IRQ_MASK;
+
+        // advance queued I2C transactions, core IRQs wake us after each byte
+        I2C_queue_service(&i2c_qa);
+        si_seq_service();
+
+        ev_controls = IORD_ALTERA_AVALON_PIO_EDGE_CAP(PIO_1_BASE) & (CONTROLS_RRPT_MASK|CONTROLS_BTN_MASK);
+        ev_sys_status = IORD_ALTERA_AVALON_PIO_EDGE_CAP(PIO_2_BASE) & SSTAT_EVENT_MASK;
+
+        if (ev_controls || ev_sys_status)
+            break;
+
+        // sleep is bounded by mainloop tick edge on sys_status every MAINLOOP_INTERVAL_US
+        cpu_wfi();
+    }
+
+    IOWR_ALTERA_AVALON_PIO_EDGE_CAP(PIO_1_BASE, ev_controls);
+    IOWR_ALTERA_AVALON_PIO_EDGE_CAP(PIO_2_BASE, ev_sys_status);
+}
@@ -0,0 +1,121 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <string.h>
+#include "system.h"
+#include "io.h"
+#include "flash.h"
+
+#define FLASH_CSR_BASE      INTEL_GENERIC_SERIAL_FLASH_INTERFACE_TOP_0_AVL_CSR_BASE
+#define FLASH_MEM_BASE      INTEL_GENERIC_SERIAL_FLASH_INTERFACE_TOP_0_AVL_MEM_BASE
+
+// Generic Serial Flash Interface CSR (word offsets)
+#define GSFI_CMD_SETTING    0x7
+#define GSFI_CMD_CTRL       0x8
+#define GSFI_CMD_ADDR       0x9
+#define GSFI_CMD_WDATA0     0xa
+#define GSFI_CMD_WDATA1     0xb
+#define GSFI_CMD_RDATA0     0xc
+
+#define GSFI_CMD(opcode, addr_bytes, rd, data_bytes)  ((opcode) | ((addr_bytes)<<8) | ((rd)<<11) | ((data_bytes)<<12))
+
+// SPI flash opcodes
+#define SPIF_WREN           0x06
+#define SPIF_RDSR           0x05
+#define SPIF_PP             0x02
+#define SPIF_SSE            0x20
+
+#define SPIF_SR_WIP         (1<<0)
+
+// Max number of status polls before program/erase is considered failed
+#define FLASH_POLL_TIMEOUT  1000000
+
+// Code runs from the same flash via XIP and instruction fetches are not
+// served while a program/erase is in progress. Command, poll and program
+// loops are therefore executed from onchip RAM and must not call into
+// flash-resident code (e.g. libc) until the flash is ready again.
+#define RAMFUNC __attribute__((section(".ramfunc"), noinline))
+
+static RAMFUNC void flash_cmd(uint32_t setting, uint32_t addr) {
+    IOWR_32DIRECT(FLASH_CSR_BASE, 4*GSFI_CMD_SETTING, setting);
+    IOWR_32DIRECT(FLASH_CSR_BASE, 4*GSFI_CMD_ADDR, addr);
+    IOWR_32DIRECT(FLASH_CSR_BASE, 4*GSFI_CMD_CTRL, 1);
+}
+
+static RAMFUNC int flash_wait_ready() {
+    uint32_t i;
+
+    for (i=0; i<FLASH_POLL_TIMEOUT; i++) {
+        flash_cmd(GSFI_CMD(SPIF_RDSR, 0, 1, 1), 0);
+        if (!(IORD_32DIRECT(FLASH_CSR_BASE, 4*GSFI_CMD_RDATA0) & SPIF_SR_WIP))
+            return 0;
+    }
+
+    return -1;
+}
+
+// Direct pointer to memory-mapped flash contents
+const uint8_t* flash_ptr(uint32_t offset) {
+    return (const uint8_t*)(FLASH_MEM_BASE + offset);
+}
+
+int flash_read(uint32_t offset, uint32_t length, uint8_t *dstbuf) {
+    if ((offset + length) > FLASH_SIZE)
+        return -1;
+
+    memcpy(dstbuf, flash_ptr(offset), length);
+
+    return 0;
+}
+
+RAMFUNC int flash_write(uint32_t offset, const uint8_t *srcbuf, uint32_t length) {
+    uint32_t i, j, w[2];
+
+    if ((offset % FLASH_WRITE_ALIGN) || (length % FLASH_WRITE_ALIGN) || ((offset + length) > FLASH_SIZE))
+        return -1;
+
+    // 8-byte programs never cross a page boundary when aligned
+    for (i=0; i<length; i+=FLASH_WRITE_ALIGN) {
+        w[0] = w[1] = 0;
+        for (j=0; j<FLASH_WRITE_ALIGN; j++)
+            w[j/4] |= (uint32_t)srcbuf[i+j] << (8*(j%4));
+
+        IOWR_32DIRECT(FLASH_CSR_BASE, 4*GSFI_CMD_WDATA0, w[0]);
+        IOWR_32DIRECT(FLASH_CSR_BASE, 4*GSFI_CMD_WDATA1, w[1]);
+
+        flash_cmd(GSFI_CMD(SPIF_WREN, 0, 0, 0), 0);
+        flash_cmd(GSFI_CMD(SPIF_PP, 3, 0, FLASH_WRITE_ALIGN), offset+i);
+
+        if (flash_wait_ready() != 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+RAMFUNC int flash_erase_subsector(uint32_t offset) {
+    if ((offset % FLASH_SUBSECTOR_SIZE) || (offset >= FLASH_SIZE))
+        return -1;
+
+    flash_cmd(GSFI_CMD(SPIF_WREN, 0, 0, 0), 0);
+    flash_cmd(GSFI_CMD(SPIF_SSE, 3, 0, 0), offset);
+
+    return flash_wait_ready();
+}
@@ -0,0 +1,276 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include "system.h"
+#include "i2c_opencores.h"
+#include "i2c_shadow.h"
+
+#define SH_BIT_SET(arr, i)  ((arr)[(i)/32] |= (1UL<<((i)%32)))
+#define SH_BIT_CLR(arr, i)  ((arr)[(i)/32] &= ~(1UL<<((i)%32)))
+#define SH_BIT_GET(arr, i)  (((arr)[(i)/32] >> ((i)%32)) & 1)
+
+static i2c_shadow_t *sh_devs[I2C_SHADOW_MAX_DEVS];
+static int sh_num_devs;
+
+// bytes not put on bus thanks to shadowing, wraps around
+static uint32_t sh_saved;
+
+void i2c_shadow_init(i2c_shadow_t *sh, uint32_t i2cm_base, uint8_t i2c_addr) {
+    memset(sh, 0, sizeof(i2c_shadow_t));
+    sh->i2cm_base = i2cm_base;
+    sh->i2c_addr = i2c_addr;
+    sh->page_reg = -1;
+}
+
+// Mark register whose writes have side effects or whose contents change
+// by itself (status, self-clearing, write-to-clear). It is always written.
+void i2c_shadow_set_nocache(i2c_shadow_t *sh, uint8_t regaddr) {
+    SH_BIT_SET(sh->nocache, regaddr);
+    SH_BIT_CLR(sh->valid, regaddr);
+}
+
+void i2c_shadow_set_nocache_range(i2c_shadow_t *sh, uint8_t first, uint8_t last) {
+    int i;
+
+    for (i=first; i<=last; i++)
+        i2c_shadow_set_nocache(sh, i);
+}
+
+// Register selecting page of a paged register map. Only page 0 is shadowed,
+// writes to other pages are passed on as is.
+void i2c_shadow_set_pagereg(i2c_shadow_t *sh, uint8_t regaddr) {
+    i2c_shadow_set_nocache(sh, regaddr);
+    sh->page_reg = regaddr;
+    sh->page = 0;
+}
+
+// Forget known register contents, e.g. after device reset or power-down
+void i2c_shadow_invalidate(i2c_shadow_t *sh) {
+    memset(sh->valid, 0, sizeof(sh->valid));
+    memset(sh->dirty, 0, sizeof(sh->dirty));
+}
+
+static int i2c_shadow_burst_write(i2c_shadow_t *sh, uint8_t regaddr, int len) {
+    uint8_t buf[1+256];
+
+    buf[0] = regaddr;
+    memcpy(buf+1, sh->regs+regaddr, len);
+
+    return (I2C_write_buf(sh->i2cm_base, sh->i2c_addr, buf, len+1, 1) == I2C_ACK) ? 0 : -1;
+}
+
+static void i2c_shadow_mark_written(i2c_shadow_t *sh, int regaddr, int len) {
+    int i;
+
+    for (i=regaddr; (i<regaddr+len) && (i<256); i++) {
+        if (!SH_BIT_GET(sh->nocache, i))
+            SH_BIT_SET(sh->valid, i);
+        SH_BIT_CLR(sh->dirty, i);
+    }
+}
+
+// Forget registers written bypassing shadow with unknown resulting contents
+static void i2c_shadow_forget(i2c_shadow_t *sh, int regaddr, int len) {
+    int i;
+
+    for (i=regaddr; (i<regaddr+len) && (i<256); i++) {
+        SH_BIT_CLR(sh->valid, i);
+        SH_BIT_CLR(sh->dirty, i);
+    }
+}
+
+// Read through shadow. Only registers with static contents should be accessed
+// this way, status registers must be read directly from device.
+int i2c_shadow_readreg(i2c_shadow_t *sh, uint8_t regaddr, uint8_t *data) {
+    if (!SH_BIT_GET(sh->valid, regaddr)) {
+        if (I2C_start(sh->i2cm_base, sh->i2c_addr, 0) != I2C_OK)
+            return -1;
+        I2C_write(sh->i2cm_base, regaddr, 0);
+        I2C_start(sh->i2cm_base, sh->i2c_addr, 1);
+        sh->regs[regaddr] = I2C_read(sh->i2cm_base, 1);
+        SH_BIT_SET(sh->valid, regaddr);
+    }
+
+    *data = sh->regs[regaddr];
+
+    return 0;
+}
+
+// Immediate write, skipped if register is known to hold the value already
+int i2c_shadow_writereg(i2c_shadow_t *sh, uint8_t regaddr, uint8_t data) {
+    if (SH_BIT_GET(sh->valid, regaddr) && !SH_BIT_GET(sh->dirty, regaddr) && (sh->regs[regaddr] == data)) {
+        sh_saved += 3;
+        return 0;
+    }
+
+    sh->regs[regaddr] = data;
+
+    if (i2c_shadow_burst_write(sh, regaddr, 1) != 0) {
+        SH_BIT_CLR(sh->valid, regaddr);
+        SH_BIT_CLR(sh->dirty, regaddr);
+        return -1;
+    }
+
+    i2c_shadow_mark_written(sh, regaddr, 1);
+
+    return 0;
+}
+
+// Deferred write, transferred on next i2c_shadow_flush()
+void i2c_shadow_setreg(i2c_shadow_t *sh, uint8_t regaddr, uint8_t data) {
+    if (SH_BIT_GET(sh->valid, regaddr) && (sh->regs[regaddr] == data))
+        return;
+
+    sh->regs[regaddr] = data;
+    SH_BIT_SET(sh->dirty, regaddr);
+}
+
+// Record contents written bypassing shadow (queued or sequencer transfers)
+void i2c_shadow_update(i2c_shadow_t *sh, uint8_t regaddr, const uint8_t *data, int len) {
+    if (regaddr+len > 256)
+        len = 256-regaddr;
+
+    memcpy(sh->regs+regaddr, data, len);
+    i2c_shadow_mark_written(sh, regaddr, len);
+}
+
+// Write all dirty registers, coalescing nearby ones into auto-increment bursts
+int i2c_shadow_flush(i2c_shadow_t *sh) {
+    int i, start, end, gap;
+    int ret = 0;
+
+    for (i=0; i<256; i++) {
+        if (!SH_BIT_GET(sh->dirty, i))
+            continue;
+
+        start = end = i;
+        gap = 0;
+
+        for (i=i+1; i<256; i++) {
+            if (SH_BIT_GET(sh->dirty, i)) {
+                end = i;
+                gap = 0;
+            } else if (SH_BIT_GET(sh->valid, i) && (gap < I2C_SHADOW_MAX_GAP)) {
+                gap++;
+            } else {
+                break;
+            }
+        }
+
+        if (i2c_shadow_burst_write(sh, start, end-start+1) == 0) {
+            i2c_shadow_mark_written(sh, start, end-start+1);
+        } else {
+            // contents unknown after failed write, driver retries on next update
+            for (i=start; i<=end; i++) {
+                SH_BIT_CLR(sh->valid, i);
+                SH_BIT_CLR(sh->dirty, i);
+            }
+            ret = -1;
+        }
+
+        i = end;
+    }
+
+    return ret;
+}
+
+static i2c_shadow_t* i2c_shadow_find(uint32_t base, uint8_t addr) {
+    int i;
+
+    for (i=0; i<sh_num_devs; i++) {
+        if ((sh_devs[i]->i2cm_base == base) && (sh_devs[i]->i2c_addr == addr))
+            return sh_devs[i];
+    }
+
+    return NULL;
+}
+
+static int i2c_shadow_match(alt_u32 base, alt_u8 addr) {
+    return (i2c_shadow_find(base, addr) != NULL);
+}
+
+// Driver write transaction (register address + data) intercepted in HAL
+static alt_u32 i2c_shadow_commit(alt_u32 base, alt_u8 addr, const alt_u8 *buf, int len, alt_u32 last) {
+    i2c_shadow_t *sh = i2c_shadow_find(base, addr);
+    uint32_t bytecnt, sent;
+    int i, pg_written;
+
+    if (len < 2)
+        return I2C_write_buf(base, addr, buf, len, last);
+
+    // page select and writes to other pages go to device as is
+    if (sh->page_reg >= 0) {
+        pg_written = (buf[0] <= sh->page_reg) && (buf[0]+len-1 > sh->page_reg);
+        if (pg_written || (sh->page != 0)) {
+            if (sh->page == 0)
+                i2c_shadow_forget(sh, buf[0], len-1);
+            if (pg_written)
+                sh->page = buf[1+sh->page_reg-buf[0]];
+            return I2C_write_buf(base, addr, buf, len, last);
+        }
+    }
+
+    // auto-increment beyond end of map is device specific, do not cache it
+    if (buf[0]+len-1 > 256) {
+        i2c_shadow_forget(sh, buf[0], len-1);
+        return I2C_write_buf(base, addr, buf, len, last);
+    }
+
+    // register pointer setup for a read, or write continuing in another transaction
+    if (!last) {
+        i2c_shadow_update(sh, buf[0], buf+1, len-1);
+        return I2C_write_buf(base, addr, buf, len, last);
+    }
+
+    for (i=1; i<len; i++)
+        i2c_shadow_setreg(sh, buf[0]+i-1, buf[i]);
+
+    // driver sees a single transaction, count bytes it would have used. Gap
+    // merging may also put more on bus than that.
+    bytecnt = I2C_get_bytecnt();
+    if (i2c_shadow_flush(sh) != 0)
+        return I2C_NOACK;
+    sent = I2C_get_bytecnt() - bytecnt;
+    if (sent < (uint32_t)(1+len))
+        sh_saved += (1+len) - sent;
+
+    return I2C_ACK;
+}
+
+static const I2C_write_filter sh_filter = {i2c_shadow_match, i2c_shadow_commit};
+
+// Route driver writes to the device through shadow. Shadow must be invalidated
+// whenever the device loses its register contents (reset, power-down).
+int i2c_shadow_register(i2c_shadow_t *sh) {
+    if (i2c_shadow_find(sh->i2cm_base, sh->i2c_addr))
+        return 0;
+    else if (sh_num_devs == I2C_SHADOW_MAX_DEVS)
+        return -1;
+
+    sh_devs[sh_num_devs++] = sh;
+    I2C_set_write_filter(&sh_filter);
+
+    return 0;
+}
+
+uint32_t i2c_shadow_get_saved() {
+    return sh_saved;
+}
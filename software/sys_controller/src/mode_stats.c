@@ -0,0 +1,125 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include "system.h"
+#include "sys/alt_timestamp.h"
+#include "ff.h"
+#include "mode_stats.h"
+
+#define TS_TO_US(ts) ((uint32_t)((ts)/(TIMER_0_FREQ/1000000)))
+
+const char *ms_phase_str[] = { "Sync stats", "Mode search", "FE setup", "Si5351", "SC config", "TX setup" };
+
+// ring buffer of the last MS_LOG_LEN mode switches
+static ms_record_t ms_log[MS_LOG_LEN];
+static unsigned ms_log_head, ms_log_cnt;
+
+static ms_record_t ms_cur;
+static alt_timestamp_type ms_ts_prev;
+static uint8_t ms_active;
+
+// start timing a mode switch, restarts a measurement already in progress
+void ms_log_start() {
+    memset(&ms_cur, 0, sizeof(ms_record_t));
+    ms_ts_prev = alt_timestamp();
+    ms_active = 1;
+}
+
+// drop measurement in progress, e.g. when no mode was found for the source
+void ms_log_stop() {
+    ms_active = 0;
+}
+
+int ms_log_active() {
+    return ms_active;
+}
+
+// restart phase timer without accounting the elapsed time to any phase
+void ms_log_mark() {
+    ms_ts_prev = alt_timestamp();
+}
+
+void ms_log_phase(ms_phase_t phase) {
+    alt_timestamp_type ts = alt_timestamp();
+    uint32_t us = TS_TO_US(ts - ms_ts_prev);
+
+    ms_cur.phase_us[phase] += us;
+    ms_cur.total_us += us;
+    ms_ts_prev = ts;
+}
+
+void ms_log_commit(const char *name, uint8_t amode_match) {
+    strncpy(ms_cur.name, name, sizeof(ms_cur.name)-1);
+    ms_cur.amode_match = amode_match;
+
+    memcpy(&ms_log[ms_log_head], &ms_cur, sizeof(ms_record_t));
+    ms_log_head = (ms_log_head+1) % MS_LOG_LEN;
+    if (ms_log_cnt < MS_LOG_LEN)
+        ms_log_cnt++;
+    ms_active = 0;
+
+    printf("Mode switch took %luus\n", ms_cur.total_us);
+}
+
+unsigned ms_log_count() {
+    return ms_log_cnt;
+}
+
+// idx 0 is the most recent switch
+const ms_record_t* ms_log_get(unsigned idx) {
+    if (idx >= ms_log_cnt)
+        return NULL;
+
+    return &ms_log[(ms_log_head+MS_LOG_LEN-1-idx) % MS_LOG_LEN];
+}
+
+// write log as CSV, oldest entry first. Filesystem must be mounted by caller.
+int ms_log_export_csv(const char *path) {
+    FIL file;
+    FRESULT res;
+    char buf[128];
+    const ms_record_t *rec;
+    unsigned bw;
+    int i, j, len;
+
+    res = f_open(&file, path, FA_WRITE|FA_CREATE_ALWAYS);
+    if (res != FR_OK)
+        return -res;
+
+    len = sniprintf(buf, sizeof(buf), "mode,adaptive");
+    for (j=0; j<MSP_LAST; j++)
+        len += sniprintf(buf+len, sizeof(buf)-len, ",%s", ms_phase_str[j]);
+    len += sniprintf(buf+len, sizeof(buf)-len, ",total\n");
+    res = f_write(&file, buf, len, &bw);
+
+    for (i=ms_log_cnt-1; (i>=0) && (res == FR_OK); i--) {
+        rec = ms_log_get(i);
+        len = sniprintf(buf, sizeof(buf), "%s,%u", rec->name, rec->amode_match);
+        for (j=0; j<MSP_LAST; j++)
+            len += sniprintf(buf+len, sizeof(buf)-len, ",%lu", rec->phase_us[j]);
+        len += sniprintf(buf+len, sizeof(buf)-len, ",%lu\n", rec->total_us);
+        res = f_write(&file, buf, len, &bw);
+    }
+
+    f_close(&file);
+
+    return -res;
+}
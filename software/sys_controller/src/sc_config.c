@@ -0,0 +1,135 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <string.h>
+#include "sc_config.h"
+
+int framebuf_supported(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *vm_conf)
+{
+    uint32_t line_beats, y_rpt;
+
+    if ((vm_in->timings.h_active > FB_LINE_W_MAX) || (vm_in->timings.v_active > FB_LINES_MAX))
+        return 0;
+
+    line_beats = ((vm_in->timings.h_active+7)/8)*4;
+
+    // write DMA stores every captured line
+    if (line_beats*vm_in->timings.v_active*vm_in->timings.v_hz_max > (FB_DMA_CLK_HZ/100)*FB_DMA_UTIL_PCT)
+        return 0;
+
+    // read DMA must fetch a source line within the output lines it is repeated on
+    y_rpt = (vm_conf->y_rpt > 7) ? 1 : vm_conf->y_rpt+1;
+    if (line_beats*vm_out->timings.v_total*vm_out->timings.v_hz_max > y_rpt*(FB_DMA_CLK_HZ/100)*FB_DMA_UTIL_PCT)
+        return 0;
+
+    return 1;
+}
+
+void get_sc_config(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *vm_conf, avconfig_t *avconfig, sc_config_t *cfg)
+{
+    uint32_t src_w, dst_w, vs_step, hs_step, ar_num, ar_den;
+    vm_mult_config_t vm_conf_vs;
+    uint8_t fb_enable = avconfig->framebuffer && framebuf_supported(vm_in, vm_out, vm_conf);
+
+    memset(cfg, 0, sizeof(sc_config_t));
+
+    // Vertical scaling reads linebuf only, and replaces line multiplication config if applicable
+    if (avconfig->vscale && !fb_enable) {
+        memcpy(&vm_conf_vs, vm_conf, sizeof(vm_mult_config_t));
+        if (get_vscale_config(vm_in, vm_out, &vm_conf_vs, &vs_step) == 0) {
+            vm_conf = &vm_conf_vs;
+            cfg->vscale_config.vscale_step = vs_step;
+            cfg->vscale_config.vscale_enable = 1;
+        }
+    }
+
+    // Set input params
+    cfg->hv_in_config.h_total = vm_in->timings.h_total;
+    cfg->hv_in_config.h_active = vm_in->timings.h_active;
+    cfg->hv_in_config.h_synclen = vm_in->timings.h_synclen;
+    cfg->hv_in_config2.h_backporch = vm_in->timings.h_backporch;
+    cfg->hv_in_config2.v_active = vm_in->timings.v_active;
+    cfg->hv_in_config3.v_backporch = vm_in->timings.v_backporch;
+    cfg->hv_in_config3.v_synclen = vm_in->timings.v_synclen;
+    cfg->hv_in_config2.interlaced = vm_in->timings.interlaced;
+    cfg->hv_in_config3.h_skip = vm_conf->h_skip;
+    cfg->hv_in_config3.h_sample_sel = vm_conf->h_skip / 2; // TODO: fix
+
+    // Set output params
+    cfg->hv_out_config.h_total = vm_out->timings.h_total;
+    cfg->hv_out_config.h_active = vm_out->timings.h_active;
+    cfg->hv_out_config.h_synclen = vm_out->timings.h_synclen;
+    cfg->hv_out_config2.h_backporch = vm_out->timings.h_backporch;
+    cfg->hv_out_config2.v_total = vm_out->timings.v_total;
+    cfg->hv_out_config2.v_active = vm_out->timings.v_active;
+    cfg->hv_out_config3.v_backporch = vm_out->timings.v_backporch;
+    cfg->hv_out_config3.v_synclen = vm_out->timings.v_synclen;
+    cfg->hv_out_config2.interlaced = vm_out->timings.interlaced;
+    cfg->hv_out_config3.v_startline = vm_conf->framesync_line;
+
+    cfg->xy_out_config.x_size = vm_conf->x_size;
+    cfg->xy_out_config.y_size = vm_conf->y_size;
+    cfg->xy_out_config.y_offset = vm_conf->y_offset;
+    cfg->xy_out_config2.x_offset = vm_conf->x_offset;
+    cfg->xy_out_config2.x_start_lb = vm_conf->x_start_lb;
+    cfg->xy_out_config2.y_start_lb = vm_conf->y_start_lb;
+    cfg->xy_out_config2.y_start_lb_hi = vm_conf->y_start_lb >> 6;
+    cfg->xy_out_config2.x_rpt = vm_conf->x_rpt;
+    cfg->xy_out_config2.y_rpt = vm_conf->y_rpt;
+
+    cfg->misc_config.mask_br = avconfig->mask_br;
+    cfg->misc_config.mask_color = avconfig->mask_color;
+    cfg->misc_config.reverse_lpf = avconfig->reverse_lpf;
+    cfg->misc_config.lm_deint_mode = avconfig->lm_deint_mode;
+    cfg->misc_config.nir_even_offset = avconfig->nir_even_offset;
+    cfg->misc_config.ypbpr_cs = avconfig->ypbpr_cs;
+    cfg->misc_config.fb_enable = fb_enable;
+
+    // Horizontal scaler replaces pixel repetition, stretching source to full height
+    // at 4:3 display aspect, or 8:7 for 256-column sources if selected
+    if (avconfig->hscale) {
+        if ((vm_in->timings.h_active == 256) && avconfig->ar_256col) {
+            ar_num = 8;
+            ar_den = 7;
+        } else {
+            ar_num = 4;
+            ar_den = 3;
+        }
+        src_w = vm_conf->x_size/(vm_conf->x_rpt+1);
+        dst_w = ((vm_out->timings.v_active<<vm_out->timings.interlaced)*ar_num)/ar_den;
+        if (dst_w > vm_out->timings.h_active)
+            dst_w = vm_out->timings.h_active;
+
+        if (src_w && (dst_w >= src_w)) {
+            hs_step = (src_w<<16)/dst_w;
+            cfg->hscale_config.hscale_step = hs_step;
+            cfg->hscale_config.hscale_enable = 1;
+
+            // Align pixel centers: first output pixel samples source position
+            // (step-1)/2, i.e. phase (1+step)/2 from the pixel before x_start_lb
+            if ((hs_step < (1<<16)) && (vm_conf->x_start_lb > 0)) {
+                cfg->xy_out_config2.x_start_lb = vm_conf->x_start_lb - 1;
+                cfg->hscale_config.hscale_phase0 = ((1<<16) + hs_step) >> 5;
+            }
+            cfg->xy_out_config.x_size = dst_w;
+            cfg->xy_out_config2.x_offset = (vm_out->timings.h_active-dst_w)/2;
+            cfg->xy_out_config2.x_rpt = 0;
+        }
+    }
+}
@@ -0,0 +1,234 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include "sysconfig.h"
+#include "si5351_calc.h"
+
+typedef struct {
+    uint8_t valid;
+    uint32_t num;
+    uint32_t den;
+    uint16_t ms_div;
+    uint8_t r_div;
+    int32_t err_ppb;
+    si5351_ms_config_t ms_conf;
+} si_calc_cache_entry_t;
+
+static si_calc_cache_entry_t si_calc_cache[SI_CALC_CACHE_SIZE];
+static unsigned si_calc_cache_next;
+
+static uint64_t gcd64(uint64_t a, uint64_t b)
+{
+    uint64_t t;
+
+    while (b) {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+
+    return a;
+}
+
+// Best rational approximation b/c of n/d (n < d) with c <= c_max, using continued fractions
+static void best_frac(uint64_t n, uint64_t d, uint32_t c_max, uint32_t *b, uint32_t *c)
+{
+    uint64_t n0=n, d0=d, a, t, m;
+    uint64_t h1=1, h2=0, k1=0, k2=1, h, k;
+    uint64_t e_conv, e_semi;
+
+    while (d) {
+        a = n/d;
+        h = a*h1 + h2;
+        k = a*k1 + k2;
+
+        if (k > c_max) {
+            // pick closer of last convergent and largest allowed semiconvergent
+            m = (c_max - k2)/k1;
+            h = m*h1 + h2;
+            k = m*k1 + k2;
+            e_conv = (h1*d0 > n0*k1) ? (h1*d0 - n0*k1) : (n0*k1 - h1*d0);
+            e_semi = (h*d0 > n0*k) ? (h*d0 - n0*k) : (n0*k - h*d0);
+            if (e_semi*k1 < e_conv*k) {
+                h1 = h;
+                k1 = k;
+            }
+            break;
+        }
+
+        h2 = h1;
+        h1 = h;
+        k2 = k1;
+        k1 = k;
+        t = n - a*d;
+        n = d;
+        d = t;
+    }
+
+    *b = h1;
+    *c = k1;
+}
+
+// Try to realize PLL multiplier N/D for given integer multisynth divider. Returns error in ppb.
+static int si_calc_pll(uint32_t fin_hz, uint64_t N, uint64_t D, uint32_t *a, uint32_t *b, uint32_t *c, int32_t *err_ppb)
+{
+    uint64_t g, vco;
+    int64_t diff;
+
+    *a = N/D;
+    if ((*a < SI_PLL_MULT_MIN) || (*a > SI_PLL_MULT_MAX))
+        return -1;
+
+    vco = (uint64_t)fin_hz*(*a) + ((uint64_t)fin_hz*(N%D))/D;
+    if ((vco < SI_VCO_MIN_HZ) || (vco > SI_VCO_MAX_HZ))
+        return -1;
+
+    g = gcd64(N, D);
+    N /= g;
+    D /= g;
+
+    if (D <= SI_FRAC_DENOM_MAX) {
+        *b = N%D;
+        *c = D;
+        *err_ppb = 0;
+    } else {
+        best_frac(N%D, D, SI_FRAC_DENOM_MAX, b, c);
+        if (*b == *c) {
+            (*a)++;
+            *b = 0;
+            *c = 1;
+        }
+        diff = (int64_t)(*a)*(*c)*D + (int64_t)(*b)*D - (int64_t)N*(*c);
+        *err_ppb = (int32_t)((diff*1000000000LL)/((int64_t)N*(*c)));
+    }
+
+    if (*b == 0)
+        *c = 1;
+
+    return 0;
+}
+
+static void si_calc_regs(uint32_t a, uint32_t b, uint32_t c, uint32_t ms_div, uint8_t r_div, si5351_ms_config_t *ms_conf)
+{
+    uint32_t pll_p1, pll_p2, ms_p1;
+
+    pll_p1 = 128*a + ((128*b)/c) - 512;
+    pll_p2 = 128*b - c*((128*b)/c);
+    ms_p1 = 128*ms_div - 512;
+
+    *ms_conf = (si5351_ms_config_t){pll_p1, pll_p2, c, ms_p1, 0, 1, r_div, 0, (ms_div == 4) ? 3 : 0};
+}
+
+// Find PLL and multisynth config for fout = fin*num/den. Multisynth is kept integer
+// and PLL fractional for lowest jitter. Candidates are ranked by frequency error, then
+// by integer PLL mode, even multisynth divider and highest VCO frequency.
+int si5351_calc_frac_mult(uint32_t fin_hz, uint32_t num, uint32_t den, si5351_ms_config_t *ms_conf, int32_t *err_ppb)
+{
+    si_calc_cache_entry_t *e;
+    uint32_t a, b, c, ms_div, ms_min, ms_max;
+    uint32_t best_a=0, best_b=0, best_c=0, best_ms=0;
+    uint8_t r_div, best_r=0;
+    int32_t err, best_err=0;
+    uint64_t fout_x, N;
+    int i, found=0, better;
+
+    if (!fin_hz || !num || !den)
+        return -1;
+
+    for (i=0; i<SI_CALC_CACHE_SIZE; i++) {
+        e = &si_calc_cache[i];
+        if (e->valid && (e->num == num) && (e->den == den) &&
+            (si_calc_pll(fin_hz, (uint64_t)e->ms_div*num<<e->r_div, den, &a, &b, &c, &err) == 0))
+        {
+            memcpy(ms_conf, &e->ms_conf, sizeof(si5351_ms_config_t));
+            *err_ppb = e->err_ppb;
+            return 0;
+        }
+    }
+
+    // fout scaled by den to keep divider range calculation in integers
+    fout_x = (uint64_t)fin_hz*num;
+
+    for (r_div=0; r_div<=SI_RDIV_LOG2_MAX; r_div++) {
+        ms_min = ((SI_VCO_MIN_HZ*(uint64_t)den) + (fout_x<<r_div) - 1) / (fout_x<<r_div);
+        ms_max = (SI_VCO_MAX_HZ*(uint64_t)den) / (fout_x<<r_div);
+        if (ms_min < 4)
+            ms_min = 4;
+        if (ms_max > SI_MS_DIV_MAX)
+            ms_max = SI_MS_DIV_MAX;
+
+        for (ms_div=ms_min; ms_div<=ms_max; ms_div++) {
+            // multisynth integer dividers below 8 are limited to 4 and 6
+            if ((ms_div < 8) && (ms_div != 4) && (ms_div != 6))
+                continue;
+
+            N = ((uint64_t)ms_div*num)<<r_div;
+            if (si_calc_pll(fin_hz, N, den, &a, &b, &c, &err) != 0)
+                continue;
+
+            if (!found) {
+                better = 1;
+            } else if (((err < 0) ? -err : err) != ((best_err < 0) ? -best_err : best_err)) {
+                better = ((err < 0) ? -err : err) < ((best_err < 0) ? -best_err : best_err);
+            } else if ((b == 0) != (best_b == 0)) {
+                better = (b == 0);
+            } else if ((ms_div & 1) != (best_ms & 1)) {
+                better = !(ms_div & 1);
+            } else {
+                better = (ms_div<<r_div) > (best_ms<<best_r);
+            }
+
+            if (better) {
+                best_a = a;
+                best_b = b;
+                best_c = c;
+                best_ms = ms_div;
+                best_r = r_div;
+                best_err = err;
+                found = 1;
+            }
+        }
+
+        // R divider only needed for output below multisynth range
+        if (found)
+            break;
+    }
+
+    if (!found) {
+        printf("Si5351 config not found for %u*%u/%u\n", (unsigned)fin_hz, (unsigned)num, (unsigned)den);
+        return -1;
+    }
+
+    si_calc_regs(best_a, best_b, best_c, best_ms, best_r, ms_conf);
+    *err_ppb = best_err;
+
+    e = &si_calc_cache[si_calc_cache_next];
+    si_calc_cache_next = (si_calc_cache_next+1) % SI_CALC_CACHE_SIZE;
+    e->valid = 1;
+    e->num = num;
+    e->den = den;
+    e->ms_div = best_ms;
+    e->r_div = best_r;
+    e->err_ppb = best_err;
+    memcpy(&e->ms_conf, ms_conf, sizeof(si5351_ms_config_t));
+
+    return 0;
+}
@@ -0,0 +1,389 @@
+//
+// Copyright (C) 2021  Markus Hiienkari <mhiienka@niksula.hut.fi>
+//
+// This file is part of Open Source Scan Converter project.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <string.h>
+#include <stddef.h>
+#include "system.h"
+#include "utils.h"
+#include "flash.h"
+#include "userdata.h"
+#include "auto_input.h"
+
+// Last 16 flash sectors are reserved for userdata (see link.common.ld). The
+// area is used as a ring of erase blocks where records are only appended and
+// the newest valid record of each entry wins. Blocks are reclaimed from the
+// tail one at a time by userdata_service().
+#define UD_FLASH_OFFSET     (FLASH_SIZE - 16*FLASH_SECTOR_SIZE)
+#define UD_BLOCK_SIZE       FLASH_SUBSECTOR_SIZE
+#define UD_NUM_BLOCKS       ((16*FLASH_SECTOR_SIZE)/UD_BLOCK_SIZE)
+
+// Number of erased blocks kept available for new and relocated records
+#define UD_MIN_FREE_BLOCKS  4
+
+#define UD_REC_MAGIC        0x4455
+#define UD_ERASED_MAGIC     0xffff
+
+#define UD_REC_SIZE(len)    ((sizeof(ud_rec_hdr) + (len) + FLASH_WRITE_ALIGN-1) & ~(FLASH_WRITE_ALIGN-1))
+#define UD_BLK_OFFS(blk)    (UD_FLASH_OFFSET + (uint32_t)(blk)*UD_BLOCK_SIZE)
+#define UD_BLK_USED(blk)    ((ud_blk_used[(blk)/8] >> ((blk)%8)) & 1)
+
+typedef struct {
+    uint16_t magic;
+    uint8_t entry;
+    uint8_t version;
+    uint16_t data_len;
+    uint16_t reserved;
+    uint32_t seq;
+    uint32_t crc;
+} ud_rec_hdr;
+
+// Version 1 layouts, converted when read. Init config had no auto input
+// settings and avconfig_t had no framebuffer/hscale/vscale fields before the
+// 4-byte aligned chip configs.
+typedef struct {
+    uint8_t profile_sel;
+    uint16_t keymap[REMOTE_MAX_KEYS];
+} __attribute__((packed)) ude_initcfg_v1;
+
+#define AVC_V1_HEAD_LEN     offsetof(avconfig_t, framebuffer)
+#define AVC_V1_TAIL_OFFS    ((AVC_V1_HEAD_LEN + 3) & ~3)
+#define AVC_TAIL_LEN        (sizeof(avconfig_t) - offsetof(avconfig_t, isl_cfg))
+#define UDE_PROFILE_V1_LEN  (offsetof(ude_profile, avc) + AVC_V1_TAIL_OFFS + AVC_TAIL_LEN)
+
+// Staging buffer for a single record
+static struct {
+    ud_rec_hdr hdr;
+    union {
+        ude_initcfg initcfg;
+        ude_profile profile;
+    } data;
+    uint8_t pad[FLASH_WRITE_ALIGN];
+} __attribute__((aligned(4))) ud_buf;
+
+// Flash offset of newest valid record of each entry, 0 if none
+static uint32_t ud_index[MAX_USERDATA_ENTRY+1];
+static char ud_profile_name[MAX_PROFILE+1][PROFILE_NAME_LEN+1];
+
+static uint8_t ud_blk_used[UD_NUM_BLOCKS/8];
+static unsigned ud_free_blocks;
+static unsigned ud_head;
+static uint32_t ud_wr_offs;
+static uint32_t ud_seq;
+
+// Init config write requested by write_initcfg_deferred()
+static uint8_t ud_initcfg_pending;
+
+extern uint8_t profile_sel;
+extern char target_profile_name[PROFILE_NAME_LEN+1];
+extern uint16_t rc_keymap[REMOTE_MAX_KEYS];
+
+static uint32_t ud_rec_crc(const ud_rec_hdr *hdr, const uint8_t *data) {
+    crc32((unsigned char*)hdr, offsetof(ud_rec_hdr, crc), 1);
+    return crc32((unsigned char*)data, hdr->data_len, 0);
+}
+
+static void ud_set_blk_used(unsigned blk, int used) {
+    if (used)
+        ud_blk_used[blk/8] |= (1<<(blk%8));
+    else
+        ud_blk_used[blk/8] &= ~(1<<(blk%8));
+}
+
+static const ud_rec_hdr* ud_get_rec(int entry) {
+    return ud_index[entry] ? (const ud_rec_hdr*)flash_ptr(ud_index[entry]) : NULL;
+}
+
+static void ud_update_name(int entry) {
+    const ud_rec_hdr *hdr = ud_get_rec(entry);
+
+    if (entry > MAX_PROFILE)
+        return;
+
+    if (hdr && (((hdr->version == USERDATA_VER) && (hdr->data_len == sizeof(ude_profile))) ||
+                ((hdr->version == 1) && (hdr->data_len == UDE_PROFILE_V1_LEN))))
+        strncpy(ud_profile_name[entry], ((const ude_profile*)(hdr+1))->name, PROFILE_NAME_LEN+1);
+    else
+        ud_profile_name[entry][0] = 0;
+}
+
+// Append record staged in ud_buf.data to the log
+static int ud_append(uint8_t entry, uint8_t version, uint16_t data_len) {
+    uint32_t rec_size = UD_REC_SIZE(data_len);
+
+    if (ud_wr_offs + rec_size > UD_BLK_OFFS(ud_head) + UD_BLOCK_SIZE) {
+        ud_head = (ud_head + 1) % UD_NUM_BLOCKS;
+        if (UD_BLK_USED(ud_head))
+            return -2;
+
+        ud_set_blk_used(ud_head, 1);
+        ud_free_blocks--;
+        ud_wr_offs = UD_BLK_OFFS(ud_head);
+    }
+
+    ud_buf.hdr.magic = UD_REC_MAGIC;
+    ud_buf.hdr.entry = entry;
+    ud_buf.hdr.version = version;
+    ud_buf.hdr.data_len = data_len;
+    ud_buf.hdr.reserved = 0xffff;
+    ud_buf.hdr.seq = ud_seq;
+    ud_buf.hdr.crc = ud_rec_crc(&ud_buf.hdr, (uint8_t*)&ud_buf.data);
+    memset((uint8_t*)&ud_buf.data + data_len, 0xff, rec_size - sizeof(ud_rec_hdr) - data_len);
+
+    // advance write pointer also on failure as the area may be partially programmed
+    if (flash_write(ud_wr_offs, (uint8_t*)&ud_buf, rec_size) != 0) {
+        ud_wr_offs += rec_size;
+        return -1;
+    }
+
+    ud_index[entry] = ud_wr_offs;
+    ud_wr_offs += rec_size;
+    ud_seq++;
+    ud_update_name(entry);
+
+    return 0;
+}
+
+// Move live records out of the oldest used block and erase it
+static int ud_reclaim_block() {
+    const ud_rec_hdr *hdr;
+    unsigned i, blk;
+    int e;
+
+    for (i=1; i<UD_NUM_BLOCKS; i++) {
+        blk = (ud_head + i) % UD_NUM_BLOCKS;
+        if (UD_BLK_USED(blk))
+            break;
+    }
+    if (i == UD_NUM_BLOCKS)
+        return -1;
+
+    for (e=0; e<=MAX_USERDATA_ENTRY; e++) {
+        if ((ud_index[e] < UD_BLK_OFFS(blk)) || (ud_index[e] >= UD_BLK_OFFS(blk) + UD_BLOCK_SIZE))
+            continue;
+
+        hdr = ud_get_rec(e);
+        if (hdr->data_len > sizeof(ud_buf.data)) {
+            ud_index[e] = 0;
+            continue;
+        }
+
+        flash_read(ud_index[e]+sizeof(ud_rec_hdr), hdr->data_len, (uint8_t*)&ud_buf.data);
+        if (ud_append(e, hdr->version, hdr->data_len) != 0)
+            return -1;
+    }
+
+    if (flash_erase_subsector(UD_BLK_OFFS(blk)) != 0)
+        return -1;
+
+    ud_set_blk_used(blk, 0);
+    ud_free_blocks++;
+
+    return 0;
+}
+
+int init_userdata() {
+    const ud_rec_hdr *hdr, *prev;
+    uint32_t offs, end;
+    unsigned blk;
+    int e, head_found = 0;
+
+    memset(ud_index, 0, sizeof(ud_index));
+    memset(ud_blk_used, 0, sizeof(ud_blk_used));
+    ud_free_blocks = 0;
+    ud_seq = 0;
+
+    for (blk=0; blk<UD_NUM_BLOCKS; blk++) {
+        offs = UD_BLK_OFFS(blk);
+        end = offs + UD_BLOCK_SIZE;
+
+        if (((const ud_rec_hdr*)flash_ptr(offs))->magic == UD_ERASED_MAGIC) {
+            ud_free_blocks++;
+            continue;
+        }
+
+        ud_set_blk_used(blk, 1);
+
+        while (offs < end) {
+            hdr = (const ud_rec_hdr*)flash_ptr(offs);
+
+            if ((hdr->magic != UD_REC_MAGIC) ||
+                (hdr->entry > MAX_USERDATA_ENTRY) ||
+                (offs + UD_REC_SIZE(hdr->data_len) > end))
+                break;
+
+            if (ud_rec_crc(hdr, (const uint8_t*)(hdr+1)) == hdr->crc) {
+                prev = ud_get_rec(hdr->entry);
+                if (!prev || (hdr->seq > prev->seq))
+                    ud_index[hdr->entry] = offs;
+
+                if (!head_found || (hdr->seq >= ud_seq)) {
+                    ud_seq = hdr->seq + 1;
+                    ud_head = blk;
+                    head_found = 1;
+                }
+            }
+
+            offs += UD_REC_SIZE(hdr->data_len);
+        }
+
+        // continue writing where the newest block ends, unless it contains garbage
+        if (head_found && (ud_head == blk))
+            ud_wr_offs = (hdr->magic == UD_ERASED_MAGIC) ? offs : end;
+    }
+
+    // start from the first block if there's no data yet
+    if (!head_found) {
+        ud_head = UD_NUM_BLOCKS-1;
+        ud_wr_offs = UD_BLK_OFFS(ud_head) + UD_BLOCK_SIZE;
+    }
+
+    for (e=0; e<=MAX_PROFILE; e++)
+        ud_update_name(e);
+
+    return 0;
+}
+
+int read_userdata(int entry, int dry_run) {
+    const ud_rec_hdr *hdr;
+    ude_initcfg_v1 *initcfg_v1 = (ude_initcfg_v1*)&ud_buf.data;
+
+    if (entry > MAX_USERDATA_ENTRY)
+        return -1;
+
+    if (dry_run) {
+        if (entry <= MAX_PROFILE)
+            strncpy(target_profile_name, ud_profile_name[entry], PROFILE_NAME_LEN+1);
+        return 0;
+    }
+
+    hdr = ud_get_rec(entry);
+    if (!hdr)
+        return 1;
+
+    if (entry == INIT_CONFIG_SLOT) {
+        if ((hdr->version == 1) && (hdr->data_len == sizeof(ude_initcfg_v1))) {
+            // auto input settings keep their defaults
+            flash_read(ud_index[entry]+sizeof(ud_rec_hdr), sizeof(ude_initcfg_v1), (uint8_t*)initcfg_v1);
+            profile_sel = (initcfg_v1->profile_sel <= MAX_PROFILE) ? initcfg_v1->profile_sel : 0;
+            memcpy(rc_keymap, initcfg_v1->keymap, sizeof(rc_keymap));
+            printf("Converted v1 init config\n");
+            return 0;
+        }
+
+        if ((hdr->version != USERDATA_VER) || (hdr->data_len != sizeof(ude_initcfg))) {
+            printf("Init config v%u (%u bytes) not supported\n", hdr->version, hdr->data_len);
+            return -2;
+        }
+
+        flash_read(ud_index[entry]+sizeof(ud_rec_hdr), sizeof(ude_initcfg), (uint8_t*)&ud_buf.data.initcfg);
+        profile_sel = (ud_buf.data.initcfg.profile_sel <= MAX_PROFILE) ? ud_buf.data.initcfg.profile_sel : 0;
+        auto_input = (ud_buf.data.initcfg.auto_input <= AUTO_ALL_INPUTS) ? ud_buf.data.initcfg.auto_input : AUTO_OFF;
+        auto_av1_ypbpr = ud_buf.data.initcfg.auto_av1_ypbpr;
+        auto_av2_ypbpr = ud_buf.data.initcfg.auto_av2_ypbpr;
+        auto_av3_ypbpr = ud_buf.data.initcfg.auto_av3_ypbpr;
+        memcpy(rc_keymap, ud_buf.data.initcfg.keymap, sizeof(rc_keymap));
+    } else if (entry <= MAX_PROFILE) {
+        if (read_userdata_profile(entry, get_target_avconfig()) != 0)
+            return -2;
+
+        set_avconfig_dirty(AVC_DIRTY_ALL);
+    } else {
+        return -1;
+    }
+
+    return 0;
+}
+
+int read_userdata_profile(int entry, avconfig_t *avc) {
+    const ud_rec_hdr *hdr;
+    uint32_t offs;
+
+    if (entry > MAX_PROFILE)
+        return -1;
+
+    hdr = ud_get_rec(entry);
+    if (!hdr)
+        return 1;
+
+    offs = ud_index[entry]+sizeof(ud_rec_hdr)+offsetof(ude_profile, avc);
+
+    if ((hdr->version == 1) && (hdr->data_len == UDE_PROFILE_V1_LEN)) {
+        // fields added in v2 default to off
+        memset(avc, 0, sizeof(avconfig_t));
+        flash_read(offs, AVC_V1_HEAD_LEN, (uint8_t*)avc);
+        flash_read(offs+AVC_V1_TAIL_OFFS, AVC_TAIL_LEN, (uint8_t*)&avc->isl_cfg);
+        printf("Converted v1 profile %d\n", entry);
+        return 0;
+    }
+
+    if ((hdr->version != USERDATA_VER) || (hdr->data_len != sizeof(ude_profile))) {
+        printf("Profile %d v%u (%u bytes) not supported\n", entry, hdr->version, hdr->data_len);
+        return -2;
+    }
+
+    flash_read(offs, sizeof(avconfig_t), (uint8_t*)avc);
+
+    return 0;
+}
+
+int write_userdata(int entry) {
+    uint16_t data_len;
+
+    if ((entry > MAX_USERDATA_ENTRY) || ((entry > MAX_PROFILE) && (entry != INIT_CONFIG_SLOT)))
+        return -1;
+
+    // normally done in background by userdata_service()
+    while (ud_free_blocks < 2) {
+        if (ud_reclaim_block() != 0)
+            return -1;
+    }
+
+    if (entry == INIT_CONFIG_SLOT) {
+        ud_initcfg_pending = 0;
+        ud_buf.data.initcfg.profile_sel = profile_sel;
+        ud_buf.data.initcfg.auto_input = auto_input;
+        ud_buf.data.initcfg.auto_av1_ypbpr = auto_av1_ypbpr;
+        ud_buf.data.initcfg.auto_av2_ypbpr = auto_av2_ypbpr;
+        ud_buf.data.initcfg.auto_av3_ypbpr = auto_av3_ypbpr;
+        memcpy(ud_buf.data.initcfg.keymap, rc_keymap, sizeof(rc_keymap));
+        data_len = sizeof(ude_initcfg);
+    } else {
+        strncpy(ud_buf.data.profile.name, target_profile_name, PROFILE_NAME_LEN+1);
+        memcpy(&ud_buf.data.profile.avc, get_target_avconfig(), sizeof(avconfig_t));
+        data_len = sizeof(ude_profile);
+    }
+
+    return ud_append(entry, USERDATA_VER, data_len);
+}
+
+// Init config is written from main loop instead of the calling context, e.g.
+// after a hot profile switch has been applied
+void write_initcfg_deferred() {
+    ud_initcfg_pending = 1;
+}
+
+// Do a pending init config write or reclaim at most one block per call to keep
+// enough free space for writes
+void userdata_service() {
+    if (ud_initcfg_pending)
+        write_userdata(INIT_CONFIG_SLOT);
+    else if (ud_free_blocks < UD_MIN_FREE_BLOCKS)
+        ud_reclaim_block();
+}
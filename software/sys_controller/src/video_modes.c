@@ -24,9 +24,18 @@
 #include "system.h"
 #include "video_modes.h"
 #include "avconfig.h"
+#include "si5351_calc.h"
 
 #define LINECNT_MAX_TOLERANCE   30
 
+// 480p inputs with longer hsync are treated as VESA 640x480 in auto mode
+#define S480P_AUTO_HSYNCLEN_MAX 82
+
+#define VM_IDX_VTOTAL_SHIFT     5
+#define VM_IDX_VTOTAL_BUCKETS   ((1<<11)>>VM_IDX_VTOTAL_SHIFT)
+
+#define VM_CACHE_SIZE           4
+
 #define VM_OUT_YMULT        (vm_conf->y_rpt+1)
 #define VM_OUT_XMULT        (vm_conf->x_rpt+1)
 #define VM_OUT_PCLKMULT     (((vm_conf->x_rpt+1)*(vm_conf->y_rpt+1))/(vm_conf->h_skip+1))
@@ -35,12 +44,200 @@
 
 const unsigned num_stdmodes = sizeof(stdmode_idx_arr)/sizeof(stdmode_t);
 
-mode_data_t video_modes[sizeof(video_modes_default)/sizeof(mode_data_t)];
+#define NUM_VIDEO_MODES     (sizeof(video_modes_default)/sizeof(mode_data_t))
+#define NUM_ADAPTIVE_MODES  (sizeof(adaptive_modes)/sizeof(ad_mode_data_t))
+
+mode_data_t video_modes[NUM_VIDEO_MODES];
+
+static uint8_t linebuf_lines = LINEBUF_LINES_DEFAULT;
 //ad_mode_data_t adaptive_modes[sizeof(adaptive_modes_default)/sizeof(ad_mode_data_t)];
 
+static const ad_mode_id_t pm_ad_240p_map[] = {-1, ADMODE_480p, ADMODE_720p_60, ADMODE_1280x1024_60, ADMODE_1080i_60_LB, ADMODE_1080p_60_LB, ADMODE_1080p_60_CR, ADMODE_1600x1200_60, ADMODE_1920x1200_60, ADMODE_1920x1440_60, ADMODE_2560x1440_60};
+static const ad_mode_id_t pm_ad_288p_map[] = {-1, ADMODE_576p, ADMODE_1080i_50_CR, ADMODE_1080p_50_CR, ADMODE_1920x1200_50, ADMODE_1920x1440_50, ADMODE_2560x1440_50};
+static const ad_mode_id_t pm_ad_480i_map[] = {-1, ADMODE_240p, ADMODE_1280x1024_60, ADMODE_1080i_60_LB, ADMODE_1080p_60_LB, ADMODE_1920x1440_60, ADMODE_2560x1440_60};
+static const ad_mode_id_t pm_ad_576i_map[] = {-1, ADMODE_288p, ADMODE_1080i_50_CR, ADMODE_1080p_50_CR};
+static const ad_mode_id_t pm_ad_480p_map[] = {-1, ADMODE_240p, ADMODE_1280x1024_60, ADMODE_1080i_60_LB, ADMODE_1080p_60_LB, ADMODE_1920x1440_60, ADMODE_2560x1440_60};
+static const ad_mode_id_t pm_ad_576p_map[] = {-1, ADMODE_288p, ADMODE_1920x1200_50};
+
+static const smp_mode_t sm_240p_288p_map[] = {SM_GEN_4_3,
+                                              SM_OPT_SNES_256COL, SM_OPT_SNES_512COL,
+                                              SM_OPT_MD_256COL, SM_OPT_MD_320COL,
+                                              SM_OPT_PSX_256COL, SM_OPT_PSX_320COL, SM_OPT_PSX_384COL, SM_OPT_PSX_512COL, SM_OPT_PSX_640COL,
+                                              SM_OPT_N64_320COL, SM_OPT_N64_640COL};
+static const smp_mode_t sm_480i_576i_map[] = {SM_GEN_4_3, SM_GEN_16_9};
+static const smp_mode_t sm_480p_map[] = {SM_GEN_4_3, SM_GEN_16_9, SM_OPT_DTV480P, SM_OPT_DTV480P_WS, SM_OPT_VGA480P60};
+static const smp_mode_t sm_576p_map[] = {SM_GEN_4_3};
+
+// Lookup index for get_adaptive_lm_mode() / get_pure_lm_mode(). Lists contain the table entries
+// which can match with current avconfig, separately for [HDMI input][interlaced]. Only v_total,
+// v_hz_max and preset-specific checks are left to be done per lookup.
+typedef struct {
+    uint8_t valid;
+    uint8_t pm_list_len[2][2];
+    uint8_t pm_list[2][2][NUM_VIDEO_MODES];
+    uint8_t pm_list_start[2][2][VM_IDX_VTOTAL_BUCKETS];
+    uint8_t ad_list_len[2][2];
+    uint8_t ad_list[2][2][NUM_ADAPTIVE_MODES];
+} vm_index_t;
+
+static vm_index_t vm_idx;
+
+// Index for lookups against another config, rebuilt on every get_lm_mode_avconfig() call
+// so that the one for current config stays valid
+static vm_index_t vm_idx_alt;
+
+// index lists and their lengths hold table indices in uint8_t
+_Static_assert(NUM_VIDEO_MODES <= UINT8_MAX, "video mode table too large for vm_index_t");
+_Static_assert(NUM_ADAPTIVE_MODES <= UINT8_MAX, "adaptive mode table too large for vm_index_t");
+
+// LRU cache of recent mode solutions, keyed by the measured input timings passed
+// to get_lm_mode() as seen by the lookup (see vm_cache_key()). Only successful
+// lookups are stored. Entries are dropped together with the index since both
+// depend on the same avconfig fields.
+typedef struct {
+    uint8_t valid;
+    uint8_t amode_match;
+    int mode;
+    uint32_t last_used;
+    mode_data_t vm_key;
+    mode_data_t vm_in;
+    mode_data_t vm_out;
+    vm_mult_config_t vm_conf;
+} vm_cache_entry_t;
+
+static vm_cache_entry_t vm_cache[VM_CACHE_SIZE];
+static uint32_t vm_cache_ts;
+
+// Config used for mode lookup instead of current one, see get_lm_mode_avconfig()
+static avconfig_t *vm_avconfig;
+
+static avconfig_t* get_vm_avconfig() {
+    return vm_avconfig ? vm_avconfig : get_current_avconfig();
+}
+
+void invalidate_vm_index() {
+    vm_idx.valid = 0;
+    memset(vm_cache, 0, sizeof(vm_cache));
+}
+
 void set_default_vm_table() {
     memcpy(video_modes, video_modes_default, sizeof(video_modes_default));
     //memcpy(adaptive_modes, adaptive_modes_default, sizeof(adaptive_modes_default));
+    invalidate_vm_index();
+}
+
+static void get_ad_target(avconfig_t *cc, video_group group, ad_mode_id_t *target_ad_id, smp_mode_t *target_sm) {
+    switch (group) {
+        case GROUP_240P:
+            *target_ad_id = pm_ad_240p_map[cc->pm_ad_240p];
+            *target_sm = sm_240p_288p_map[cc->sm_ad_240p_288p];
+            break;
+        case GROUP_288P:
+            *target_ad_id = pm_ad_288p_map[cc->pm_ad_288p];
+            *target_sm = sm_240p_288p_map[cc->sm_ad_240p_288p];
+            break;
+        case GROUP_480I:
+            *target_ad_id = pm_ad_480i_map[cc->pm_ad_480i];
+            *target_sm = sm_480i_576i_map[cc->sm_ad_480i_576i];
+            break;
+        case GROUP_576I:
+            *target_ad_id = pm_ad_576i_map[cc->pm_ad_576i];
+            *target_sm = sm_480i_576i_map[cc->sm_ad_480i_576i];
+            break;
+        case GROUP_480P:
+            *target_ad_id = pm_ad_480p_map[cc->pm_ad_480p];
+            *target_sm = sm_480p_map[cc->sm_ad_480p];
+            break;
+        case GROUP_576P:
+            *target_ad_id = pm_ad_576p_map[cc->pm_ad_576p];
+            *target_sm = sm_576p_map[cc->sm_ad_576p];
+            break;
+        default:
+            *target_ad_id = -1;
+            *target_sm = -1;
+            break;
+    }
+}
+
+static mode_flags get_pure_lm_target(avconfig_t *cc, video_group group) {
+    mode_flags valid_lm[] = { MODE_PT, (MODE_L2 | (MODE_L2<<cc->l2_mode)), (MODE_L3_GEN_16_9<<cc->l3_mode), (MODE_L4_GEN_4_3<<cc->l4_mode), (MODE_L5_GEN_4_3<<cc->l5_mode) };
+    uint8_t pt_only = 0;
+
+    // one for each video_group
+    uint8_t* group_ptr[] = { &pt_only, &cc->pm_240p, &cc->pm_240p, &cc->pm_384p, &cc->pm_480i, &cc->pm_480i, &cc->pm_480p, &cc->pm_480p, &cc->pm_1080i };
+
+    switch (group) {
+        case GROUP_384P:
+            //fixed Line2x/3x mode for 240x360p
+            valid_lm[2] = MODE_L2_240x360;
+            valid_lm[3] = MODE_L3_240x360;
+            valid_lm[4] = MODE_L3_GEN_16_9;
+            break;
+        case GROUP_480I:
+        case GROUP_576I:
+            //fixed Line3x/4x mode for 480i
+            valid_lm[2] = MODE_L3_GEN_16_9;
+            valid_lm[3] = MODE_L4_GEN_4_3;
+            break;
+        default:
+            break;
+    }
+
+    return valid_lm[*group_ptr[group]];
+}
+
+static void build_vm_index(vm_index_t *idx) {
+    int i, b, hdmi, il;
+    uint8_t n;
+    ad_mode_id_t target_ad_id;
+    smp_mode_t target_sm;
+    smp_preset_t *smp_preset;
+    mode_flags target_lm;
+    avconfig_t* cc = get_vm_avconfig();
+
+    for (hdmi=0; hdmi<2; hdmi++) {
+        for (il=0; il<2; il++) {
+            n = 0;
+            for (i=0; i<NUM_VIDEO_MODES; i++) {
+                // HDMI input modes are always matched against passthru entries
+                target_lm = hdmi ? MODE_PT : get_pure_lm_target(cc, video_modes[i].group);
+
+                if ((target_lm & video_modes[i].flags) && (video_modes[i].timings.interlaced == il))
+                    idx->pm_list[hdmi][il][n++] = i;
+            }
+            idx->pm_list_len[hdmi][il] = n;
+
+            // first list position which may match with v_total in each bucket
+            for (b=0, n=0; b<VM_IDX_VTOTAL_BUCKETS; b++) {
+                while ((n < idx->pm_list_len[hdmi][il]) && (video_modes[idx->pm_list[hdmi][il][n]].timings.v_total+LINECNT_MAX_TOLERANCE < (b<<VM_IDX_VTOTAL_SHIFT)))
+                    n++;
+                idx->pm_list_start[hdmi][il][b] = n;
+            }
+
+            n = 0;
+            for (i=0; i<NUM_ADAPTIVE_MODES; i++) {
+                smp_preset = &smp_presets_default[adaptive_modes[i].smp_preset_id];
+                get_ad_target(cc, smp_preset->group, &target_ad_id, &target_sm);
+
+                if ((smp_preset->timings_i.interlaced == il) &&
+                    (target_ad_id == adaptive_modes[i].id) &&
+                    (hdmi || (target_sm == smp_preset->sm)))
+                    idx->ad_list[hdmi][il][n++] = i;
+            }
+            idx->ad_list_len[hdmi][il] = n;
+        }
+    }
+
+    idx->valid = 1;
+}
+
+static vm_index_t* get_vm_index() {
+    vm_index_t *idx = vm_avconfig ? &vm_idx_alt : &vm_idx;
+
+    if (!idx->valid)
+        build_vm_index(idx);
+
+    return idx;
 }
 
 void vmode_hv_mult(mode_data_t *vmode, uint8_t h_mult, uint8_t v_mult) {
@@ -108,72 +305,130 @@ uint32_t estimate_dotclk(mode_data_t *vm_in, uint32_t h_hz) {
     }
 }
 
+void set_linebuf_lines(uint8_t lines)
+{
+    linebuf_lines = lines;
+}
+
+// Model linebuf write and read pointers over a frame to find the range of output framestart
+// offsets (v_linediff, in output lines) which are safe. Source line s is complete at the end of
+// input line v_synclen+v_backporch+s, and its slot is reused when line s+N (or line s%N of the
+// next field) starts. Output line L is read during [L-v_linediff, L-v_linediff+1) counted from
+// input frame start. Output line L reads source line y_start_lb+(L-L0)*step_num/step_den, plus
+// the following line in vscale mode. Times are scaled by in_vtotal*out_interlace_mult.
+// Scaled times stay below 2^25 for v_total up to 2047, so 32-bit math is used throughout
+// and source line is stepped incrementally to keep the per-line cost at two divisions.
+static int get_framesync_bounds(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *vm_conf, uint32_t step_num, uint32_t step_den, uint8_t vscale, int32_t *d_min, int32_t *d_max, int32_t *latency)
+{
+    int32_t r_num, r_den, t_write, t_reuse, t_wrap, d;
+    int32_t L, L0, v_first, v_last, s, s_frac, s_lo, s_hi, s_first=-1;
+    int32_t in_il = vm_in->timings.interlaced ? 2 : 1;
+    int32_t out_il = vm_out->timings.interlaced ? 2 : 1;
+    int32_t in_vstart = vm_in->timings.v_synclen + vm_in->timings.v_backporch;
+    int32_t y_offset = vm_conf->y_offset;
+
+    r_num = vm_out->timings.v_total * in_il;
+    r_den = vm_in->timings.v_total * out_il;
+
+    L0 = vm_out->timings.v_synclen + vm_out->timings.v_backporch;
+    v_first = L0 + ((y_offset < 0) ? 0 : y_offset);
+    v_last = L0 + y_offset + vm_conf->y_size - 1;
+    if (v_last > L0 + vm_out->timings.v_active - 1)
+        v_last = L0 + vm_out->timings.v_active - 1;
+
+    *d_min = INT32_MIN;
+    *d_max = INT32_MAX;
+
+    t_wrap = (vm_out->timings.v_total / out_il) * r_den;
+    s_frac = (v_first-L0) * (int32_t)step_num;
+    s = vm_conf->y_start_lb + s_frac/(int32_t)step_den;
+    s_frac %= (int32_t)step_den;
+
+    for (L=v_first; L<=v_last; L++) {
+        if (L > v_first) {
+            s_frac += (int32_t)step_num;
+            while (s_frac >= (int32_t)step_den) {
+                s_frac -= step_den;
+                s++;
+            }
+        }
+
+        // field specific start line adjustments in scanconverter move read position by one line
+        s_lo = s - (vm_in->timings.interlaced ? 1 : 0);
+        s_hi = s + vscale + ((vm_conf->y_rpt == (uint8_t)(-1)) && vm_out->timings.interlaced ? 1 : 0);
+        if (s_lo < 0)
+            s_lo = 0;
+        if (s_hi < 0)
+            continue;
+        if (s_first < 0)
+            s_first = s_hi;
+
+        // underrun: line s_hi must be written before it is read
+        t_write = (in_vstart + s_hi + 1) * r_num;
+        d = L - ((t_write + r_den - 1) / r_den);
+        if (d < *d_max)
+            *d_max = d;
+
+        // overrun: line s_lo must be read before its slot is reused
+        if (s_lo + linebuf_lines < vm_in->timings.v_active)
+            t_reuse = (in_vstart + s_lo + linebuf_lines) * r_num;
+        else
+            t_reuse = t_wrap + (in_vstart + (s_lo % linebuf_lines)) * r_num;
+        d = L + 1 - (t_reuse / r_den);
+        if (d > *d_min)
+            *d_min = d;
+    }
+
+    if ((s_first < 0) || (*d_min > *d_max))
+        return -1;
+
+    *latency = ((v_first - *d_max) * r_den - (in_vstart + s_first) * r_num) / r_den;
+
+    return 0;
+}
+
+static uint16_t framesync_line_from_diff(mode_data_t *vm_out, int32_t v_linediff)
+{
+    int32_t v_total = vm_out->timings.v_total / (vm_out->timings.interlaced ? 2 : 1);
+
+    while (v_linediff < 0)
+        v_linediff += v_total;
+    while (v_linediff >= v_total)
+        v_linediff -= v_total;
+
+    return v_linediff;
+}
+
 int get_adaptive_lm_mode(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *vm_conf)
 {
-    int i;
-    ad_mode_id_t target_ad_id;
-    smp_mode_t target_sm;
+    int i, j;
     smp_preset_t *smp_preset;
-    int32_t v_linediff;
-    uint32_t in_interlace_mult, out_interlace_mult, vtotal_ref;
-    unsigned num_modes = sizeof(adaptive_modes)/sizeof(ad_mode_data_t);
-    avconfig_t* cc = get_current_avconfig();
+    mode_data_t vm_in_orig;
+    int ret;
+    int32_t d_min, d_max, latency, si_err_ppb;
+    uint32_t in_interlace_mult, out_interlace_mult, pll_h_total, pclk_i_hz;
+    uint8_t hdmi = !!vm_in->timings.h_total;
+    uint8_t il = vm_in->timings.interlaced;
+    avconfig_t* cc = get_vm_avconfig();
+    vm_index_t *idx;
     memset(vm_out, 0, sizeof(mode_data_t));
 
-    const ad_mode_id_t pm_ad_240p_map[] = {-1, ADMODE_480p, ADMODE_720p_60, ADMODE_1280x1024_60, ADMODE_1080i_60_LB, ADMODE_1080p_60_LB, ADMODE_1080p_60_CR, ADMODE_1600x1200_60, ADMODE_1920x1200_60, ADMODE_1920x1440_60, ADMODE_2560x1440_60};
-    const ad_mode_id_t pm_ad_288p_map[] = {-1, ADMODE_576p, ADMODE_1080i_50_CR, ADMODE_1080p_50_CR, ADMODE_1920x1200_50, ADMODE_1920x1440_50, ADMODE_2560x1440_50};
-    const ad_mode_id_t pm_ad_480i_map[] = {-1, ADMODE_240p, ADMODE_1280x1024_60, ADMODE_1080i_60_LB, ADMODE_1080p_60_LB, ADMODE_1920x1440_60, ADMODE_2560x1440_60};
-    const ad_mode_id_t pm_ad_576i_map[] = {-1, ADMODE_288p, ADMODE_1080i_50_CR, ADMODE_1080p_50_CR};
-    const ad_mode_id_t pm_ad_480p_map[] = {-1, ADMODE_240p, ADMODE_1280x1024_60, ADMODE_1080i_60_LB, ADMODE_1080p_60_LB, ADMODE_1920x1440_60, ADMODE_2560x1440_60};
-    const ad_mode_id_t pm_ad_576p_map[] = {-1, ADMODE_288p, ADMODE_1920x1200_50};
-
-    const smp_mode_t sm_240p_288p_map[] = {SM_GEN_4_3,
-                                          SM_OPT_SNES_256COL, SM_OPT_SNES_512COL,
-                                          SM_OPT_MD_256COL, SM_OPT_MD_320COL,
-                                          SM_OPT_PSX_256COL, SM_OPT_PSX_320COL, SM_OPT_PSX_384COL, SM_OPT_PSX_512COL, SM_OPT_PSX_640COL,
-                                          SM_OPT_N64_320COL, SM_OPT_N64_640COL};
-    const smp_mode_t sm_480i_576i_map[] = {SM_GEN_4_3, SM_GEN_16_9};
-    const smp_mode_t sm_480p_map[] = {SM_GEN_4_3, SM_GEN_16_9, SM_OPT_DTV480P, SM_OPT_DTV480P_WS, SM_OPT_VGA480P60};
-    const smp_mode_t sm_576p_map[] = {SM_GEN_4_3};
-
     if (!cc->adapt_lm)
         return -1;
 
-    for (i=0; i<num_modes; i++) {
-        smp_preset = &smp_presets_default[adaptive_modes[i].smp_preset_id];
+    idx = get_vm_index();
 
-        if (smp_preset->group == GROUP_240P) {
-            target_ad_id = pm_ad_240p_map[cc->pm_ad_240p];
-            target_sm = sm_240p_288p_map[cc->sm_ad_240p_288p];
-        } else if (smp_preset->group == GROUP_288P) {
-            target_ad_id = pm_ad_288p_map[cc->pm_ad_288p];
-            target_sm = sm_240p_288p_map[cc->sm_ad_240p_288p];
-        } else if (smp_preset->group == GROUP_480I) {
-            target_ad_id = pm_ad_480i_map[cc->pm_ad_480i];
-            target_sm = sm_480i_576i_map[cc->sm_ad_480i_576i];
-        } else if (smp_preset->group == GROUP_576I) {
-            target_ad_id = pm_ad_576i_map[cc->pm_ad_576i];
-            target_sm = sm_480i_576i_map[cc->sm_ad_480i_576i];
-        } else if (smp_preset->group == GROUP_480P) {
-            target_ad_id = pm_ad_480p_map[cc->pm_ad_480p];
-            target_sm = sm_480p_map[cc->sm_ad_480p];
-        } else if (smp_preset->group == GROUP_576P) {
-            target_ad_id = pm_ad_576p_map[cc->pm_ad_576p];
-            target_sm = sm_576p_map[cc->sm_ad_576p];
-        } else {
-            target_ad_id = -1;
-            target_sm = -1;
-        }
+    for (j=0; j<idx->ad_list_len[hdmi][il]; j++) {
+        i = idx->ad_list[hdmi][il][j];
+        smp_preset = &smp_presets_default[adaptive_modes[i].smp_preset_id];
 
         if (smp_preset->timings_i.v_hz_max && (vm_in->timings.v_hz_max > smp_preset->timings_i.v_hz_max))
             continue;
 
         if (((adaptive_modes[i].v_total_override && (vm_in->timings.v_total == adaptive_modes[i].v_total_override)) || (!adaptive_modes[i].v_total_override && (vm_in->timings.v_total == smp_preset->timings_i.v_total))) &&
-            (!vm_in->timings.h_total || (vm_in->timings.h_total == smp_preset->timings_i.h_total)) &&
-            (vm_in->timings.interlaced == smp_preset->timings_i.interlaced) &&
-            (target_ad_id == adaptive_modes[i].id) &&
-            (vm_in->timings.h_total || (target_sm == smp_preset->sm)))
+            (!vm_in->timings.h_total || (vm_in->timings.h_total == smp_preset->timings_i.h_total)))
         {
+            memcpy(&vm_in_orig, vm_in, sizeof(mode_data_t));
             if (!vm_in->timings.h_active)
                 vm_in->timings.h_active = smp_preset->timings_i.h_active;
             if (!vm_in->timings.v_active)
@@ -218,18 +473,34 @@ int get_adaptive_lm_mode(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config
             vm_out->si_pclk_mult = 0;
             memcpy(&vm_out->si_ms_conf, &adaptive_modes[i].si_ms_conf, sizeof(si5351_ms_config_t));
 
-            // calculate the time (in output lines, rounded up) from source frame start to the point where first to-be-visible line has been written into linebuf
-            v_linediff = (((vm_in->timings.v_synclen + vm_in->timings.v_backporch + ((vm_conf->y_start_lb < 0) ? 0 : vm_conf->y_start_lb) + 1) * vm_out->timings.v_total * in_interlace_mult) / (vm_in->timings.v_total * out_interlace_mult)) + 1;
-
-            // subtract the previous value from the total number of output blanking/empty lines. Resulting value indicates how many lines output framestart must be offset
-            v_linediff = (vm_out->timings.v_synclen + vm_out->timings.v_backporch + ((vm_conf->y_offset < 0) ? 0 : vm_conf->y_offset)) - v_linediff;
+            // solve Si5351 config for entries without a precalculated one, keeping output frame rate locked to input
+            if (!vm_out->si_ms_conf.pll_p3) {
+                pll_h_total = (vm_conf->h_skip+1) * vm_in->timings.h_total + (((vm_conf->h_skip+1) * vm_in->timings.h_total_adj * 5 + 50) / 100);
+                pclk_i_hz = (pll_h_total * vm_in->timings.v_total * (vm_in->timings.v_hz_max ? vm_in->timings.v_hz_max : 60)) / in_interlace_mult;
+                if (si5351_calc_frac_mult(pclk_i_hz,
+                                          vm_out->timings.h_total * vm_out->timings.v_total * in_interlace_mult,
+                                          pll_h_total * vm_in->timings.v_total * out_interlace_mult,
+                                          &vm_out->si_ms_conf,
+                                          &si_err_ppb) != 0)
+                {
+                    memcpy(vm_in, &vm_in_orig, sizeof(mode_data_t));
+                    return -1;
+                }
+            }
 
-            // if linebuf is read faster than written, output framestart must be delayed accordingly to avoid read pointer catching write pointer
-            vtotal_ref = (vm_conf->y_rpt == (uint8_t)(-1)) ? ((vm_in->timings.v_total*out_interlace_mult)/2) : (vm_in->timings.v_total*out_interlace_mult*(vm_conf->y_rpt+1));
-            if (vm_out->timings.v_total * in_interlace_mult > vtotal_ref)
-                v_linediff -= (((vm_in->timings.v_active * vm_out->timings.v_total * in_interlace_mult) / (vm_in->timings.v_total * out_interlace_mult)) - vm_conf->y_size);
+            // start output as early as linebuf pointer model allows
+            if (vm_conf->y_rpt == (uint8_t)(-1))
+                ret = get_framesync_bounds(vm_in, vm_out, vm_conf, 2, 1, 0, &d_min, &d_max, &latency);
+            else
+                ret = get_framesync_bounds(vm_in, vm_out, vm_conf, 1, vm_conf->y_rpt+1, 0, &d_min, &d_max, &latency);
+            if (ret != 0) {
+                printf("Linebuf depth exceeded (framestart window %d..%d, %u lines)\n", (int)d_min, (int)d_max, linebuf_lines);
+                memcpy(vm_in, &vm_in_orig, sizeof(mode_data_t));
+                return -1;
+            }
 
-            vm_conf->framesync_line = (v_linediff < 0) ? (vm_out->timings.v_total/out_interlace_mult)+v_linediff : v_linediff;
+            vm_conf->framesync_line = framesync_line_from_diff(vm_out, d_max);
+            printf("framesync latency: %d lines\n", (int)latency);
 
             printf("framesync_line = %u\nx_start_lb: %d, x_offset: %d, x_size: %u\ny_start_lb: %d, y_offset: %d, y_size: %u\n", vm_conf->framesync_line, vm_conf->x_start_lb, vm_conf->x_offset, vm_conf->x_size, vm_conf->y_start_lb, vm_conf->y_offset, vm_conf->y_size);
 
@@ -242,25 +513,29 @@ int get_adaptive_lm_mode(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config
 
 int get_pure_lm_mode(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *vm_conf)
 {
-    int i;
-    unsigned num_modes = sizeof(video_modes)/sizeof(mode_data_t);
-    avconfig_t* cc = get_current_avconfig();
-    mode_flags valid_lm[] = { MODE_PT, (MODE_L2 | (MODE_L2<<cc->l2_mode)), (MODE_L3_GEN_16_9<<cc->l3_mode), (MODE_L4_GEN_4_3<<cc->l4_mode), (MODE_L5_GEN_4_3<<cc->l5_mode) };
+    int i, j, b, ret;
+    int32_t d_min, d_max, latency, v_linediff;
+    avconfig_t* cc = get_vm_avconfig();
+    vm_index_t *idx;
     mode_flags target_lm;
-    uint8_t pt_only = 0;
     uint8_t nonsampled_h_mult = 0, nonsampled_v_mult = 0;
     uint8_t upsample2x = vm_in->timings.h_total ? 0 : 1;
+    uint8_t hdmi = !!vm_in->timings.h_total;
+    uint8_t il = vm_in->timings.interlaced;
 
-    // one for each video_group
-    uint8_t* group_ptr[] = { &pt_only, &cc->pm_240p, &cc->pm_240p, &cc->pm_384p, &cc->pm_480i, &cc->pm_480i, &cc->pm_480p, &cc->pm_480p, &cc->pm_1080i };
+    idx = get_vm_index();
+
+    // keep bucket in range should v_total field grow beyond 11 bits, candidates for larger
+    // values are all in last bucket
+    b = vm_in->timings.v_total>>VM_IDX_VTOTAL_SHIFT;
+    if (b > VM_IDX_VTOTAL_BUCKETS-1)
+        b = VM_IDX_VTOTAL_BUCKETS-1;
+
+    for (j=idx->pm_list_start[hdmi][il][b]; j<idx->pm_list_len[hdmi][il]; j++) {
+        i = idx->pm_list[hdmi][il][j];
 
-    for (i=0; i<num_modes; i++) {
         switch (video_modes[i].group) {
             case GROUP_384P:
-                //fixed Line2x/3x mode for 240x360p
-                valid_lm[2] = MODE_L2_240x360;
-                valid_lm[3] = MODE_L3_240x360;
-                valid_lm[4] = MODE_L3_GEN_16_9;
                 if ((!vm_in->timings.h_total) && (video_modes[i].timings.v_total == 449)) {
                     if (!strncmp(video_modes[i].name, "720x400_70", 10)) {
                         if (cc->s400p_mode == 0)
@@ -271,17 +546,11 @@ int get_pure_lm_mode(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *
                     }
                 }
                 break;
-            case GROUP_480I:
-            case GROUP_576I:
-                //fixed Line3x/4x mode for 480i
-                valid_lm[2] = MODE_L3_GEN_16_9;
-                valid_lm[3] = MODE_L4_GEN_4_3;
-                break;
             case GROUP_480P:
                  if (video_modes[i].vic == HDMI_480p60) {
                     switch (cc->s480p_mode) {
                         case 0: // Auto
-                            if (vm_in->timings.h_synclen > 82)
+                            if (vm_in->timings.h_synclen > S480P_AUTO_HSYNCLEN_MAX)
                                 continue;
                             break;
                         case 1: // DTV 480p
@@ -306,7 +575,7 @@ int get_pure_lm_mode(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *
         if (video_modes[i].timings.v_hz_max && (vm_in->timings.v_hz_max > video_modes[i].timings.v_hz_max))
             continue;
 
-        target_lm = valid_lm[*group_ptr[video_modes[i].group]];
+        target_lm = get_pure_lm_target(cc, video_modes[i].group);
 
         // HDMI input modes
         if (vm_in->timings.h_total) {
@@ -324,9 +593,7 @@ int get_pure_lm_mode(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *
             target_lm = MODE_PT;
         }
 
-        if ((target_lm & video_modes[i].flags) &&
-            (vm_in->timings.interlaced == video_modes[i].timings.interlaced) &&
-            (vm_in->timings.v_total <= (video_modes[i].timings.v_total+LINECNT_MAX_TOLERANCE)))
+        if (vm_in->timings.v_total <= (video_modes[i].timings.v_total+LINECNT_MAX_TOLERANCE))
         {
 
             if (!vm_in->timings.h_active)
@@ -621,10 +888,21 @@ int get_pure_lm_mode(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *
 
             vm_conf->framesync_line = vm_in->timings.interlaced ? ((vm_out->timings.v_total>>vm_out->timings.interlaced)-(vm_conf->y_rpt+1)) : 0;
 
-            if (vm_conf->x_size == 0)
-                vm_conf->x_size = vm_out->timings.h_active;
+            // output timing is derived from input so fixed framestart applies, just verify it against linebuf model
             if (vm_conf->y_size == 0)
                 vm_conf->y_size = vm_out->timings.v_active;
+            if (vm_conf->y_rpt == (uint8_t)(-1))
+                ret = get_framesync_bounds(vm_in, vm_out, vm_conf, 2, 1, 0, &d_min, &d_max, &latency);
+            else
+                ret = get_framesync_bounds(vm_in, vm_out, vm_conf, 1, vm_conf->y_rpt+1, 0, &d_min, &d_max, &latency);
+            v_linediff = (vm_conf->framesync_line > (vm_out->timings.v_total>>vm_out->timings.interlaced)/2) ? (int32_t)vm_conf->framesync_line-(vm_out->timings.v_total>>vm_out->timings.interlaced) : vm_conf->framesync_line;
+            if ((ret != 0) || (v_linediff < d_min) || (v_linediff > d_max))
+                printf("WARNING: framesync_line %u outside linebuf window %d..%d\n", vm_conf->framesync_line, (int)d_min, (int)d_max);
+            else
+                printf("framesync latency: %d lines\n", (int)(latency + d_max - v_linediff));
+
+            if (vm_conf->x_size == 0)
+                vm_conf->x_size = vm_out->timings.h_active;
 
             /*if (cm.hdmitx_vic == HDMI_Unknown)
                 cm.hdmitx_vic = cm.cc.default_vic;*/
@@ -636,6 +914,120 @@ int get_pure_lm_mode(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *
     return -1;
 }
 
+// Convert a line multiplication config which leaves part of output height unused into
+// fractional vertical scaling. Progressive upscaling only, and output framestart is
+// rescheduled so that the bottom line of each interpolated pair is in linebuf before it is read.
+int get_vscale_config(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *vm_conf, uint32_t *step)
+{
+    int32_t src_h, dst_h, d_min, d_max, latency;
+
+    if (vm_in->timings.interlaced || vm_out->timings.interlaced || (vm_conf->y_rpt == (uint8_t)(-1)))
+        return -1;
+
+    src_h = vm_conf->y_size/(vm_conf->y_rpt+1);
+    dst_h = vm_out->timings.v_active;
+    if ((src_h == 0) || (dst_h <= vm_conf->y_size))
+        return -1;
+
+    *step = ((uint32_t)src_h<<16)/dst_h;
+    vm_conf->y_rpt = 0;
+    vm_conf->y_offset = 0;
+    vm_conf->y_size = dst_h;
+    if (vm_conf->y_start_lb < 0)
+        vm_conf->y_start_lb = 0;
+
+    if (get_framesync_bounds(vm_in, vm_out, vm_conf, *step, 1<<16, 1, &d_min, &d_max, &latency) != 0) {
+        printf("Linebuf depth exceeded for vscale (framestart window %d..%d, %u lines)\n", (int)d_min, (int)d_max, linebuf_lines);
+        return -1;
+    }
+
+    vm_conf->framesync_line = framesync_line_from_diff(vm_out, d_max);
+    printf("vscale framesync latency: %d lines\n", (int)latency);
+
+    return 0;
+}
+
+// Sampled inputs (no measured backporch) get h_synclen replaced by the table
+// value, so the measured one only matters for the 480p auto selection. Reduce
+// it to that decision to keep jitter of the measurement from missing the cache.
+static void vm_cache_key(mode_data_t *key, const mode_data_t *vm_in) {
+    memcpy(key, vm_in, sizeof(mode_data_t));
+
+    if (!key->timings.h_backporch)
+        key->timings.h_synclen = (key->timings.h_synclen > S480P_AUTO_HSYNCLEN_MAX) ? S480P_AUTO_HSYNCLEN_MAX+1 : 0;
+}
+
+int get_lm_mode(mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *vm_conf, uint8_t *amode_match)
+{
+    int i, mode;
+    mode_data_t key;
+    vm_cache_entry_t *e, *lru = &vm_cache[0];
+
+    vm_cache_key(&key, vm_in);
+
+    for (i=0; i<VM_CACHE_SIZE; i++) {
+        e = &vm_cache[i];
+
+        if (e->valid && !memcmp(&e->vm_key, &key, sizeof(mode_data_t))) {
+            memcpy(vm_in, &e->vm_in, sizeof(mode_data_t));
+            memcpy(vm_out, &e->vm_out, sizeof(mode_data_t));
+            memcpy(vm_conf, &e->vm_conf, sizeof(vm_mult_config_t));
+            *amode_match = e->amode_match;
+            e->last_used = ++vm_cache_ts;
+            return e->mode;
+        }
+
+        if (lru->valid && (!e->valid || (e->last_used < lru->last_used)))
+            lru = e;
+    }
+
+    mode = get_adaptive_lm_mode(vm_in, vm_out, vm_conf);
+
+    if (mode < 0) {
+        *amode_match = 0;
+        mode = get_pure_lm_mode(vm_in, vm_out, vm_conf);
+    } else {
+        *amode_match = 1;
+    }
+
+    if (mode < 0)
+        return mode;
+
+    memcpy(&lru->vm_key, &key, sizeof(mode_data_t));
+    lru->valid = 1;
+    lru->amode_match = *amode_match;
+    lru->mode = mode;
+    lru->last_used = ++vm_cache_ts;
+    memcpy(&lru->vm_in, vm_in, sizeof(mode_data_t));
+    memcpy(&lru->vm_out, vm_out, sizeof(mode_data_t));
+    memcpy(&lru->vm_conf, vm_conf, sizeof(vm_mult_config_t));
+
+    return mode;
+}
+
+// Mode lookup against given config. Bypasses the lookup cache and uses a
+// separate index, leaving the ones of current config intact.
+int get_lm_mode_avconfig(avconfig_t *avconfig, mode_data_t *vm_in, mode_data_t *vm_out, vm_mult_config_t *vm_conf, uint8_t *amode_match)
+{
+    int mode;
+
+    vm_avconfig = avconfig;
+    vm_idx_alt.valid = 0;
+
+    mode = get_adaptive_lm_mode(vm_in, vm_out, vm_conf);
+
+    if (mode < 0) {
+        *amode_match = 0;
+        mode = get_pure_lm_mode(vm_in, vm_out, vm_conf);
+    } else {
+        *amode_match = 1;
+    }
+
+    vm_avconfig = NULL;
+
+    return mode;
+}
+
 int get_standard_mode(unsigned stdmode_idx_arr_idx, vm_mult_config_t *vm_conf, mode_data_t *vm_in, mode_data_t *vm_out)
 {
     stdmode_idx_arr_idx = stdmode_idx_arr_idx % num_stdmodes;
@@ -54,6 +54,9 @@ extern alt_u32 __ram_rwdata_end __attribute__((section(".data")));
 extern alt_u32 __flash_rodata_start __attribute__((section(".data")));
 extern alt_u32 __ram_rodata_start __attribute__((section(".data")));
 extern alt_u32 __ram_rodata_end __attribute__((section(".data")));
+extern alt_u32 __flash_ramfunc_start __attribute__((section(".data")));
+extern alt_u32 __ram_ramfunc_start __attribute__((section(".data")));
+extern alt_u32 __ram_ramfunc_end __attribute__((section(".data")));
 extern alt_u32 __flash_exceptions_start __attribute__((section(".data")));  
 extern alt_u32 __ram_exceptions_start __attribute__((section(".data")));
 extern alt_u32 __ram_exceptions_end __attribute__((section(".data")));
@@ -89,6 +92,14 @@ void alt_load (void)
   alt_load_section (&__flash_rodata_start, 
 		                &__ram_rodata_start,
 		                &__ram_rodata_end);
+
+  /*
+   * Copy functions executed from RAM.
+   */
+
+  alt_load_section (&__flash_ramfunc_start,
+		                &__ram_ramfunc_start,
+		                &__ram_ramfunc_end);
   
   /*
    * Now ensure that the caches are in synch.
@@ -1,4 +1,5 @@
 
+#include <stddef.h>
 #include "alt_types.h"
 #include "i2c_opencores_regs.h"
 #include "i2c_opencores.h"
@@ -13,6 +14,23 @@
 /* these functions are polled only.  */
 /* all functions wait until the I2C is done before exiting */
 
+/* number of bytes transferred on all buses, including address bytes */
+static alt_u32 I2C_bytecnt;
+
+/* write filter state, I2C_wf_len < 0 when no write is buffered */
+static const I2C_write_filter *I2C_wfilter;
+static alt_u32 I2C_wf_base;
+static alt_u8 I2C_wf_addr;
+static alt_u8 I2C_wf_buf[I2C_WFILTER_BUFLEN];
+static int I2C_wf_len = -1;
+
+/* initialized queues, drained before synchronous access to same core */
+static I2C_queue *I2C_queues;
+
+static int I2C_start_nf(alt_u32 base, alt_u32 add, alt_u32 read);
+static alt_u32 I2C_write_nf(alt_u32 base, alt_u8 data, alt_u32 last);
+static void I2C_queue_sync(alt_u32 base);
+
 
 /****************************************************************
 int I2C_init
@@ -57,13 +75,36 @@ return value
 15-OCT-07 initial release
 *****************************************************************/
 int I2C_start(alt_u32 base, alt_u32 add, alt_u32 read)
+{
+  /* queued writes must be visible to filter */
+  I2C_queue_sync(base);
+
+  /* buffered write continues with a (repeated) start, put it on bus as is */
+  if (I2C_wf_len >= 0) {
+    I2C_wfilter->commit(I2C_wf_base, I2C_wf_addr, I2C_wf_buf, I2C_wf_len, 0);
+    I2C_wf_len = -1;
+  }
+
+  if (!read && I2C_wfilter && I2C_wfilter->match(base, add)) {
+    I2C_wf_base = base;
+    I2C_wf_addr = add;
+    I2C_wf_len = 0;
+    return (I2C_ACK);
+  }
+
+  return I2C_start_nf(base, add, read);
+}
+
+static int I2C_start_nf(alt_u32 base, alt_u32 add, alt_u32 read)
 {
 #ifdef  I2C_DEBUG
         printf(" Start  I2C at 0x%x, \n\twith address 0x%x \n\tand read 0x%x \n\tand prescale 0x%x\n",base,add,read);
 #endif
+  I2C_queue_sync(base);
 
           /* transmit the address shifted by one and the read/write bit*/
   IOWR_I2C_OPENCORES_TXR(base, ((add<<1) + (0x1 & read)));
+  I2C_bytecnt++;
 
           /* set start and write  bits which will start the transaction*/
   IOWR_I2C_OPENCORES_CR(base, I2C_OPENCORES_CR_STA_MSK | I2C_OPENCORES_CR_WR_MSK );
@@ -120,6 +161,7 @@ alt_u32 I2C_read(alt_u32 base,alt_u32 last)
   }
           /* wait for the trnasaction to be over.*/
   while (IORD_I2C_OPENCORES_SR(base) & I2C_OPENCORES_SR_TIP_MSK) {}
+  I2C_bytecnt++;
 
          /* now read the data */
         return (IORD_I2C_OPENCORES_RXR(base));
@@ -143,12 +185,38 @@ return value
 15-OCT-07 initial release
 *****************************************************************/
 alt_u32 I2C_write(alt_u32 base,alt_u8 data, alt_u32 last)
+{
+  alt_u32 ret;
+
+  if ((I2C_wf_len >= 0) && (I2C_wf_base == base)) {
+    I2C_wf_buf[I2C_wf_len++] = data;
+
+    if (last) {
+      ret = I2C_wfilter->commit(base, I2C_wf_addr, I2C_wf_buf, I2C_wf_len, 1);
+      I2C_wf_len = -1;
+      return ret;
+    } else if (I2C_wf_len == I2C_WFILTER_BUFLEN) {
+      /* flush chunk and continue from next register */
+      ret = I2C_wfilter->commit(base, I2C_wf_addr, I2C_wf_buf, I2C_wf_len, 1);
+      I2C_wf_buf[0] += I2C_WFILTER_BUFLEN-1;
+      I2C_wf_len = 1;
+      return ret;
+    }
+
+    return (I2C_ACK);
+  }
+
+  return I2C_write_nf(base, data, last);
+}
+
+static alt_u32 I2C_write_nf(alt_u32 base,alt_u8 data, alt_u32 last)
 {
   #ifdef  I2C_DEBUG
         printf(" Read I2C at 0x%x, \n\twith data 0x%x,\n\twith last0x%x\n",base,data,last);
 #endif
                  /* transmit the data*/
   IOWR_I2C_OPENCORES_TXR(base, data);
+  I2C_bytecnt++;
 
   if( last)
   {
@@ -182,6 +250,304 @@ alt_u32 I2C_write(alt_u32 base,alt_u8 data, alt_u32 last)
 
 }
 
+/****************************************************************
+alt_u32 I2C_get_bytecnt
+            returns running count of bytes transferred by
+            I2C_start, I2C_read and I2C_write. Wraps around.
+*****************************************************************/
+alt_u32 I2C_get_bytecnt()
+{
+  return I2C_bytecnt;
+}
+
+/****************************************************************
+alt_u32 I2C_write_buf
+            unfiltered write transaction of len bytes. Stop bit is
+            sent after last byte if last is set.
+return value
+       0 if all bytes were acknowledged
+       1 otherwise
+*****************************************************************/
+alt_u32 I2C_write_buf(alt_u32 base, alt_u32 add, const alt_u8 *data, int len, alt_u32 last)
+{
+  int i;
+
+  if (I2C_start_nf(base, add, 0) != I2C_ACK) {
+    IOWR_I2C_OPENCORES_CR(base, I2C_OPENCORES_CR_STO_MSK);
+    while (IORD_I2C_OPENCORES_SR(base) & I2C_OPENCORES_SR_TIP_MSK) {}
+    return (I2C_NOACK);
+  }
+
+  for (i=0; i<len; i++) {
+    if (I2C_write_nf(base, data[i], (last && (i == len-1))) != I2C_ACK) {
+      if (!(last && (i == len-1))) {
+        IOWR_I2C_OPENCORES_CR(base, I2C_OPENCORES_CR_STO_MSK);
+        while (IORD_I2C_OPENCORES_SR(base) & I2C_OPENCORES_SR_TIP_MSK) {}
+      }
+      return (I2C_NOACK);
+    }
+  }
+
+  return (I2C_ACK);
+}
+
+/****************************************************************
+void I2C_set_write_filter
+            installs write filter, NULL disables filtering
+*****************************************************************/
+void I2C_set_write_filter(const I2C_write_filter *filter)
+{
+  I2C_wf_len = -1;
+  I2C_wfilter = filter;
+}
+
+/****************************************************************
+Queued transactions
+            The core interrupt is enabled while the queue is not
+            empty. Interrupts are not vectored, so the IRQ line is
+            used to wake the CPU from WFI, after which
+            I2C_queue_service() must be called to advance the
+            transaction by one byte. Synchronous functions above
+            complete pending transactions of the same core first.
+*****************************************************************/
+#define I2C_XS_IDLE     0
+#define I2C_XS_ADDR_W   1
+#define I2C_XS_WDATA    2
+#define I2C_XS_ADDR_R   3
+#define I2C_XS_RDATA    4
+
+void I2C_queue_init(I2C_queue *q, alt_u32 base)
+{
+  I2C_queue *p;
+
+  q->base = base;
+  q->head = NULL;
+  q->tail = NULL;
+  q->seq_cb = NULL;
+
+  for (p = I2C_queues; p; p = p->qnext) {
+    if (p == q)
+      return;
+  }
+  q->qnext = I2C_queues;
+  I2C_queues = q;
+}
+
+static void I2C_xfer_issue(I2C_queue *q)
+{
+  I2C_xfer *x = q->head;
+  alt_u32 base = q->base;
+
+  if (x->state == I2C_XS_IDLE) {
+    x->pos = 0;
+    x->state = x->wlen ? I2C_XS_ADDR_W : I2C_XS_ADDR_R;
+    IOWR_I2C_OPENCORES_TXR(base, (x->addr<<1) | (x->wlen ? 0 : 1));
+    IOWR_I2C_OPENCORES_CR(base, I2C_OPENCORES_CR_STA_MSK | I2C_OPENCORES_CR_WR_MSK | I2C_OPENCORES_CR_IACK_MSK);
+  } else if (((x->state == I2C_XS_ADDR_W) || (x->state == I2C_XS_WDATA)) && (x->pos < x->wlen)) {
+    x->state = I2C_XS_WDATA;
+    IOWR_I2C_OPENCORES_TXR(base, x->wdata[x->pos]);
+    IOWR_I2C_OPENCORES_CR(base, I2C_OPENCORES_CR_WR_MSK | I2C_OPENCORES_CR_IACK_MSK |
+                          (((x->pos == x->wlen-1) && !x->rlen) ? I2C_OPENCORES_CR_STO_MSK : 0));
+  } else if ((x->state == I2C_XS_ADDR_W) || (x->state == I2C_XS_WDATA)) {
+    /* write phase done, repeated start for read phase */
+    x->pos = 0;
+    x->state = I2C_XS_ADDR_R;
+    IOWR_I2C_OPENCORES_TXR(base, (x->addr<<1) | 1);
+    IOWR_I2C_OPENCORES_CR(base, I2C_OPENCORES_CR_STA_MSK | I2C_OPENCORES_CR_WR_MSK | I2C_OPENCORES_CR_IACK_MSK);
+  } else {
+    x->state = I2C_XS_RDATA;
+    IOWR_I2C_OPENCORES_CR(base, I2C_OPENCORES_CR_RD_MSK | I2C_OPENCORES_CR_IACK_MSK |
+                          ((x->pos == x->rlen-1) ? (I2C_OPENCORES_CR_NACK_MSK | I2C_OPENCORES_CR_STO_MSK) : 0));
+  }
+  I2C_bytecnt++;
+}
+
+static void I2C_xfer_complete(I2C_queue *q, int status)
+{
+  I2C_xfer *x = q->head;
+
+  q->head = x->next;
+  if (q->head == NULL) {
+    q->tail = NULL;
+    IOWR_I2C_OPENCORES_CTR(q->base, I2C_OPENCORES_CTR_EN_MSK);
+    IOWR_I2C_OPENCORES_CR(q->base, I2C_OPENCORES_CR_IACK_MSK);
+  }
+
+  x->status = status;
+  if (x->callback)
+    x->callback(x);
+}
+
+void I2C_queue_post(I2C_queue *q, I2C_xfer *xfer)
+{
+  xfer->state = I2C_XS_IDLE;
+  xfer->status = I2C_OK;
+  xfer->next = NULL;
+
+  if (q->tail) {
+    q->tail->next = xfer;
+    q->tail = xfer;
+    return;
+  }
+
+  q->head = q->tail = xfer;
+
+  /* issued by I2C_queue_service once sequencer list has finished */
+  if (q->seq_cb)
+    return;
+
+  IOWR_I2C_OPENCORES_CTR(q->base, I2C_OPENCORES_CTR_EN_MSK | I2C_OPENCORES_CTR_IEN_MSK);
+  I2C_xfer_issue(q);
+}
+
+/****************************************************************
+int I2C_queue_service
+            advances active transaction if previous byte has
+            completed. Does not block.
+return value
+       1 if queue still has pending transactions, 0 otherwise
+*****************************************************************/
+int I2C_queue_service(I2C_queue *q)
+{
+  I2C_seq_cb cb;
+  I2C_xfer *x;
+  alt_u32 sr;
+  int ret;
+
+  if (q->seq_cb) {
+    ret = I2C_seq_status(q->base);
+    if (ret == I2C_SEQ_BUSY)
+      return 1;
+
+    /* drop done IRQ and resume transactions posted meanwhile */
+    IOWR_I2C_OPENCORES_SEQ_CTRL(q->base, I2C_OPENCORES_SEQ_CTRL_IACK_MSK);
+    cb = q->seq_cb;
+    q->seq_cb = NULL;
+    cb(ret, q->seq_ctx);
+
+    if (q->head && (q->head->state == I2C_XS_IDLE) && !q->seq_cb) {
+      IOWR_I2C_OPENCORES_CTR(q->base, I2C_OPENCORES_CTR_EN_MSK | I2C_OPENCORES_CTR_IEN_MSK);
+      I2C_xfer_issue(q);
+    } else if (q->seq_cb) {
+      return 1;
+    }
+  }
+
+  while ((x = q->head) != NULL) {
+    sr = IORD_I2C_OPENCORES_SR(q->base);
+    if (sr & I2C_OPENCORES_SR_TIP_MSK)
+      return 1;
+
+    if (x->state == I2C_XS_RDATA) {
+      x->rdata[x->pos++] = IORD_I2C_OPENCORES_RXR(q->base);
+      if (x->pos == x->rlen) {
+        I2C_xfer_complete(q, I2C_OK);
+        continue;
+      }
+    } else if (sr & I2C_OPENCORES_SR_RXNACK_MSK) {
+      /* release bus unless stop was already issued with last byte */
+      if (!((x->state == I2C_XS_WDATA) && (x->pos == x->wlen-1) && !x->rlen))
+        IOWR_I2C_OPENCORES_CR(q->base, I2C_OPENCORES_CR_STO_MSK | I2C_OPENCORES_CR_IACK_MSK);
+      while (IORD_I2C_OPENCORES_SR(q->base) & I2C_OPENCORES_SR_TIP_MSK) {}
+      I2C_xfer_complete(q, I2C_NOACK);
+      continue;
+    } else if (x->state == I2C_XS_WDATA) {
+      if (++x->pos == x->wlen && !x->rlen) {
+        I2C_xfer_complete(q, I2C_OK);
+        continue;
+      }
+    } else if ((x->state == I2C_XS_ADDR_R) && (x->rlen == 0)) {
+      /* address probe only */
+      IOWR_I2C_OPENCORES_CR(q->base, I2C_OPENCORES_CR_STO_MSK | I2C_OPENCORES_CR_IACK_MSK);
+      while (IORD_I2C_OPENCORES_SR(q->base) & I2C_OPENCORES_SR_TIP_MSK) {}
+      I2C_xfer_complete(q, I2C_OK);
+      continue;
+    }
+
+    I2C_xfer_issue(q);
+  }
+
+  return 0;
+}
+
+void I2C_queue_flush(I2C_queue *q)
+{
+  while (I2C_queue_service(q)) {}
+}
+
+static void I2C_queue_sync(alt_u32 base)
+{
+  I2C_queue *q;
+
+  for (q = I2C_queues; q; q = q->qnext) {
+    if ((q->base == base) && (q->head || q->seq_cb))
+      I2C_queue_flush(q);
+  }
+}
+
+/****************************************************************
+Register list sequencer
+            I2C_seq_load copies a list (4 bytes per entry) to
+            sequencer RAM. I2C_seq_start then executes it in the
+            background. Core registers must not be accessed until
+            I2C_seq_status returns something else than I2C_SEQ_BUSY.
+*****************************************************************/
+int I2C_seq_load(alt_u32 base, const alt_u8 *list, int len)
+{
+  int i;
+
+  if ((len > 4*I2C_SEQ_MAX_ENTRIES) || (IORD_I2C_OPENCORES_SEQ_STATUS(base) & I2C_OPENCORES_SEQ_SR_BUSY_MSK))
+    return -1;
+
+  IOWR_I2C_OPENCORES_SEQ_PTR(base, 0);
+  for (i=0; i<len; i++)
+    IOWR_I2C_OPENCORES_SEQ_DATA(base, list[i]);
+
+  return 0;
+}
+
+void I2C_seq_start(alt_u32 base, int irq_en)
+{
+  I2C_queue_sync(base);
+  IOWR_I2C_OPENCORES_SEQ_CTRL(base, I2C_OPENCORES_SEQ_CTRL_START_MSK | I2C_OPENCORES_SEQ_CTRL_IACK_MSK |
+                              (irq_en ? I2C_OPENCORES_SEQ_CTRL_IEN_MSK : 0));
+}
+
+/****************************************************************
+int I2C_seq_status
+return value
+       I2C_SEQ_BUSY while list is executing
+       I2C_SEQ_ERROR if a transfer was not acknowledged or poll timed out
+       0 when finished successfully
+*****************************************************************/
+int I2C_seq_status(alt_u32 base)
+{
+  alt_u32 sr = IORD_I2C_OPENCORES_SEQ_STATUS(base);
+
+  if (sr & I2C_OPENCORES_SEQ_SR_BUSY_MSK)
+    return I2C_SEQ_BUSY;
+  else if (sr & (I2C_OPENCORES_SEQ_SR_NACK_MSK|I2C_OPENCORES_SEQ_SR_TIMEOUT_MSK))
+    return I2C_SEQ_ERROR;
+
+  return 0;
+}
+
+/****************************************************************
+void I2C_queue_seq_start
+            starts a loaded list with done IRQ enabled and returns.
+            I2C_queue_service() calls cb with I2C_seq_status() result
+            once the list has finished. Transactions posted to the
+            queue in the meantime are held back until then.
+*****************************************************************/
+void I2C_queue_seq_start(I2C_queue *q, I2C_seq_cb cb, void *ctx)
+{
+  I2C_queue_sync(q->base);
+  q->seq_cb = cb;
+  q->seq_ctx = ctx;
+  IOWR_I2C_OPENCORES_SEQ_CTRL(q->base, I2C_OPENCORES_SEQ_CTRL_START_MSK | I2C_OPENCORES_SEQ_CTRL_IACK_MSK |
+                              I2C_OPENCORES_SEQ_CTRL_IEN_MSK);
+}
+
 void SPI_read(alt_u32 base, alt_u8 *rdata, int len)
 {
     int i;
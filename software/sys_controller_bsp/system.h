@@ -242,10 +242,10 @@
 
 #define ALT_MODULE_CLASS_i2c_opencores_0 i2c_opencores
 #define I2C_OPENCORES_0_BASE 0x21040
-#define I2C_OPENCORES_0_IRQ 3
+#define I2C_OPENCORES_0_IRQ 4
 #define I2C_OPENCORES_0_IRQ_INTERRUPT_CONTROLLER_ID 0
 #define I2C_OPENCORES_0_NAME "/dev/i2c_opencores_0"
-#define I2C_OPENCORES_0_SPAN 32
+#define I2C_OPENCORES_0_SPAN 64
 #define I2C_OPENCORES_0_TYPE "i2c_opencores"
 
 
@@ -352,18 +352,18 @@
 #define PIO_1_BASE 0x210d0
 #define PIO_1_BIT_CLEARING_EDGE_REGISTER 0
 #define PIO_1_BIT_MODIFYING_OUTPUT_REGISTER 0
-#define PIO_1_CAPTURE 0
+#define PIO_1_CAPTURE 1
 #define PIO_1_DATA_WIDTH 32
 #define PIO_1_DO_TEST_BENCH_WIRING 0
 #define PIO_1_DRIVEN_SIM_VALUE 0
-#define PIO_1_EDGE_TYPE "NONE"
+#define PIO_1_EDGE_TYPE "ANY"
 #define PIO_1_FREQ 27000000
 #define PIO_1_HAS_IN 1
 #define PIO_1_HAS_OUT 0
 #define PIO_1_HAS_TRI 0
-#define PIO_1_IRQ -1
-#define PIO_1_IRQ_INTERRUPT_CONTROLLER_ID -1
-#define PIO_1_IRQ_TYPE "NONE"
+#define PIO_1_IRQ 5
+#define PIO_1_IRQ_INTERRUPT_CONTROLLER_ID 0
+#define PIO_1_IRQ_TYPE "EDGE"
 #define PIO_1_NAME "/dev/pio_1"
 #define PIO_1_RESET_VALUE 0
 #define PIO_1_SPAN 16
@@ -379,18 +379,18 @@
 #define PIO_2_BASE 0x210e0
 #define PIO_2_BIT_CLEARING_EDGE_REGISTER 0
 #define PIO_2_BIT_MODIFYING_OUTPUT_REGISTER 0
-#define PIO_2_CAPTURE 0
+#define PIO_2_CAPTURE 1
 #define PIO_2_DATA_WIDTH 32
 #define PIO_2_DO_TEST_BENCH_WIRING 0
 #define PIO_2_DRIVEN_SIM_VALUE 0
-#define PIO_2_EDGE_TYPE "NONE"
+#define PIO_2_EDGE_TYPE "ANY"
 #define PIO_2_FREQ 27000000
 #define PIO_2_HAS_IN 1
 #define PIO_2_HAS_OUT 0
 #define PIO_2_HAS_TRI 0
-#define PIO_2_IRQ -1
-#define PIO_2_IRQ_INTERRUPT_CONTROLLER_ID -1
-#define PIO_2_IRQ_TYPE "NONE"
+#define PIO_2_IRQ 6
+#define PIO_2_IRQ_INTERRUPT_CONTROLLER_ID 0
+#define PIO_2_IRQ_TYPE "EDGE"
 #define PIO_2_NAME "/dev/pio_2"
 #define PIO_2_RESET_VALUE 0
 #define PIO_2_SPAN 16
@@ -418,7 +418,7 @@
 
 #define ALT_MODULE_CLASS_sc_config_0 sc_config
 #define SC_CONFIG_0_BASE 0x22000
-#define SC_CONFIG_0_SPAN 16
+#define SC_CONFIG_0_SPAN 128
 
 
 /*